@@ -0,0 +1,168 @@
+/**
+ * @file ドライバのベンチマーク (ホストビルド用)
+ *       模擬したレジスタ(host/port/periph_model.h)で src/drv のドライバを動かし、
+ *       負荷をかけた状態での送信スループットと割り込みハンドラのコストを仮想時間で測る。
+ *
+ *         - 送信タスク : SCI5(SCI_CH_1)で BENCH_TX_BYTES バイトを送信する。
+ *         - A/Dタスク  : 1ミリ秒毎にA/D変換を開始し、終了をポーリングする。
+ *         - 負荷タスク : 1ミリ秒毎に、引数で指定した割合の時間CPUを使用する。(最高優先度)
+ *
+ *       drv_bench [負荷(%)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/drv/sci/sci.h"
+#include "../src/drv/cmt/cmt.h"
+#include "../src/drv/s12ad/s12ad.h"
+#include "../src/rx_utils/rx_utils.h"
+
+#include "../src/os/kernel.h"
+#include "../src/os/kernel_api.h"
+#include "port/host_sim.h"
+#include "port/periph_model.h"
+
+/**
+ * 送信するバイト数
+ */
+#define BENCH_TX_BYTES 16384
+
+/**
+ * 1回に drv_sci_send() に渡すバイト数
+ */
+#define BENCH_TX_CHUNK 64
+
+static stack_type_t TxTaskStack[128];
+static stack_type_t AdcTaskStack[128];
+static stack_type_t LoadTaskStack[128];
+
+static volatile int IsDone = 0;
+static uint32_t LoadPercent = 50;
+
+static uint64_t TxStartTime = 0;
+static uint64_t TxEndTime = 0; /* 最後のバイトの送信が終わった時刻 */
+static uint32_t TxBytes = 0;
+static uint32_t TxRetries = 0; /* 送信FIFOが一杯だった回数 */
+static uint32_t AdcScans = 0;
+
+
+/**
+ * SCI5の送信先
+ * 最後のバイトの送信が終わった時刻を記録する。
+ */
+static void
+bench_sink(uint8_t sci_no, uint8_t data)
+{
+	TxBytes++;
+	TxEndTime = host_sim_get_time();
+}
+
+/**
+ * 送信タスク
+ */
+static void
+tx_task(void *arg)
+{
+	uint8_t buf[BENCH_TX_CHUNK];
+	uint32_t sent = 0;
+
+	for (int i = 0; i < BENCH_TX_CHUNK; i++) {
+		buf[i] = (uint8_t)('0' + (i % 64));
+	}
+
+	TxStartTime = host_sim_get_time();
+	while (sent < BENCH_TX_BYTES) {
+		uint16_t offset = (uint16_t)(sent % BENCH_TX_CHUNK);
+		uint16_t req = (uint16_t)(BENCH_TX_CHUNK - offset);
+		int len = drv_sci_send(SCI_CH_1, buf + offset, req);
+		if (len > 0) {
+			sent += (uint32_t)(len);
+		}
+		if (len < req) {
+			/* 残りは、送信FIFOに空きができてから送る */
+			TxRetries++;
+			sleep(1);
+		}
+	}
+	while (sci_model_is_busy(5)) {
+		sleep(1);
+	}
+	IsDone = 1;
+}
+
+/**
+ * A/Dタスク
+ */
+static void
+adc_task(void *arg)
+{
+	while (!IsDone) {
+		drv_s12ad_start_normal();
+		sleep(1);
+		drv_s12ad_update();
+		if (!drv_s12ad_is_busy()) {
+			AdcScans++;
+		}
+	}
+}
+
+/**
+ * 負荷タスク
+ */
+static void
+load_task(void *arg)
+{
+	while (!IsDone) {
+		host_sim_consume(HOST_SIM_NSEC_PER_MSEC * LoadPercent / 100);
+		sleep(1);
+	}
+}
+
+int
+main(int ac, char **av)
+{
+	if (ac > 1) {
+		LoadPercent = (uint32_t)(strtoul(av[1], NULL, 0));
+		if (LoadPercent > 100) {
+			LoadPercent = 100;
+		}
+	}
+
+	host_sim_init();
+	sci_model_set_sink(5, bench_sink);
+	drv_cmt_init();
+	drv_sci_init();
+	drv_s12ad_init();
+
+	kernel_init();
+
+	kernel_register_task(10, load_task, "load", LoadTaskStack, sizeof(LoadTaskStack));
+	kernel_register_task(11, tx_task, "tx", TxTaskStack, sizeof(TxTaskStack));
+	kernel_register_task(12, adc_task, "adc", AdcTaskStack, sizeof(AdcTaskStack));
+
+	kernel_start_scheduler();
+
+	uint64_t elapse = TxEndTime - TxStartTime;
+	uint32_t frame_nsec = sci_model_get_frame_nsec(5);
+
+	printf("load %u%%\n", LoadPercent);
+	printf("sci5: %u bytes in %llu us, %llu bytes/s (line %llu bytes/s), fifo full %u\n",
+			TxBytes, (unsigned long long)(elapse / 1000),
+			(elapse > 0) ? (unsigned long long)(TxBytes * 1000000000ULL / elapse) : 0ULL,
+			(frame_nsec > 0) ? (unsigned long long)(1000000000ULL / frame_nsec) : 0ULL,
+			TxRetries);
+	printf("s12ad: %u scans (model %u/%u)\n", AdcScans,
+			s12ad_model_get_scan_count(0), s12ad_model_get_scan_count(1));
+	kernel_report_stats();
+
+	/* デバッグ出力(SCI9)の送信が終わるまで待つ */
+	while (sci_model_is_busy(9)) {
+		rx_util_wait();
+	}
+	host_sim_report_vector_stats();
+
+	drv_s12ad_destroy();
+	drv_sci_destroy();
+	drv_cmt_destroy();
+
+	return 0;
+}
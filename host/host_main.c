@@ -0,0 +1,105 @@
+/**
+ * @file ホストビルド用のメイン
+ *       src/mydriver_main.c と同じタスク構成で、スケジューラを1回実行して終了する。
+ *       CMTとSCIはsrc/drvのドライバを、模擬したレジスタ(host/port/periph_model.h)で動かす。
+ *       ボードのポートとA/D変換器は使用しない。
+ */
+#include <stdio.h>
+#include "../src/drv/sci/sci.h"
+#include "../src/drv/cmt/cmt.h"
+#include "../src/rx_utils/rx_utils.h"
+
+#include "../src/os/kernel.h"
+#include "../src/os/kernel_api.h"
+#include "port/host_sim.h"
+#include "port/periph_model.h"
+
+static struct semaphore Sem;
+static struct mutex Mutex;
+
+static stack_type_t Task1Stack[128];
+static stack_type_t Task2Stack[128];
+static stack_type_t Task3Stack[128];
+static int Task1Id = 0;
+static int Task2Id = 0;
+
+
+static void
+task1(void *arg)
+{
+	mutex_lock(&Mutex);
+	const char *name = (const char*)(arg);
+	for (int i = 0; i < 10; i++) {
+		sem_wait(&Sem);
+		rx_debug("%s\n", name);
+	}
+	mutex_unlock(&Mutex);
+
+	return ;
+}
+
+static void
+task2(void *arg)
+{
+	const char *name = (const char*)(arg);
+
+	mutex_lock(&Mutex);
+	for (int i = 0; i < 5; i++) {
+		sem_wait(&Sem);
+		rx_debug("%s\n", name);
+	}
+	mutex_unlock(&Mutex);
+
+	return ;
+}
+
+static void
+task3(void *arg)
+{
+	const char *name = (const char*)(arg);
+	rx_debug("%s\n", name);
+
+	while (kernel_task_is_alive(Task1Id) || kernel_task_is_alive(Task2Id)) {
+		sleep(1000);
+		rx_debug("%s post one.\n", name);
+		sem_post(&Sem);
+	}
+
+	rx_debug("%s exit.\n", name);
+}
+
+int
+main(void)
+{
+	host_sim_init();
+	drv_cmt_init();
+	drv_sci_init();
+
+	kernel_init();
+
+	rx_debug("-----------------------\n");
+	sem_init(&Sem, 0);
+	mutex_init(&Mutex);
+
+	Task1Id = kernel_register_task(11, task1, "task1", Task1Stack, sizeof(Task1Stack));
+	Task2Id = kernel_register_task(10, task2, "task2", Task2Stack, sizeof(Task2Stack));
+	kernel_register_task(12, task3, "task3", Task3Stack, sizeof(Task3Stack));
+
+	kernel_start_scheduler();
+
+	sem_destroy(&Sem);
+	kernel_report_stats();
+	rx_debug("-----------------------\n");
+	rx_debug("elapsed %u ms\n", drv_cmt_get_counter());
+
+	/* デバッグ出力(SCI9)の送信が終わるまで待つ */
+	while (sci_model_is_busy(9)) {
+		rx_util_wait();
+	}
+	host_sim_report_vector_stats();
+
+	drv_sci_destroy();
+	drv_cmt_destroy();
+
+	return 0;
+}
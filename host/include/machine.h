@@ -0,0 +1,9 @@
+/**
+ * @file ホストビルド用のmachine.h
+ *       CC for RXの組み込み関数は使用していないため、空にしてある。
+ *       CPUの操作は host/port/rx_utils_cpu_host.c で模擬する。
+ */
+#ifndef HOST_MACHINE_H_
+#define HOST_MACHINE_H_
+
+#endif /* HOST_MACHINE_H_ */
@@ -0,0 +1,25 @@
+/**
+ * @file ホストビルド用の整数型定義
+ *       generate/typedefine.h と同じ名前を、ホストのstdint.hの型で定義する。
+ *       LP64ではlongが64bitになるため、generate/typedefine.hはそのまま使えない。
+ */
+#ifndef HOST_TYPEDEFINE_H_
+#define HOST_TYPEDEFINE_H_
+
+#include <stdint.h>
+
+typedef int8_t _SBYTE;
+typedef uint8_t _UBYTE;
+typedef int16_t _SWORD;
+typedef uint16_t _UWORD;
+typedef signed int _SINT;
+typedef unsigned int _UINT;
+typedef int32_t _SDWORD;
+typedef uint32_t _UDWORD;
+typedef int64_t _SQWORD;
+typedef uint64_t _UQWORD;
+
+/* CC for RXの拡張キーワード */
+#define __evenaccess
+
+#endif /* HOST_TYPEDEFINE_H_ */
@@ -0,0 +1,34 @@
+/**
+ * @file カーネルのベンチマーク (ホストビルド用)
+ *       src/bench/kernel_bench.c の全項目を計測して結果を出力する。
+ */
+#include "../src/drv/sci/sci.h"
+#include "../src/drv/cmt/cmt.h"
+#include "../src/rx_utils/rx_utils.h"
+
+#include "../src/os/kernel.h"
+#include "../src/bench/kernel_bench.h"
+#include "port/host_sim.h"
+#include "port/periph_model.h"
+
+int
+main(void)
+{
+	host_sim_init();
+	drv_cmt_init();
+	drv_sci_init();
+
+	kernel_init();
+
+	kernel_bench_run();
+
+	/* デバッグ出力(SCI9)の送信が終わるまで待つ */
+	while (sci_model_is_busy(9)) {
+		rx_util_wait();
+	}
+
+	drv_sci_destroy();
+	drv_cmt_destroy();
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file メモリプールの二重解放のテスト (ホストビルド用)
+ *       他のブロックが確保中のまま、同じブロックを2回解放した時に、
+ *       2回目の解放がエラーになり、空きブロックのリストが壊れないことを確認する。
+ *
+ *       失敗した場合は終了コードが1になる。
+ */
+#include <stdio.h>
+#include "../src/drv/cmt/cmt.h"
+#include "../src/rx_utils/error_code.h"
+
+#include "../src/os/kernel.h"
+#include "../src/os/kernel_api.h"
+#include "port/host_sim.h"
+
+#define BLOCK_SIZE  16
+#define BLOCK_COUNT 4
+
+static struct mempool Pool;
+static void *PoolBuffer[MEMPOOL_BUFFER_SIZE(BLOCK_SIZE, BLOCK_COUNT) / sizeof(void *) + 1];
+
+static stack_type_t TestStack[128];
+
+static int Failures = 0;
+
+
+/**
+ * 確認する。
+ *
+ * @param is_ok 条件
+ * @param what 確認した内容
+ */
+static void
+check(int is_ok, const char *what)
+{
+	printf("%s: %s\n", is_ok ? "ok" : "FAIL", what);
+	if (!is_ok) {
+		Failures++;
+	}
+}
+
+static void
+test_task(void *arg)
+{
+	void *a = NULL;
+	void *b = NULL;
+	void *c = NULL;
+	void *d = NULL;
+
+	check((mempool_alloc(&Pool, &a) == 0) && (mempool_alloc(&Pool, &b) == 0),
+			"allocate two blocks");
+
+	check(mempool_free(&Pool, a) == 0, "free a");
+	check(mempool_free(&Pool, a) == ERR_OPERATION_STATE, "free a again is rejected");
+	check(mempool_get_free_count(&Pool) == BLOCK_COUNT - 1, "free count is not inflated");
+
+	check((mempool_tryalloc(&Pool, &c) == 0) && (mempool_tryalloc(&Pool, &d) == 0),
+			"allocate two more blocks");
+	check((c != d) && (c != b) && (d != b), "allocated blocks are distinct");
+
+	check(mempool_free(&Pool, (uint8_t *)(b) + 1) == ERR_INVAL, "misaligned block is rejected");
+	check(mempool_free(&Pool, (uint8_t *)(PoolBuffer) + BLOCK_SIZE * BLOCK_COUNT) == ERR_INVAL,
+			"block outside the pool is rejected");
+
+	check((mempool_free(&Pool, b) == 0) && (mempool_free(&Pool, c) == 0)
+			&& (mempool_free(&Pool, d) == 0), "free the remaining blocks");
+	check(mempool_get_free_count(&Pool) == BLOCK_COUNT, "all blocks are free");
+	check(mempool_free(&Pool, b) == ERR_OPERATION_STATE, "free b again is rejected");
+}
+
+int
+main(void)
+{
+	host_sim_init();
+	drv_cmt_init();
+
+	kernel_init();
+	mempool_init(&Pool, PoolBuffer, BLOCK_SIZE, BLOCK_COUNT);
+
+	kernel_register_task(5, test_task, NULL, TestStack, sizeof(TestStack));
+
+	kernel_start_scheduler();
+
+	mempool_destroy(&Pool);
+	drv_cmt_destroy();
+
+	printf("%s\n", (Failures == 0) ? "PASS" : "FAIL");
+	return (Failures == 0) ? 0 : 1;
+}
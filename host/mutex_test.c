@@ -0,0 +1,165 @@
+/**
+ * @file ミューテックスのテスト (ホストビルド用)
+ *       優先度継承の連鎖の途中で、mutex_timedlock()で待っていたタスクがタイムアウトした時に、
+ *       連鎖の先の所有者まで継承したプライオリティが戻ることを確認する。
+ *
+ *         low  (5)  : Mutex1をロックして、20ミリ秒後にアンロックする。
+ *         mid  (7)  : Mutex2をロックしてから、Mutex1を待つ。 (low が7を継承する)
+ *         high (12) : Mutex2を5ミリ秒のタイムアウトで待つ。 (mid と low が12を継承する)
+ *                     タイムアウトした後、mid と low のプライオリティが7に戻っていること。
+ *
+ *       また、ミューテックスをロックしたまま終了したタスクから、待っていたタスクに
+ *       所有権が渡ることを確認する。
+ *
+ *         holder (4) : Mutex3を2重にロックして、アンロックせずに終了する。
+ *         heir   (6) : Mutex3を待ち、holder の終了で所有権を得ること。
+ *
+ *       プライオリティシーリングのミューテックス(Mutex4, シーリング値8)について、
+ *       シーリング値より高い high はロックできず、heir はシーリング値まで上がることを確認する。
+ *
+ *       失敗した場合は終了コードが1になる。
+ */
+#include <stdio.h>
+#include "../src/drv/cmt/cmt.h"
+#include "../src/rx_utils/error_code.h"
+
+#include "../src/os/kernel.h"
+#include "../src/os/kernel_api.h"
+#include "../src/os/task.h"
+#include "port/host_sim.h"
+
+#define LOW_PRIORITY  5
+#define MID_PRIORITY  7
+#define HIGH_PRIORITY 12
+#define HOLDER_PRIORITY 4
+#define HEIR_PRIORITY   6
+#define CEILING_PRIORITY 8
+
+static struct mutex Mutex1;
+static struct mutex Mutex2;
+static struct mutex Mutex3;
+static struct mutex Mutex4;
+
+static stack_type_t LowStack[128];
+static stack_type_t MidStack[128];
+static stack_type_t HighStack[128];
+static stack_type_t HolderStack[128];
+static stack_type_t HeirStack[128];
+static int LowId = 0;
+static int MidId = 0;
+static int HeirId = 0;
+
+static int Failures = 0;
+
+
+/**
+ * 確認する。
+ *
+ * @param is_ok 条件
+ * @param what 確認した内容
+ */
+static void
+check(int is_ok, const char *what)
+{
+	printf("%s: %s\n", is_ok ? "ok" : "FAIL", what);
+	if (!is_ok) {
+		Failures++;
+	}
+}
+
+/**
+ * タスクの現在のプライオリティを得る。
+ */
+static int
+get_priority(int taskid)
+{
+	struct task_entry *entry = kernel_get_task(taskid);
+	return (entry != NULL) ? entry->param.priority : -1;
+}
+
+static void
+low_task(void *arg)
+{
+	mutex_lock(&Mutex1);
+	sleep(20);
+	check(get_priority(LowId) == MID_PRIORITY, "low keeps mid's priority while mid waits");
+	mutex_unlock(&Mutex1);
+	check(get_priority(LowId) == LOW_PRIORITY, "low returns to its base priority after unlock");
+}
+
+static void
+mid_task(void *arg)
+{
+	mutex_lock(&Mutex2);
+	sleep(1);
+	mutex_lock(&Mutex1);
+	mutex_unlock(&Mutex1);
+	mutex_unlock(&Mutex2);
+	check(get_priority(MidId) == MID_PRIORITY, "mid returns to its base priority after unlock");
+}
+
+static void
+high_task(void *arg)
+{
+	check(mutex_lock(&Mutex4) == ERR_INVAL, "high cannot lock a mutex whose ceiling is lower");
+	check(mutex_trylock(&Mutex4) == ERR_INVAL, "high cannot trylock a mutex whose ceiling is lower");
+
+	sleep(2);
+	check(get_priority(LowId) == MID_PRIORITY, "low inherits mid's priority");
+
+	int result = mutex_timedlock(&Mutex2, 5);
+	check(result == ERR_TIMEOUT, "high times out on mutex2");
+	check(get_priority(MidId) == MID_PRIORITY, "mid drops high's priority after the timeout");
+	check(get_priority(LowId) == MID_PRIORITY, "low drops high's priority after the timeout");
+}
+
+static void
+holder_task(void *arg)
+{
+	mutex_lock(&Mutex3);
+	mutex_lock(&Mutex3);
+	sleep(3);
+}
+
+static void
+heir_task(void *arg)
+{
+	sleep(1);
+	check(mutex_timedlock(&Mutex3, 100) == 0, "heir takes over the mutex its owner exited with");
+	check(mutex_unlock(&Mutex3) == 0, "heir unlocks the mutex it took over");
+
+	check(mutex_lock(&Mutex4) == 0, "heir locks a mutex whose ceiling is higher");
+	check(get_priority(HeirId) == CEILING_PRIORITY, "heir runs at the ceiling");
+	mutex_unlock(&Mutex4);
+	check(get_priority(HeirId) == HEIR_PRIORITY, "heir returns to its base priority after unlock");
+}
+
+int
+main(void)
+{
+	host_sim_init();
+	drv_cmt_init();
+
+	kernel_init();
+	mutex_init(&Mutex1);
+	mutex_init(&Mutex2);
+	mutex_init(&Mutex3);
+	mutex_init_ceiling(&Mutex4, CEILING_PRIORITY);
+
+	LowId = kernel_register_task(LOW_PRIORITY, low_task, NULL, LowStack, sizeof(LowStack));
+	MidId = kernel_register_task(MID_PRIORITY, mid_task, NULL, MidStack, sizeof(MidStack));
+	kernel_register_task(HIGH_PRIORITY, high_task, NULL, HighStack, sizeof(HighStack));
+	kernel_register_task(HOLDER_PRIORITY, holder_task, NULL, HolderStack, sizeof(HolderStack));
+	HeirId = kernel_register_task(HEIR_PRIORITY, heir_task, NULL, HeirStack, sizeof(HeirStack));
+
+	kernel_start_scheduler();
+
+	mutex_destroy(&Mutex4);
+	mutex_destroy(&Mutex3);
+	mutex_destroy(&Mutex2);
+	mutex_destroy(&Mutex1);
+	drv_cmt_destroy();
+
+	printf("%s\n", (Failures == 0) ? "PASS" : "FAIL");
+	return (Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file CMT(コンペアマッチタイマ)のモデル (ホストビルド用)
+ *       CMT0, CMT1を模擬する。
+ *
+ *       CMCNTは、カウント開始(または設定変更)した時刻とその時のカウント値を基準に、
+ *       読み出す度に仮想時間から求める。
+ *       CMCNTがCMCORに一致した次のカウントでCMCNTを0にし、CMIE=1であればCMIを要求する。
+ *       コンペアマッチはCMIEに関係なくイベントで発生させる。
+ * @author
+ */
+#include <stddef.h>
+#include <iodefine.h>
+#include "../../src/drv/board_config.h"
+#include "host_io.h"
+#include "host_sim.h"
+#include "periph_model.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/**
+ * CMTのチャンネル
+ */
+struct cmt_channel {
+	struct host_io_region region; /* レジスタ領域 */
+	struct host_sim_event event; /* コンペアマッチ */
+	volatile struct st_cmt0 *regs; /* レジスタ(別名) */
+	uint64_t base_time; /* 基準時刻[ナノ秒] */
+	uint16_t base_count; /* 基準時刻のカウント値 */
+	uint16_t divider; /* 分周比 */
+	uint8_t vect; /* CMIのベクタ番号 */
+	uint8_t is_running; /* カウント動作中かどうか */
+};
+
+static struct cmt_channel Channels[2];
+
+/**
+ * CMSTR0の領域
+ */
+static struct host_io_region CmstrRegion;
+
+static volatile struct st_cmt *Cmt;
+
+static uint16_t get_divider(const struct cmt_channel *ch);
+static uint16_t get_count(const struct cmt_channel *ch);
+static void rebase(struct cmt_channel *ch, uint16_t count);
+static void schedule_match(struct cmt_channel *ch);
+static void match_proc(struct host_sim_event *ev);
+static void channel_before_access(struct host_io_region *region, uint32_t offset, int is_write);
+static void channel_after_access(struct host_io_region *region, uint32_t offset, int is_write);
+static void cmstr_after_access(struct host_io_region *region, uint32_t offset, int is_write);
+
+
+/**
+ * CMTのモデルを初期化する。
+ * 全チャンネル停止、CMCOR=0xFFFF(リセット値)から開始する。
+ */
+void
+cmt_model_init(void)
+{
+	Cmt = &HOST_IO_ALIAS(CMT);
+	Channels[0].regs = &HOST_IO_ALIAS(CMT0);
+	Channels[0].vect = VECT(CMT0, CMI0);
+	Channels[1].regs = &HOST_IO_ALIAS(CMT1);
+	Channels[1].vect = VECT(CMT1, CMI1);
+
+	for (int i = 0; i < 2; i++) {
+		struct cmt_channel *ch = &(Channels[i]);
+		ch->event.is_active = 0;
+		ch->is_running = 0;
+		ch->base_time = 0;
+		ch->base_count = 0;
+		ch->regs->CMCOR = 0xFFFF;
+		ch->divider = get_divider(ch);
+	}
+	host_io_add_region(&(Channels[0].region), (uintptr_t)(&CMT0), sizeof(CMT0),
+			channel_before_access, channel_after_access, &(Channels[0]));
+	host_io_add_region(&(Channels[1].region), (uintptr_t)(&CMT1), sizeof(CMT1),
+			channel_before_access, channel_after_access, &(Channels[1]));
+	host_io_add_region(&CmstrRegion, (uintptr_t)(&(CMT.CMSTR0)), sizeof(CMT.CMSTR0),
+			NULL, cmstr_after_access, NULL);
+}
+
+/**
+ * CMCR.CKSの分周比を得る。
+ *
+ * @param ch チャンネル
+ * @return 分周比 (8, 32, 128, 512)
+ */
+static uint16_t
+get_divider(const struct cmt_channel *ch)
+{
+	return (uint16_t)(8 << (ch->regs->CMCR.BIT.CKS * 2));
+}
+
+/**
+ * 現在のカウント値を得る。
+ *
+ * @param ch チャンネル
+ * @return カウント値
+ */
+static uint16_t
+get_count(const struct cmt_channel *ch)
+{
+	if (!ch->is_running) {
+		return ch->regs->CMCNT;
+	}
+	uint64_t counts = ((host_sim_get_time() - ch->base_time) * PCLKB_CLOCK)
+			/ ((uint64_t)(ch->divider) * NSEC_PER_SEC);
+	return (uint16_t)(ch->base_count + counts);
+}
+
+/**
+ * 現在時刻とカウント値を基準にし直し、次のコンペアマッチを設定する。
+ *
+ * @param ch チャンネル
+ * @param count 現在のカウント値
+ */
+static void
+rebase(struct cmt_channel *ch, uint16_t count)
+{
+	ch->base_time = host_sim_get_time();
+	ch->base_count = count;
+	ch->regs->CMCNT = count;
+	ch->divider = get_divider(ch);
+	schedule_match(ch);
+}
+
+/**
+ * 次のコンペアマッチの時刻にイベントを設定する。
+ * CMCNTがCMCORより大きい場合は、オーバーフローして0に戻った後に一致する。
+ *
+ * @param ch チャンネル
+ */
+static void
+schedule_match(struct cmt_channel *ch)
+{
+	if (!ch->is_running) {
+		host_sim_remove_event(&(ch->event));
+		return ;
+	}
+	uint32_t cmcor = ch->regs->CMCOR;
+	uint32_t counts;
+	if (ch->base_count <= cmcor) {
+		counts = cmcor + 1 - ch->base_count;
+	} else {
+		counts = 0x10000 - ch->base_count + cmcor + 1;
+	}
+	uint64_t period = (uint64_t)(counts) * ch->divider * NSEC_PER_SEC;
+	uint64_t nsec = (period + PCLKB_CLOCK - 1) / PCLKB_CLOCK;
+	host_sim_add_event(&(ch->event), ch->base_time + nsec, match_proc);
+}
+
+/**
+ * コンペアマッチ
+ */
+static void
+match_proc(struct host_sim_event *ev)
+{
+	struct cmt_channel *ch = (ev == &(Channels[0].event)) ? &(Channels[0]) : &(Channels[1]);
+
+	ch->base_time = ev->time;
+	ch->base_count = 0;
+	ch->regs->CMCNT = 0;
+	if (ch->regs->CMCR.BIT.CMIE) {
+		host_sim_raise_irq(ch->vect);
+	}
+	schedule_match(ch);
+}
+
+/**
+ * CMT0/CMT1のレジスタのアクセス前に、CMCNTを現在の値にする。
+ */
+static void
+channel_before_access(struct host_io_region *region, uint32_t offset, int is_write)
+{
+	struct cmt_channel *ch = (struct cmt_channel *)(region->arg);
+	ch->regs->CMCNT = get_count(ch);
+}
+
+/**
+ * CMT0/CMT1のレジスタへの書き込みを反映する。
+ * CMCNTへの書き込みとCKSの変更は、その時点のカウント値からカウントし直す。
+ * CMCORの変更は、次のコンペアマッチの時刻だけを設定し直す。
+ * (CMIEの切り替えで端数のカウントを失わないように、基準時刻は変えない)
+ */
+static void
+channel_after_access(struct host_io_region *region, uint32_t offset, int is_write)
+{
+	struct cmt_channel *ch = (struct cmt_channel *)(region->arg);
+
+	if (!is_write) {
+		return ;
+	}
+	if (((offset & ~1U) == offsetof(struct st_cmt0, CMCNT)) || (get_divider(ch) != ch->divider)) {
+		/* CMCNTは、書き込まれていなければアクセス前に現在の値にしてある */
+		rebase(ch, ch->regs->CMCNT);
+	} else {
+		schedule_match(ch);
+	}
+}
+
+/**
+ * CMSTR0への書き込みで、カウントを開始/停止する。
+ */
+static void
+cmstr_after_access(struct host_io_region *region, uint32_t offset, int is_write)
+{
+	uint8_t str[2];
+
+	if (!is_write) {
+		return ;
+	}
+	str[0] = Cmt->CMSTR0.BIT.STR0;
+	str[1] = Cmt->CMSTR0.BIT.STR1;
+	for (int i = 0; i < 2; i++) {
+		struct cmt_channel *ch = &(Channels[i]);
+		if (str[i] == ch->is_running) {
+			continue;
+		}
+		uint16_t count = get_count(ch);
+		ch->is_running = str[i];
+		rebase(ch, count);
+	}
+}
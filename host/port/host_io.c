@@ -0,0 +1,284 @@
+/**
+ * @file ホストビルド用の周辺レジスタ空間の実装
+ *       同じメモリ(memfd)を2か所にマップする。
+ *         - HOST_IO_BASE: ドライバがアクセスするアドレス。普段はアクセス禁止。
+ *         - Alias: モデルがアクセスする別名。常にアクセスできる。
+ * @author
+ */
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "host_io.h"
+#include "host_sim.h"
+
+#if !defined(__linux__) || !defined(__x86_64__)
+#error "host_io.c supports only x86-64 Linux"
+#endif
+
+/**
+ * EFLAGSのトラップフラグ(シングルステップ)
+ */
+#define X86_EFLAGS_TF 0x100
+/**
+ * ページフォルトのエラーコードの書き込みビット
+ */
+#define X86_PF_WRITE 0x2
+
+/**
+ * 1命令でアクセスするレジスタの最大数
+ * 通常は1つで、メモリ間転送命令などで2つになる。
+ */
+#define MAX_STEP_ACCESSES 4
+
+/**
+ * シングルステップ中のアクセス
+ */
+struct step_access {
+	uintptr_t address; /* アクセスしたアドレス */
+	struct host_io_region *region; /* 領域。登録されていない場合はNULL */
+	uint32_t snapshot; /* アクセス前の値(書き込みの検出用) */
+	uint8_t is_write; /* 書き込みかどうか */
+};
+
+/**
+ * モデルからアクセスする別名
+ */
+static uint8_t *Alias;
+
+/**
+ * 登録された領域のリスト
+ */
+static struct host_io_region *Regions;
+
+/**
+ * レジスタのアクセス回数
+ */
+static uint32_t AccessCount;
+
+/**
+ * シングルステップ中のアクセス
+ */
+static struct step_access StepAccesses[MAX_STEP_ACCESSES];
+static int NumStepAccesses;
+
+static uintptr_t PageMask;
+
+static void segv_handler(int sig, siginfo_t *info, void *context);
+static void trap_handler(int sig, siginfo_t *info, void *context);
+static struct host_io_region *find_region(uintptr_t address);
+static void protect_page(uintptr_t address, int prot);
+static uint32_t read_snapshot(uintptr_t address);
+
+
+/**
+ * 周辺レジスタ空間を初期化する。
+ * レジスタの値は全て0から開始する。(モジュールストップ解除済みの状態)
+ * 2回目以降の呼び出しでは、レジスタの値と登録された領域をクリアする。
+ */
+void
+host_io_init(void)
+{
+	if (Alias != NULL) {
+		memset(Alias, 0, HOST_IO_SIZE);
+		Regions = NULL;
+		AccessCount = 0;
+		return ;
+	}
+
+	PageMask = ~((uintptr_t)(sysconf(_SC_PAGESIZE)) - 1);
+
+	int fd = memfd_create("host_io", 0);
+	if ((fd < 0) || (ftruncate(fd, HOST_IO_SIZE) != 0)) {
+		perror("host_io: memfd_create");
+		abort();
+	}
+	void *io = mmap((void *)(HOST_IO_BASE), HOST_IO_SIZE, PROT_NONE,
+			MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+	if (io != (void *)(HOST_IO_BASE)) {
+		perror("host_io: cannot map the register space");
+		abort();
+	}
+	Alias = mmap(NULL, HOST_IO_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (Alias == MAP_FAILED) {
+		perror("host_io: mmap");
+		abort();
+	}
+	close(fd);
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&(sa.sa_mask));
+	sa.sa_sigaction = segv_handler;
+	sigaction(SIGSEGV, &sa, NULL);
+	sa.sa_sigaction = trap_handler;
+	sigaction(SIGTRAP, &sa, NULL);
+}
+
+/**
+ * レジスタのアドレスに対応する別名を得る。
+ * 別名を使ったアクセスは捕捉されない。
+ *
+ * @param address レジスタのアドレス
+ * @return 別名のアドレス
+ */
+void *
+host_io_alias(uintptr_t address)
+{
+	return Alias + (address - HOST_IO_BASE);
+}
+
+/**
+ * モデルが処理するレジスタの領域を登録する。
+ *
+ * @param region 領域
+ * @param address 先頭アドレス
+ * @param size サイズ[バイト]
+ * @param before_access アクセス前の処理(NULL可)
+ * @param after_access アクセス後の処理(NULL可)
+ * @param arg モデルの引数
+ */
+void
+host_io_add_region(struct host_io_region *region, uintptr_t address, uint32_t size,
+		host_io_access_proc_t before_access, host_io_access_proc_t after_access, void *arg)
+{
+	region->address = address;
+	region->size = size;
+	region->before_access = before_access;
+	region->after_access = after_access;
+	region->arg = arg;
+	region->next = Regions;
+	Regions = region;
+}
+
+/**
+ * レジスタのアクセス回数を得る。
+ *
+ * @return 初期化してからのアクセス回数
+ */
+uint32_t
+host_io_get_access_count(void)
+{
+	return AccessCount;
+}
+
+/**
+ * レジスタ空間へのアクセスを捕捉する。
+ * アクセス前の処理を行い、ページのアクセスを許可して、命令を1つだけ実行させる。
+ */
+static void
+segv_handler(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)(context);
+	uintptr_t address = (uintptr_t)(info->si_addr);
+
+	if ((address < HOST_IO_BASE) || (address >= (HOST_IO_BASE + HOST_IO_SIZE))
+			|| (NumStepAccesses >= MAX_STEP_ACCESSES)) {
+		/* レジスタ空間以外へのアクセス。既定の動作に戻し、再実行で異常終了させる。 */
+		signal(SIGSEGV, SIG_DFL);
+		return ;
+	}
+
+	if (NumStepAccesses == 0) {
+		host_sim_lock_dispatch();
+	}
+	AccessCount++;
+	host_sim_consume(HOST_IO_ACCESS_NSEC);
+
+	struct step_access *access = &(StepAccesses[NumStepAccesses]);
+	NumStepAccesses++;
+	access->address = address;
+	access->region = find_region(address);
+	access->is_write = ((uc->uc_mcontext.gregs[REG_ERR] & X86_PF_WRITE) != 0) ? 1 : 0;
+	if ((access->region != NULL) && (access->region->before_access != NULL)) {
+		access->region->before_access(access->region,
+				(uint32_t)(address - access->region->address), access->is_write);
+	}
+	access->snapshot = read_snapshot(address);
+
+	protect_page(address, PROT_READ | PROT_WRITE);
+	uc->uc_mcontext.gregs[REG_EFL] |= X86_EFLAGS_TF;
+}
+
+/**
+ * シングルステップの完了を捕捉する。
+ * ページを再びアクセス禁止にし、アクセス後の処理を行う。
+ * 読み出し命令と判定されても値が変わっていれば、書き込みとして扱う。(リードモディファイライト)
+ */
+static void
+trap_handler(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)(context);
+
+	if (NumStepAccesses == 0) {
+		/* ブレークポイントなど、レジスタアクセス以外のトラップ */
+		signal(SIGTRAP, SIG_DFL);
+		raise(SIGTRAP);
+		return ;
+	}
+	uc->uc_mcontext.gregs[REG_EFL] &= ~X86_EFLAGS_TF;
+
+	for (int i = 0; i < NumStepAccesses; i++) {
+		protect_page(StepAccesses[i].address, PROT_NONE);
+	}
+	for (int i = 0; i < NumStepAccesses; i++) {
+		struct step_access *access = &(StepAccesses[i]);
+		if ((access->region != NULL) && (access->region->after_access != NULL)) {
+			int is_write = access->is_write || (read_snapshot(access->address) != access->snapshot);
+			access->region->after_access(access->region,
+					(uint32_t)(access->address - access->region->address), is_write);
+		}
+	}
+	NumStepAccesses = 0;
+	host_sim_unlock_dispatch();
+}
+
+/**
+ * アドレスを含む領域を得る。
+ *
+ * @param address アドレス
+ * @return 領域。登録されていない場合はNULL
+ */
+static struct host_io_region *
+find_region(uintptr_t address)
+{
+	for (struct host_io_region *r = Regions; r != NULL; r = r->next) {
+		if ((address >= r->address) && (address < (r->address + r->size))) {
+			return r;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * アドレスを含むページの保護属性を変更する。
+ *
+ * @param address アドレス
+ * @param prot 保護属性
+ */
+static void
+protect_page(uintptr_t address, int prot)
+{
+	if (mprotect((void *)(address & PageMask), ~PageMask + 1, prot) != 0) {
+		abort();
+	}
+}
+
+/**
+ * アドレスを含む4バイトの値を別名から読み出す。
+ *
+ * @param address アドレス
+ * @return 値
+ */
+static uint32_t
+read_snapshot(uintptr_t address)
+{
+	uint32_t value;
+	memcpy(&value, host_io_alias(address & ~(uintptr_t)(3)), sizeof(value));
+	return value;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file ホストビルド用の周辺レジスタ空間
+ *       iodefine.hのレジスタ(0x00080000～0x000FFFFF)を、ホストの同じアドレスにマップしたメモリで模擬する。
+ *
+ *       ドライバはiodefine.hのマクロでRXと同じアドレスをそのままアクセスする。
+ *       このメモリは普段アクセス禁止にしてあり、アクセスする度にSIGSEGVで捕捉して次の処理を行う。
+ *         - 仮想時間をHOST_IO_ACCESS_NSECだけ進める。
+ *         - 領域(host_io_region)が登録されていれば、アクセス前にbefore_accessを呼び出す。
+ *           モデルは読み出される値(カウンタ値など)をここで更新する。
+ *         - アクセスを許可して命令を1つだけ実行(シングルステップ)し、SIGTRAPで再びアクセス禁止にする。
+ *         - 領域が登録されていれば、アクセス後にafter_accessを呼び出す。
+ *           モデルは書き込まれた値(送信データ、開始ビットなど)をここで反映する。
+ *       モデルからは host_io_alias() で得た別名のアドレスを使って、捕捉されずにアクセスする。
+ *
+ *       シグナルハンドラ内から割り込みハンドラを呼び出すことはできないため、
+ *       アクセス中に発生した割り込み要求は保留し、次にhost_simの関数が呼ばれた時に受け付ける。
+ *       (割り込み許可、IPL変更、WAIT、カーネルの呼び出しなど)
+ *
+ *       x86-64のLinuxでのみ動作する。
+ */
+#ifndef HOST_IO_H_
+#define HOST_IO_H_
+
+#include "../../src/rx_utils/rx_types.h"
+
+/**
+ * 模擬するレジスタ空間
+ */
+#define HOST_IO_BASE 0x00080000UL
+#define HOST_IO_SIZE 0x00080000UL
+
+/**
+ * レジスタ1回のアクセスで進める仮想時間[ナノ秒]
+ * 周辺モジュールのアクセスには数クロックかかるため、PCLKB(60MHz)の1サイクル分とする。
+ * レジスタをポーリングするループでも仮想時間が進むようにする。
+ */
+#define HOST_IO_ACCESS_NSEC 17
+
+/**
+ * レジスタの別名を得る。
+ * 例) HOST_IO_ALIAS(CMT0).CMCNT = 0;
+ */
+#define HOST_IO_ALIAS(reg) (*(__typeof__(&(reg)))(host_io_alias((uintptr_t)(&(reg)))))
+
+struct host_io_region;
+typedef void (*host_io_access_proc_t)(struct host_io_region *region, uint32_t offset, int is_write);
+
+/**
+ * 周辺モジュールのモデルが処理するレジスタの領域
+ */
+struct host_io_region {
+	struct host_io_region *next;
+	uintptr_t address; /* 先頭アドレス */
+	uint32_t size; /* サイズ[バイト] */
+	host_io_access_proc_t before_access; /* アクセス前の処理(NULL可) */
+	host_io_access_proc_t after_access; /* アクセス後の処理(NULL可) */
+	void *arg; /* モデルの引数 */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_io_init(void);
+void *host_io_alias(uintptr_t address);
+void host_io_add_region(struct host_io_region *region, uintptr_t address, uint32_t size,
+		host_io_access_proc_t before_access, host_io_access_proc_t after_access, void *arg);
+uint32_t host_io_get_access_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_IO_H_ */
@@ -0,0 +1,620 @@
+/**
+ * @file ホストビルド用のシミュレーション実装
+ * @author
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <iodefine.h>
+#include "host_sim.h"
+#include "host_io.h"
+#include "periph_model.h"
+
+#define CPU_PSW_I  (1UL << 16)
+#define CPU_PSW_U  (1UL << 17)
+#define CPU_PSW_PM (1UL << 20)
+#define CPU_PSW_IPL_SHIFT 24
+#define CPU_PSW_IPL_MASK  (0xFUL << CPU_PSW_IPL_SHIFT)
+
+/**
+ * タスク開始時のPSW (kernel_port_rx.cのINITIAL_PSWと同じ)
+ */
+#define INITIAL_PSW (CPU_PSW_PM | CPU_PSW_U | CPU_PSW_I)
+
+/**
+ * 割り込みベクタ
+ * 割り込み要求、許可、優先レベルはICUのレジスタに置き、ここにはハンドラと統計だけを持つ。
+ */
+struct host_sim_vector {
+	host_sim_isr_t isr; /* 割り込みハンドラ */
+	const char *name; /* 名前(統計の表示用) */
+	uint8_t ipr; /* IPRレジスタの番号 */
+	struct host_sim_vector_stats stats; /* 統計 */
+};
+
+/**
+ * PSWレジスタ
+ * 割り込みの受け付けで退避/復元し、コンテキストスイッチではタスクのスタック上に残る。
+ */
+static uint32_t Psw;
+
+/**
+ * 仮想時間[ナノ秒]
+ */
+static uint64_t Now;
+
+/**
+ * 割り込みベクタ
+ */
+static struct host_sim_vector Vectors[HOST_SIM_NUM_VECTORS];
+
+/**
+ * ハンドラを登録したベクタ番号の一覧 (番号の小さい順)
+ */
+static uint8_t UsedVectors[HOST_SIM_NUM_VECTORS];
+static uint16_t NumUsedVectors;
+
+/**
+ * ICUレジスタ (host_io.hの別名)
+ */
+static volatile struct st_icu *Icu;
+
+/**
+ * 受け付けた割り込みの数
+ */
+static uint32_t AcceptCount;
+
+/**
+ * 割り込みの受け付けを保留する要求の数
+ */
+static uint32_t DispatchLock;
+
+/**
+ * 時刻順に並べたイベントのキュー
+ */
+static struct host_sim_event *Events;
+
+/**
+ * 実行中の割り込みハンドラの計測情報
+ * 多重割り込みでは、割り込まれたハンドラの計測情報をprevでたどる。
+ */
+struct isr_frame {
+	struct isr_frame *prev;
+	uint64_t start_time; /* 開始時刻[ナノ秒] */
+	uint32_t start_io_count; /* 開始時のレジスタアクセス回数 */
+	uint64_t start_host_nsec; /* 開始時のホストの時刻[ナノ秒] */
+};
+
+/**
+ * 最も内側で実行中の割り込みハンドラの計測情報(なければNULL)
+ */
+static struct isr_frame *CurrentIsr;
+
+static int find_acceptable_irq(void);
+static void accept_irq(uint8_t vect);
+static int fire_next_event(uint64_t limit);
+static uint64_t get_host_nsec(void);
+
+
+/**
+ * シミュレーションを初期化する。
+ * スーパーバイザモード、割り込み許可、IPL=0の状態から開始する。
+ * 周辺レジスタ空間を用意し、割り込みベクタと周辺モジュールのモデルを登録する。
+ */
+void
+host_sim_init(void)
+{
+	Psw = CPU_PSW_I;
+	Now = 0;
+	AcceptCount = 0;
+	DispatchLock = 0;
+	Events = NULL;
+	CurrentIsr = NULL;
+	for (int i = 0; i < HOST_SIM_NUM_VECTORS; i++) {
+		Vectors[i].isr = NULL;
+		Vectors[i].name = NULL;
+		Vectors[i].ipr = 0;
+	}
+	NumUsedVectors = 0;
+	host_sim_clear_vector_stats();
+
+	host_io_init();
+	Icu = &HOST_IO_ALIAS(ICU);
+
+	host_vecttbl_init();
+	cmt_model_init();
+	sci_model_init();
+	s12ad_model_init();
+}
+
+/**
+ * 仮想時間を得る。
+ *
+ * @return 仮想時間[ナノ秒]
+ */
+uint64_t
+host_sim_get_time(void)
+{
+	return Now;
+}
+
+/**
+ * CPUが処理に時間を使ったものとして、仮想時間を進める。
+ * 途中で発生したイベントは発生時刻に処理し、割り込みが受け付けられる。
+ * 割り込みで他のタスクに切り替わった場合、残りの時間は切り替え後に戻ってきてから消費する。
+ *
+ * @param nsec 処理時間[ナノ秒]
+ */
+void
+host_sim_consume(uint64_t nsec)
+{
+	uint64_t left = nsec;
+	/* 割り込みハンドラ内のレジスタアクセスでも時間が進むため、イベントの時刻は都度比較する */
+	while ((Events != NULL) && (Events->time <= Now + left)) {
+		if (Events->time > Now) {
+			left -= Events->time - Now;
+			Now = Events->time;
+		}
+		fire_next_event(Events->time);
+	}
+	Now += left;
+}
+
+/**
+ * 割り込みを受け付けるまで待機する。(WAIT命令)
+ * WAIT命令と同じく、割り込みを許可してから待機する。
+ * 受け付けられる割り込みもイベントも無い場合は、二度と復帰できないので終了する。
+ */
+void
+host_sim_wait(void)
+{
+	uint32_t accept_count = AcceptCount;
+
+	Psw |= CPU_PSW_I;
+	host_sim_dispatch();
+	while (accept_count == AcceptCount) {
+		if (Events == NULL) {
+			fprintf(stderr, "host_sim: WAIT with no pending event (deadlock)\n");
+			abort();
+		}
+		fire_next_event(Events->time);
+	}
+}
+
+/**
+ * 割り込みハンドラを登録する。
+ * 割り込みの許可と優先レベルは、ドライバがICUのレジスタ(IEN(), IPR())で設定する。
+ *
+ * @param vect ベクタ番号
+ * @param ipr IPRレジスタの番号
+ * @param isr 割り込みハンドラ
+ * @param name 名前(統計の表示用)
+ */
+void
+host_sim_set_vector(uint8_t vect, uint8_t ipr, host_sim_isr_t isr, const char *name)
+{
+	struct host_sim_vector *v = &(Vectors[vect]);
+
+	if (v->isr == NULL) {
+		uint16_t i = NumUsedVectors;
+		while ((i > 0) && (UsedVectors[i - 1] > vect)) {
+			UsedVectors[i] = UsedVectors[i - 1];
+			i--;
+		}
+		UsedVectors[i] = vect;
+		NumUsedVectors++;
+	}
+	v->isr = isr;
+	v->name = name;
+	v->ipr = ipr;
+}
+
+/**
+ * 割り込みを要求する。(IRフラグを1にする)
+ * 受け付けられる状態であれば、その場で割り込みハンドラを実行する。
+ *
+ * @param vect ベクタ番号
+ */
+void
+host_sim_raise_irq(uint8_t vect)
+{
+	Icu->IR[vect].BIT.IR = 1;
+	host_sim_dispatch();
+}
+
+/**
+ * 保留中の割り込み要求を取り消す。
+ *
+ * @param vect ベクタ番号
+ */
+void
+host_sim_clear_irq(uint8_t vect)
+{
+	Icu->IR[vect].BIT.IR = 0;
+}
+
+/**
+ * 割り込み要求が保留中かどうかを得る。
+ *
+ * @param vect ベクタ番号
+ * @return 保留中の場合は1、それ以外は0
+ */
+int
+host_sim_is_irq_pending(uint8_t vect)
+{
+	return Icu->IR[vect].BIT.IR;
+}
+
+/**
+ * 無条件トラップを発生させる。(INT命令)
+ * 割り込み禁止状態でも、その場でハンドラを実行する。
+ * INT命令ではIPLは変化しないが、RXのハンドラは先頭でIPLを上げているため、ここで合わせて設定する。
+ *
+ * @param isr ハンドラ
+ * @param ipl ハンドラ実行中のIPL
+ */
+void
+host_sim_trap(host_sim_isr_t isr, uint8_t ipl)
+{
+	uint32_t saved_psw = Psw;
+
+	Psw &= ~(CPU_PSW_I | CPU_PSW_U | CPU_PSW_PM | CPU_PSW_IPL_MASK);
+	Psw |= ((uint32_t)(ipl) << CPU_PSW_IPL_SHIFT) & CPU_PSW_IPL_MASK;
+	isr();
+	Psw = saved_psw;
+
+	host_sim_dispatch();
+}
+
+/**
+ * INT命令のトラップハンドラが、退避したPSWのIPLを書き換えてRTEで戻るのを模擬する。
+ * host_sim_set_ipl()と異なり、ユーザーモードでも割り込みレベルを変更できる。
+ *
+ * @param ipl 割り込みレベル(0～15)
+ * @return 変更前のPSWレジスタの値
+ */
+uint32_t
+host_sim_trap_set_ipl(uint8_t ipl)
+{
+	uint32_t saved_psw = Psw;
+
+	if (ipl <= 15) {
+		Psw = (Psw & ~CPU_PSW_IPL_MASK) | ((uint32_t)(ipl) << CPU_PSW_IPL_SHIFT);
+		host_sim_dispatch();
+	}
+
+	return saved_psw;
+}
+
+/**
+ * 受け付けられる割り込みを、割り込みレベルの高い順に全て実行する。
+ */
+void
+host_sim_dispatch(void)
+{
+	int vect;
+	if (DispatchLock != 0) {
+		return ;
+	}
+	while ((vect = find_acceptable_irq()) >= 0) {
+		accept_irq((uint8_t)(vect));
+	}
+}
+
+/**
+ * 割り込みの受け付けを保留する。
+ * 周辺レジスタのアクセス(シグナルハンドラ)中に使用する。
+ * 保留中に発生した割り込み要求は、host_sim_unlock_dispatch()の後、次に受け付けられるタイミングで処理する。
+ */
+void
+host_sim_lock_dispatch(void)
+{
+	DispatchLock++;
+}
+
+/**
+ * 割り込みの受け付けの保留を解除する。
+ */
+void
+host_sim_unlock_dispatch(void)
+{
+	if (DispatchLock > 0) {
+		DispatchLock--;
+	}
+}
+
+/**
+ * PSWレジスタの値を得る。
+ *
+ * @return PSWレジスタの値
+ */
+uint32_t
+host_sim_get_psw(void)
+{
+	return Psw;
+}
+
+/**
+ * PSWレジスタの値を設定する。(MVTC命令)
+ * 変更できるのはU, Iビットだけで、ユーザーモードでは無視される。
+ *
+ * @param psw PSWレジスタの値
+ */
+void
+host_sim_set_psw(uint32_t psw)
+{
+	if ((Psw & CPU_PSW_PM) != 0) {
+		return ;
+	}
+	Psw = (Psw & ~(CPU_PSW_I | CPU_PSW_U)) | (psw & (CPU_PSW_I | CPU_PSW_U));
+	host_sim_dispatch();
+}
+
+/**
+ * 割り込みレベルを設定する。(MVTIPL命令)
+ * ユーザーモードでは無視される。
+ *
+ * @param ipl 割り込みレベル(0～15)
+ */
+void
+host_sim_set_ipl(uint8_t ipl)
+{
+	if (((Psw & CPU_PSW_PM) != 0) || (ipl > 15)) {
+		return ;
+	}
+	Psw = (Psw & ~CPU_PSW_IPL_MASK) | ((uint32_t)(ipl) << CPU_PSW_IPL_SHIFT);
+	host_sim_dispatch();
+}
+
+/**
+ * タスクの開始時の状態(ユーザーモード、割り込み許可、IPL=0)にする。
+ * RXでは初期スタックに積んだPSWをRTEで復元するのに相当する。
+ */
+void
+host_sim_enter_user_mode(void)
+{
+	Psw = INITIAL_PSW;
+	host_sim_dispatch();
+}
+
+/**
+ * イベントを追加する。
+ * 既にキューに入っている場合には、時刻を変更する。
+ *
+ * @param ev イベント
+ * @param time 実行する時刻[ナノ秒]。現在より前の場合は次に時間が進んだ時に実行される。
+ * @param proc 実行する処理
+ */
+void
+host_sim_add_event(struct host_sim_event *ev, uint64_t time, host_sim_event_proc_t proc)
+{
+	host_sim_remove_event(ev);
+	if (time < Now) {
+		time = Now;
+	}
+	ev->time = time;
+	ev->proc = proc;
+
+	/* 同じ時刻のイベントは追加した順に実行する */
+	struct host_sim_event **p = &Events;
+	while ((*p != NULL) && ((*p)->time <= time)) {
+		p = &((*p)->next);
+	}
+	ev->next = *p;
+	*p = ev;
+	ev->is_active = 1;
+}
+
+/**
+ * イベントを取り除く。
+ * キューに入っていない場合には何もしない。
+ *
+ * @param ev イベント
+ */
+void
+host_sim_remove_event(struct host_sim_event *ev)
+{
+	if (!ev->is_active) {
+		return ;
+	}
+	struct host_sim_event **p = &Events;
+	while (*p != NULL) {
+		if (*p == ev) {
+			*p = ev->next;
+			break;
+		}
+		p = &((*p)->next);
+	}
+	ev->next = NULL;
+	ev->is_active = 0;
+}
+
+/**
+ * 受け付けられる割り込みのうち、割り込みレベルが最も高いものを得る。
+ * 割り込みレベルが同じ場合には、ベクタ番号の小さい方を優先する。
+ *
+ * @return ベクタ番号。受け付けられる割り込みが無い場合には-1
+ */
+static int
+find_acceptable_irq(void)
+{
+	if ((Psw & CPU_PSW_I) == 0) {
+		return -1;
+	}
+	uint8_t level = (uint8_t)((Psw & CPU_PSW_IPL_MASK) >> CPU_PSW_IPL_SHIFT);
+	int found = -1;
+	for (uint16_t i = 0; i < NumUsedVectors; i++) {
+		uint8_t vect = UsedVectors[i];
+		if ((Icu->IR[vect].BIT.IR == 0)
+				|| (((Icu->IER[vect >> 3].BYTE >> (vect & 7)) & 1) == 0)) {
+			continue;
+		}
+		uint8_t priority = Icu->IPR[Vectors[vect].ipr].BIT.IPR;
+		if (priority > level) {
+			level = priority;
+			found = vect;
+		}
+	}
+	return found;
+}
+
+/**
+ * 割り込みを受け付け、ハンドラを実行する。
+ * 受け付け時にIRフラグをクリアし(エッジ検出)、PSWを退避して、
+ * 割り込み禁止、スーパーバイザモード、IPLを割り込みレベルにする。
+ * ハンドラから戻ったら、退避したPSWを復元する。(RTE命令)
+ * ハンドラ内でコンテキストスイッチした場合、退避したPSWは切り替え前のタスクのスタックに残り、
+ * そのタスクに戻ってきた時に復元される。
+ *
+ * @param vect ベクタ番号
+ */
+static void
+accept_irq(uint8_t vect)
+{
+	struct host_sim_vector *v = &(Vectors[vect]);
+	uint32_t saved_psw = Psw;
+	uint8_t priority = Icu->IPR[v->ipr].BIT.IPR;
+
+	Icu->IR[vect].BIT.IR = 0;
+	AcceptCount++;
+	v->stats.count++;
+	Psw &= ~(CPU_PSW_I | CPU_PSW_U | CPU_PSW_PM | CPU_PSW_IPL_MASK);
+	Psw |= (uint32_t)(priority) << CPU_PSW_IPL_SHIFT;
+
+	struct isr_frame frame;
+	frame.prev = CurrentIsr;
+	frame.start_time = Now;
+	frame.start_io_count = host_io_get_access_count();
+	frame.start_host_nsec = get_host_nsec();
+	CurrentIsr = &frame;
+	v->isr();
+	CurrentIsr = frame.prev;
+	v->stats.host_nsec += get_host_nsec() - frame.start_host_nsec;
+	v->stats.io_count += host_io_get_access_count() - frame.start_io_count;
+	v->stats.virtual_nsec += Now - frame.start_time;
+
+	Psw = saved_psw;
+}
+
+/**
+ * limitまでに発生するイベントを1つ実行する。
+ * 仮想時間をイベントの時刻まで進め、発生した割り込みを受け付ける。
+ *
+ * @param limit 時刻の上限[ナノ秒]
+ * @return イベントを実行した場合は1、それ以外は0
+ */
+static int
+fire_next_event(uint64_t limit)
+{
+	struct host_sim_event *ev = Events;
+	if ((ev == NULL) || (ev->time > limit)) {
+		return 0;
+	}
+	Events = ev->next;
+	ev->next = NULL;
+	ev->is_active = 0;
+	if (ev->time > Now) {
+		Now = ev->time;
+	}
+	ev->proc(ev);
+	host_sim_dispatch();
+	return 1;
+}
+
+/**
+ * 割り込みハンドラの統計を得る。
+ *
+ * @param vect ベクタ番号
+ * @param stats 統計を格納する領域
+ */
+void
+host_sim_get_vector_stats(uint8_t vect, struct host_sim_vector_stats *stats)
+{
+	*stats = Vectors[vect].stats;
+}
+
+/**
+ * 割り込みハンドラの統計をクリアする。
+ */
+void
+host_sim_clear_vector_stats(void)
+{
+	for (int i = 0; i < HOST_SIM_NUM_VECTORS; i++) {
+		Vectors[i].stats.count = 0;
+		Vectors[i].stats.io_count = 0;
+		Vectors[i].stats.virtual_nsec = 0;
+		Vectors[i].stats.host_nsec = 0;
+	}
+}
+
+/**
+ * 割り込みハンドラの統計を標準出力に表示する。
+ * 1回当たりのレジスタアクセス回数、仮想時間、ホストの時間を表示する。
+ */
+void
+host_sim_report_vector_stats(void)
+{
+	printf("vect name             count   io/isr   vns/isr  host-ns/isr\n");
+	for (uint16_t i = 0; i < NumUsedVectors; i++) {
+		const struct host_sim_vector *v = &(Vectors[UsedVectors[i]]);
+		const struct host_sim_vector_stats *st = &(v->stats);
+		if (st->count == 0) {
+			continue;
+		}
+		printf("%4u %-14s %7u %8.1f %9.1f %12.1f\n", UsedVectors[i],
+				(v->name != NULL) ? v->name : "-", st->count,
+				(double)(st->io_count) / st->count,
+				(double)(st->virtual_nsec) / st->count,
+				(double)(st->host_nsec) / st->count);
+	}
+}
+
+/**
+ * 実行中の割り込みハンドラの統計の計測を一時停止する。
+ * ハンドラ内でコンテキストスイッチする場合に、swapcontext()の直前で呼び出す。
+ * 切り替え先のタスクの実行時間が、そのハンドラの統計に含まれないようにする。
+ *
+ * @param pause 一時停止状態を格納する領域(切り替え前のタスクのスタック上)
+ */
+void
+host_sim_pause_isr_stats(struct host_sim_isr_pause *pause)
+{
+	pause->frame = CurrentIsr;
+	pause->time = Now;
+	pause->io_count = host_io_get_access_count();
+	pause->host_nsec = get_host_nsec();
+	CurrentIsr = NULL;
+}
+
+/**
+ * 一時停止した割り込みハンドラの統計の計測を再開する。
+ * 切り替え前のタスクに戻ってきた時(swapcontext()から戻った直後)に呼び出す。
+ * 停止していた間の時間とレジスタアクセス回数を、計測の対象から除く。
+ *
+ * @param pause host_sim_pause_isr_stats()で得た一時停止状態
+ */
+void
+host_sim_resume_isr_stats(const struct host_sim_isr_pause *pause)
+{
+	struct isr_frame *frame = (struct isr_frame *)(pause->frame);
+
+	if (frame != NULL) {
+		frame->start_time += Now - pause->time;
+		frame->start_io_count += host_io_get_access_count() - pause->io_count;
+		frame->start_host_nsec += get_host_nsec() - pause->host_nsec;
+	}
+	CurrentIsr = frame;
+}
+
+/**
+ * ホストの単調増加時刻を得る。
+ *
+ * @return 時刻[ナノ秒]
+ */
+static uint64_t
+get_host_nsec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)(ts.tv_sec) * 1000000000ULL + (uint64_t)(ts.tv_nsec);
+}
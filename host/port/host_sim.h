@@ -0,0 +1,119 @@
+/**
+ * @file ホストビルド用のシミュレーション
+ *       CPUのPSW(I, IPL, PM)、割り込みコントローラ、仮想時間を模擬する。
+ *
+ *       仮想時間はCPUが待機(WAIT)した時と、host_sim_consume()で処理時間を消費した時、
+ *       周辺レジスタをアクセスした時(host_io.h)だけ進む。
+ *       ホストの実行速度に依存しないため、同じプログラムは毎回同じ順序で実行される。
+ *
+ *       割り込みはRXのベクタ番号で扱い、割り込み要求(IR)、許可(IER)、優先レベル(IPR)は
+ *       模擬したICUのレジスタに置く。ドライバがIR(), IEN(), IPR()マクロで操作した値がそのまま使われる。
+ *       割り込みは次のタイミングで受け付ける。
+ *         - 割り込み要求を出した時 (割り込みハンドラ内から出した場合は、そのハンドラから戻った時)
+ *         - 割り込みを許可した時、IPLを下げた時
+ *         - 仮想時間が進んでイベントが発生した時
+ *       周辺レジスタのアクセス中に発生した割り込み要求は、その後の上記のタイミングまで保留される。
+ */
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include "../../src/rx_utils/rx_types.h"
+
+/**
+ * 割り込みベクタの数
+ */
+#define HOST_SIM_NUM_VECTORS 256
+
+/**
+ * 仮想時間の単位
+ */
+#define HOST_SIM_NSEC_PER_USEC 1000ULL
+#define HOST_SIM_NSEC_PER_MSEC 1000000ULL
+
+/**
+ * CPUの1サイクルの仮想時間[ナノ秒]
+ * ICLK=120MHzの1サイクル(8.3ns)を切り捨てる。
+ */
+#define HOST_SIM_NSEC_PER_CYCLE 8ULL
+
+typedef void (*host_sim_isr_t)(void);
+
+struct host_sim_event;
+typedef void (*host_sim_event_proc_t)(struct host_sim_event *ev);
+
+/**
+ * 仮想時間の指定時刻に実行するイベント
+ * ペリフェラルのモデルが、コンペアマッチや送信完了を発生させるのに使用する。
+ */
+struct host_sim_event {
+	struct host_sim_event *next;
+	uint64_t time; /* 実行する時刻[ナノ秒] */
+	host_sim_event_proc_t proc; /* 実行する処理 */
+	uint8_t is_active; /* キューに入っているかどうか */
+};
+
+/**
+ * 割り込みハンドラの統計
+ * ハンドラ内で多重割り込みが発生した場合は、その分も含まれる。
+ * コンテキストスイッチで切り替え前のタスクが止まっている間(host_sim_pause_isr_stats()から
+ * host_sim_resume_isr_stats()まで)は含まれない。
+ */
+struct host_sim_vector_stats {
+	uint32_t count; /* 受け付けた回数 */
+	uint32_t io_count; /* ハンドラ内のレジスタアクセス回数 */
+	uint64_t virtual_nsec; /* ハンドラ内で進んだ仮想時間[ナノ秒] */
+	uint64_t host_nsec; /* ハンドラの実行にかかったホストの時間[ナノ秒] */
+};
+
+/**
+ * 割り込みハンドラの統計の一時停止状態
+ * コンテキストスイッチする割り込みハンドラが、切り替え前のタスクのスタック上に置く。
+ */
+struct host_sim_isr_pause {
+	void *frame; /* 停止した割り込みハンドラの計測情報 */
+	uint64_t time; /* 停止した時刻[ナノ秒] */
+	uint32_t io_count; /* 停止した時のレジスタアクセス回数 */
+	uint64_t host_nsec; /* 停止した時のホストの時刻[ナノ秒] */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_sim_init(void);
+uint64_t host_sim_get_time(void);
+void host_sim_consume(uint64_t nsec);
+void host_sim_wait(void);
+
+void host_sim_set_vector(uint8_t vect, uint8_t ipr, host_sim_isr_t isr, const char *name);
+void host_sim_raise_irq(uint8_t vect);
+void host_sim_clear_irq(uint8_t vect);
+int host_sim_is_irq_pending(uint8_t vect);
+void host_sim_trap(host_sim_isr_t isr, uint8_t ipl);
+uint32_t host_sim_trap_set_ipl(uint8_t ipl);
+void host_sim_dispatch(void);
+void host_sim_lock_dispatch(void);
+void host_sim_unlock_dispatch(void);
+
+uint32_t host_sim_get_psw(void);
+void host_sim_set_psw(uint32_t psw);
+void host_sim_set_ipl(uint8_t ipl);
+void host_sim_enter_user_mode(void);
+
+void host_sim_add_event(struct host_sim_event *ev, uint64_t time, host_sim_event_proc_t proc);
+void host_sim_remove_event(struct host_sim_event *ev);
+
+void host_sim_get_vector_stats(uint8_t vect, struct host_sim_vector_stats *stats);
+void host_sim_clear_vector_stats(void);
+void host_sim_report_vector_stats(void);
+void host_sim_pause_isr_stats(struct host_sim_isr_pause *pause);
+void host_sim_resume_isr_stats(const struct host_sim_isr_pause *pause);
+
+/* vecttbl_host.c */
+void host_vecttbl_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SIM_H_ */
@@ -0,0 +1,90 @@
+/**
+ * @file カーネルのベンチマークのCPU依存部 (ホストビルド用)
+ *       仮想時間はカーネルの処理では進まないため、ホストのタイムスタンプカウンタを使用する。
+ *       値はホストのCPUや負荷で変わるので、同じマシンでの比較にだけ使うこと。
+ *
+ *       isr to task の割り込みには、未使用のSWINT2のベクタを使い、1ミリ秒(仮想時間)毎の
+ *       イベントで直接要求する。割り込みハンドラは模擬レジスタにアクセスしないので、
+ *       計測値にレジスタアクセスのトラップ(シグナル処理)の時間が含まれない。
+ *       プライオリティはCMT1と同じにする。
+ * @author
+ */
+#include <x86intrin.h>
+#include <iodefine.h>
+#include "../../src/bench/kernel_bench.h"
+#include "host_sim.h"
+
+static timer_handler_t IsrHandler = NULL;
+static struct host_sim_event IsrEvent;
+
+static void bench_isr(void);
+static void isr_event_proc(struct host_sim_event *ev);
+
+
+/**
+ * サイクル数単位のカウンタ値を得る。
+ *
+ * @return タイムスタンプカウンタの下位32bit
+ */
+uint32_t
+kernel_bench_port_get_cycles(void)
+{
+	return (uint32_t)(__rdtsc());
+}
+
+/**
+ * ビジーループの1回分の処理
+ * 仮想時間を1マイクロ秒進め、その間のイベントと割り込みを処理する。
+ */
+void
+kernel_bench_port_spin(void)
+{
+	host_sim_consume(HOST_SIM_NSEC_PER_USEC);
+}
+
+/**
+ * 1ミリ秒毎に割り込みを発生させ、割り込みハンドラからhandlerを呼び出す。
+ *
+ * @param handler 割り込みハンドラから呼び出す処理
+ */
+void
+kernel_bench_port_start_isr(timer_handler_t handler)
+{
+	IsrHandler = handler;
+	host_sim_set_vector(VECT(ICU, SWINT2), IPR_CMT1_CMI1, bench_isr, "ICU_SWINT2");
+	IEN(ICU, SWINT2) = 1;
+	host_sim_add_event(&IsrEvent, host_sim_get_time() + HOST_SIM_NSEC_PER_MSEC, isr_event_proc);
+}
+
+/**
+ * kernel_bench_port_start_isr()で開始した割り込みを止める。
+ */
+void
+kernel_bench_port_stop_isr(void)
+{
+	host_sim_remove_event(&IsrEvent);
+	IEN(ICU, SWINT2) = 0;
+	host_sim_clear_irq(VECT(ICU, SWINT2));
+	IsrHandler = NULL;
+}
+
+/**
+ * 割り込みハンドラ
+ */
+static void
+bench_isr(void)
+{
+	if (IsrHandler != NULL) {
+		IsrHandler(1);
+	}
+}
+
+/**
+ * 1ミリ秒毎のイベント
+ */
+static void
+isr_event_proc(struct host_sim_event *ev)
+{
+	host_sim_add_event(ev, host_sim_get_time() + HOST_SIM_NSEC_PER_MSEC, isr_event_proc);
+	host_sim_raise_irq(VECT(ICU, SWINT2));
+}
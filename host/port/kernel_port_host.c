@@ -0,0 +1,215 @@
+/**
+ * @file カーネルのCPU依存部 (ホストビルド用)
+ *       タスクのコンテキストはucontextで切り替える。
+ *       ソフトウェア割り込みとシステムコールトラップは host_sim.c の割り込みとして模擬し、
+ *       RXのkernel_asm.srcと同じく、ハンドラ内でkernel_update_scheduler()を呼び出して
+ *       CurrentTcbが変わっていればコンテキストを切り替える。
+ *
+ *       タスク登録時に渡されたスタック領域はRXのスタックサイズで確保されていて、
+ *       ホストの関数呼び出しには小さすぎるため使用しない。
+ *       ホスト用のスタックはタスクエントリ毎に別に確保する。
+ * @author
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <iodefine.h>
+#include "../../src/os/kernel.h"
+#include "../../src/os/kernel_port.h"
+#include "../../src/os/task.h"
+#include "host_sim.h"
+
+/**
+ * タスク1つ当たりのホスト用スタックサイズ[バイト]
+ */
+#define HOST_TASK_STACK_SIZE (64 * 1024)
+
+/**
+ * ホスト用のタスクコンテキスト
+ * タスクエントリ(タスクエントリ関数に渡す引数)毎に割り当て、エントリを再利用する時は作り直す。
+ */
+struct host_context {
+	void *arg; /* タスクエントリ関数に渡す引数。割り当てていない場合はNULL */
+	void (*func)(void *arg); /* タスクエントリ関数 */
+	ucontext_t uc; /* コンテキスト */
+	uint8_t stack[HOST_TASK_STACK_SIZE] __attribute__((aligned(16))); /* スタック */
+};
+
+/* kernel.c */
+extern struct rxcc_tcb *CurrentTcb;
+void kernel_update_scheduler(void);
+
+static struct host_context Contexts[MAX_TASKS];
+
+/**
+ * kernel_start_scheduler()を呼び出したコンテキスト
+ * 戻りコンテキストブロック(usp=NULL)に対応する。
+ */
+static ucontext_t ReturnContext;
+
+static ucontext_t *get_context(struct rxcc_tcb *tcb);
+static void swint_isr(void);
+static void task_start(void);
+
+
+/**
+ * ソフトウェア割り込みを初期化する。
+ * ハンドラを登録し、優先レベルと許可はRXと同じくICUのレジスタに設定する。
+ */
+void
+kernel_port_init(void)
+{
+	host_sim_set_vector(VECT(ICU, SWINT), IPR_ICU_SWINT, swint_isr, "ICU_SWINT");
+	IPR(ICU, SWINT) = KERNEL_PRIORITY;
+	IEN(ICU, SWINT) = 1;
+}
+
+/**
+ * ソフトウェア割り込みを発行し、コンテキストスイッチを要求する。
+ * SWINTRへの書き込みでは割り込みの受け付けが保留されるため、直接割り込みを要求する。
+ */
+void
+kernel_port_request_switch(void)
+{
+	host_sim_raise_irq(VECT(ICU, SWINT));
+}
+
+/**
+ * 保留中のソフトウェア割り込みを取り消す。
+ */
+void
+kernel_port_clear_switch(void)
+{
+	host_sim_clear_irq(VECT(ICU, SWINT));
+}
+
+/**
+ * タスクの初期コンテキストを作成する。
+ * RXでは初期スタックフレームを作るが、ホストではucontextを作成し、
+ * そのアドレスをユーザースタックポインタの代わりにTCBに格納する。
+ *
+ * @param stack スタック領域の末尾 (使用しない)
+ * @param func タスクエントリ関数
+ * @param arg タスクエントリ関数に渡す引数。
+ * @param options タスクオプション (使用しない)
+ * @return TCBに格納する値。
+ */
+void*
+kernel_port_init_stack(void *stack, void *func, void *arg, uint8_t options)
+{
+	struct host_context *ctx = NULL;
+	for (int i = 0; i < MAX_TASKS; i++) {
+		if (Contexts[i].arg == arg) {
+			ctx = &(Contexts[i]);
+			break;
+		}
+		if ((ctx == NULL) && (Contexts[i].arg == NULL)) {
+			ctx = &(Contexts[i]);
+		}
+	}
+	if (ctx == NULL) {
+		fprintf(stderr, "kernel_port: no host context for a new task\n");
+		abort();
+	}
+
+	ctx->arg = arg;
+	ctx->func = (void (*)(void *))(func);
+	getcontext(&(ctx->uc));
+	ctx->uc.uc_stack.ss_sp = ctx->stack;
+	ctx->uc.uc_stack.ss_size = sizeof(ctx->stack);
+	ctx->uc.uc_link = NULL;
+	makecontext(&(ctx->uc), task_start, 0);
+
+	return ctx;
+}
+
+/**
+ * システムコールトラップを発行し、同期的にコンテキストスイッチする。
+ * 呼び出したタスクが再びディスパッチされた時に、この関数から返る。
+ */
+void
+kernel_sysc_trap(void)
+{
+	host_sim_trap(swint_isr, KERNEL_PRIORITY);
+}
+
+/**
+ * IPLをKERNEL_PRIORITYまで上げる。ユーザーモードからも呼び出せる。
+ * RXではINT命令のトラップハンドラで、退避したPSWのIPLを書き換える。
+ *
+ * @return 上げる前のPSWの値
+ */
+uint32_t
+kernel_port_enter_critical(void)
+{
+	uint32_t psw = host_sim_get_psw();
+	if (((psw >> 24) & 0xf) < KERNEL_PRIORITY) {
+		host_sim_trap_set_ipl(KERNEL_PRIORITY);
+	}
+
+	return psw;
+}
+
+/**
+ * IPLをkernel_port_enter_critical()が返したPSWの値に戻す。
+ *
+ * @param psw kernel_port_enter_critical()が返したPSWの値
+ */
+void
+kernel_port_exit_critical(uint32_t psw)
+{
+	host_sim_trap_set_ipl((uint8_t)((psw >> 24) & 0xf));
+}
+
+/**
+ * TCBに対応するコンテキストを得る。
+ *
+ * @param tcb タスクコンテキストブロック
+ * @return コンテキスト
+ */
+static ucontext_t *
+get_context(struct rxcc_tcb *tcb)
+{
+	if (tcb->usp == NULL) {
+		return &ReturnContext;
+	}
+	return &(((struct host_context *)(tcb->usp))->uc);
+}
+
+/**
+ * ソフトウェア割り込みハンドラ。
+ * 切り替え前のタスクは、再びディスパッチされるまでswapcontext()の中で止まる。
+ * 止まっている間は、このハンドラの統計の計測を一時停止する。
+ */
+static void
+swint_isr(void)
+{
+	struct rxcc_tcb *from = CurrentTcb;
+
+	kernel_update_scheduler();
+
+	struct rxcc_tcb *to = CurrentTcb;
+	if (to != from) {
+		struct host_sim_isr_pause pause;
+		host_sim_pause_isr_stats(&pause);
+		swapcontext(get_context(from), get_context(to));
+		host_sim_resume_isr_stats(&pause);
+	}
+}
+
+/**
+ * タスクの開始点。
+ * 初期PSWを設定してから、タスクエントリ関数を呼び出す。
+ * タスクエントリ関数(task_entry_proc)はタスクを終了させるため、ここには戻らない。
+ */
+static void
+task_start(void)
+{
+	struct host_context *ctx = (struct host_context *)(CurrentTcb->usp);
+
+	host_sim_enter_user_mode();
+	ctx->func(ctx->arg);
+
+	fprintf(stderr, "kernel_port: task entry returned\n");
+	abort();
+}
@@ -0,0 +1,76 @@
+/**
+ * @file ホストビルド用の周辺モジュールのモデル
+ *       host_io.h のレジスタ空間に、CMT, SCI, S12ADの動作を模擬する処理を登録する。
+ *       ドライバ(src/drv)はRXと同じソースをそのままビルドして使用する。
+ *
+ *       - CMT: CMCNTはPCLKBをCKSで分周したクロックで仮想時間に従って歩進し、
+ *              CMCORとのコンペアマッチでクリアして、CMIE=1であればCMIを要求する。
+ *       - SCI: 調歩同期式モード。SMR.CKS, BRR, SEMRから求めたビットレートで1フレームずつ送受信する。
+ *              TDRからTSRへの転送でTXIを要求し、フレームの送信が終わると送信先(sink)に1バイト渡す。
+ *              受信データは sci_model_inject() で与え、1フレーム毎にRDRに入れてRXIを要求する。
+ *       - S12AD: ADST=1で、対象チャンネルのサンプリングステート(ADSSTRn)と
+ *              逐次比較時間の合計が経過した後にADDRnを更新し、ADSTを0にする。
+ *              変換終了割り込みは模擬しない。(ドライバはADSTをポーリングする)
+ */
+#ifndef PERIPH_MODEL_H_
+#define PERIPH_MODEL_H_
+
+#include "../../src/rx_utils/rx_types.h"
+
+/**
+ * S12ADモデルの拡張チャンネル番号 (s12ad_model_source_tのch)
+ */
+#define S12AD_MODEL_CH_TEMP 0x80 /* 温度センサ */
+#define S12AD_MODEL_CH_OCS  0x81 /* 内部基準電圧 */
+
+/**
+ * SCIの送信先
+ *
+ * @param sci_no SCIの番号
+ * @param data 送信したデータ
+ */
+typedef void (*sci_model_sink_t)(uint8_t sci_no, uint8_t data);
+
+/**
+ * S12ADの入力
+ *
+ * @param unit ユニット番号 (0: S12AD, 1: S12AD1)
+ * @param ch チャンネル番号 (ANxnnのnn、またはS12AD_MODEL_CH_x)
+ * @return A/D変換値 (12bit)
+ */
+typedef uint16_t (*s12ad_model_source_t)(uint8_t unit, uint8_t ch);
+
+/**
+ * SCIの統計
+ */
+struct sci_model_stats {
+	uint32_t tx_bytes; /* 送信したバイト数 */
+	uint32_t rx_bytes; /* 受信したバイト数 */
+	uint32_t overruns; /* オーバーランで失ったバイト数 */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* cmt_model.c */
+void cmt_model_init(void);
+
+/* sci_model.c */
+void sci_model_init(void);
+void sci_model_set_sink(uint8_t sci_no, sci_model_sink_t sink);
+int sci_model_inject(uint8_t sci_no, const uint8_t *data, uint16_t len);
+int sci_model_is_busy(uint8_t sci_no);
+void sci_model_get_stats(uint8_t sci_no, struct sci_model_stats *stats);
+uint32_t sci_model_get_frame_nsec(uint8_t sci_no);
+
+/* s12ad_model.c */
+void s12ad_model_init(void);
+void s12ad_model_set_source(s12ad_model_source_t source);
+uint32_t s12ad_model_get_scan_count(uint8_t unit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERIPH_MODEL_H_ */
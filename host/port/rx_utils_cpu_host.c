@@ -0,0 +1,84 @@
+/**
+ * @file CPUユーティリティ (ホストビルド用)
+ *       src/rx_utils/rx_utils_cpu_asm.src の関数を、host_sim.cの模擬CPUで実装する。
+ * @author
+ */
+#include "../../src/rx_utils/rx_utils_cpu.h"
+#include "host_sim.h"
+
+#define CPU_PSW_I  (1 << 16)
+
+/**
+ * NOP命令を発効する。
+ * 仮想時間をCPUの1サイクル分進める。
+ */
+void
+rx_util_nop(void)
+{
+	host_sim_consume(HOST_SIM_NSEC_PER_CYCLE);
+}
+
+/**
+ * WAIT命令を発効し、割り込み待ちになる。
+ * 仮想時間は次のイベントまで進む。
+ */
+void
+rx_util_wait(void)
+{
+	host_sim_wait();
+}
+
+/**
+ * 割り込みを許可する。
+ * 特権モード（スーパーバイザモード）でのみ使用できる。
+ */
+void
+rx_util_enable_interrupt(void)
+{
+	host_sim_set_psw(host_sim_get_psw() | CPU_PSW_I);
+}
+
+/**
+ * 割り込みを禁止する。
+ * 特権モード（スーパーバイザモード）でのみ使用できる。
+ */
+void
+rx_util_disable_interrupt(void)
+{
+	host_sim_set_psw(host_sim_get_psw() & ~CPU_PSW_I);
+}
+
+/**
+ * PSWレジスタの値を得る。
+ *
+ * @return PSWレジスタの値
+ */
+uint32_t
+rx_util_get_psw(void)
+{
+	return host_sim_get_psw();
+}
+
+/**
+ * PSWレジスタの値を設定する。
+ * ユーザーモードの場合、U, Iビットへの書き込みは無視される。
+ *
+ * @param psw PSWレジスタの値
+ */
+void
+rx_util_set_psw(uint32_t psw)
+{
+	host_sim_set_psw(psw);
+}
+
+/**
+ * 割り込みレベルを設定する。
+ * スーパーバイザモードでのみ使用できる。
+ *
+ * @param level 割り込みレベル(0～15)
+ */
+void
+rx_util_set_ipl(uint8_t level)
+{
+	host_sim_set_ipl(level);
+}
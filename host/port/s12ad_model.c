@@ -0,0 +1,244 @@
+/**
+ * @file 12bit A/Dコンバータ(S12AD, S12AD1)のモデル (ホストビルド用)
+ *       シングルスキャンモードのソフトウェアトリガだけを模擬する。
+ *
+ *       ADCSR.ADST=1を書き込むと、対象チャンネル毎に
+ *         サンプリングステート(ADSSTRn) + 逐次比較のステート(S12AD_MODEL_CONVERSION_STATES)
+ *       をADCLKで数えた時間の後に、入力(s12ad_model_set_source())の値をADDRnに入れ、ADSTを0にする。
+ *       逐次比較のステート数と、スキャン開始までの遅延を含めないことは近似になる。
+ *       自己診断モード(ADCER.DIAGM=1)では、1チャンネル分の時間でADRDに診断電圧の値を入れる。
+ * @author
+ */
+#include <stddef.h>
+#include <iodefine.h>
+#include "../../src/drv/board_config.h"
+#include "host_io.h"
+#include "host_sim.h"
+#include "periph_model.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/**
+ * A/D変換クロック(ADCLK = PCLKD)
+ * board.c のSCKCR設定(PCKD = PLL/8)による。
+ */
+#define S12AD_MODEL_ADCLK (PLL_CLOCK / 8)
+
+/**
+ * 1チャンネルの逐次比較にかかるステート数(概算)
+ */
+#define S12AD_MODEL_CONVERSION_STATES 20
+
+/**
+ * チャンネル数
+ */
+#define S12AD_NUM_CHANNELS  8
+#define S12AD1_NUM_CHANNELS 21
+
+/**
+ * A/Dコンバータのユニット
+ */
+struct s12ad_unit {
+	struct host_io_region region; /* レジスタ領域 */
+	struct host_sim_event event; /* スキャン終了 */
+	uint32_t scan_count; /* スキャンを終了した回数 */
+	uint8_t no; /* ユニット番号 */
+	uint8_t is_scanning; /* スキャン中かどうか */
+};
+
+static struct s12ad_unit Units[2];
+
+static volatile struct st_s12ad *S12ad;
+static volatile struct st_s12ad1 *S12ad1;
+
+/**
+ * 入力
+ */
+static s12ad_model_source_t Source;
+
+static uint32_t get_scan_states(const struct s12ad_unit *unit);
+static void scan_end_proc(struct host_sim_event *ev);
+static void s12ad_after_access(struct host_io_region *region, uint32_t offset, int is_write);
+static uint16_t get_diag_value(uint8_t diagval);
+static uint16_t default_source(uint8_t unit, uint8_t ch);
+
+
+/**
+ * A/Dコンバータのモデルを初期化する。
+ * 入力は、チャンネル毎に異なる固定値にする。
+ */
+void
+s12ad_model_init(void)
+{
+	S12ad = &HOST_IO_ALIAS(S12AD);
+	S12ad1 = &HOST_IO_ALIAS(S12AD1);
+	Source = default_source;
+
+	for (int i = 0; i < 2; i++) {
+		Units[i].no = (uint8_t)(i);
+		Units[i].is_scanning = 0;
+		Units[i].scan_count = 0;
+		Units[i].event.is_active = 0;
+	}
+	host_io_add_region(&(Units[0].region), (uintptr_t)(&S12AD), sizeof(S12AD),
+			NULL, s12ad_after_access, &(Units[0]));
+	host_io_add_region(&(Units[1].region), (uintptr_t)(&S12AD1), sizeof(S12AD1),
+			NULL, s12ad_after_access, &(Units[1]));
+}
+
+/**
+ * 入力を設定する。
+ *
+ * @param source 入力。NULLの場合は既定の固定値に戻す。
+ */
+void
+s12ad_model_set_source(s12ad_model_source_t source)
+{
+	Source = (source != NULL) ? source : default_source;
+}
+
+/**
+ * スキャンを終了した回数を得る。
+ *
+ * @param unit ユニット番号 (0: S12AD, 1: S12AD1)
+ * @return スキャンを終了した回数
+ */
+uint32_t
+s12ad_model_get_scan_count(uint8_t unit)
+{
+	return (unit < 2) ? Units[unit].scan_count : 0;
+}
+
+/**
+ * 1回のスキャンにかかるステート数を求める。
+ *
+ * @param unit ユニット
+ * @return ステート数(ADCLK)
+ */
+static uint32_t
+get_scan_states(const struct s12ad_unit *unit)
+{
+	uint32_t states = 0;
+
+	if (unit->no == 0) {
+		volatile const uint8_t *sstr = &(S12ad->ADSSTR0);
+		if (S12ad->ADCER.BIT.DIAGM) {
+			return sstr[0] + S12AD_MODEL_CONVERSION_STATES;
+		}
+		for (int ch = 0; ch < S12AD_NUM_CHANNELS; ch++) {
+			if ((S12ad->ADANSA0.WORD >> ch) & 1) {
+				states += sstr[ch] + S12AD_MODEL_CONVERSION_STATES;
+			}
+		}
+	} else {
+		volatile const uint8_t *sstr = &(S12ad1->ADSSTR0);
+		uint32_t ansa = S12ad1->ADANSA0.WORD | ((uint32_t)(S12ad1->ADANSA1.WORD) << 16);
+		if (S12ad1->ADCER.BIT.DIAGM) {
+			return sstr[0] + S12AD_MODEL_CONVERSION_STATES;
+		}
+		for (int ch = 0; ch < S12AD1_NUM_CHANNELS; ch++) {
+			if ((ansa >> ch) & 1) {
+				/* AN116～AN120はADSSTRLを共用する */
+				states += ((ch < 16) ? sstr[ch] : S12ad1->ADSSTRL) + S12AD_MODEL_CONVERSION_STATES;
+			}
+		}
+		if (S12ad1->ADEXICR.BIT.TSSA) {
+			states += S12ad1->ADSSTRT + S12AD_MODEL_CONVERSION_STATES;
+		}
+		if (S12ad1->ADEXICR.BIT.OCSA) {
+			states += S12ad1->ADSSTRO + S12AD_MODEL_CONVERSION_STATES;
+		}
+	}
+	return states;
+}
+
+/**
+ * スキャン終了
+ * 変換結果をデータレジスタに入れ、ADSTを0にする。
+ */
+static void
+scan_end_proc(struct host_sim_event *ev)
+{
+	struct s12ad_unit *unit = (ev == &(Units[0].event)) ? &(Units[0]) : &(Units[1]);
+
+	if (unit->no == 0) {
+		volatile uint16_t *addr = &(S12ad->ADDR0);
+		if (S12ad->ADCER.BIT.DIAGM) {
+			S12ad->ADRD.WORD = get_diag_value(S12ad->ADCER.BIT.DIAGVAL);
+		} else {
+			for (uint8_t ch = 0; ch < S12AD_NUM_CHANNELS; ch++) {
+				if ((S12ad->ADANSA0.WORD >> ch) & 1) {
+					addr[ch] = Source(0, ch) & 0xFFF;
+				}
+			}
+		}
+		S12ad->ADCSR.BIT.ADST = 0;
+	} else {
+		volatile uint16_t *addr = &(S12ad1->ADDR0);
+		uint32_t ansa = S12ad1->ADANSA0.WORD | ((uint32_t)(S12ad1->ADANSA1.WORD) << 16);
+		if (S12ad1->ADCER.BIT.DIAGM) {
+			S12ad1->ADRD.WORD = get_diag_value(S12ad1->ADCER.BIT.DIAGVAL);
+		} else {
+			for (uint8_t ch = 0; ch < S12AD1_NUM_CHANNELS; ch++) {
+				if ((ansa >> ch) & 1) {
+					addr[ch] = Source(1, ch) & 0xFFF;
+				}
+			}
+			if (S12ad1->ADEXICR.BIT.TSSA) {
+				S12ad1->ADTSDR = Source(1, S12AD_MODEL_CH_TEMP) & 0xFFF;
+			}
+			if (S12ad1->ADEXICR.BIT.OCSA) {
+				S12ad1->ADOCDR = Source(1, S12AD_MODEL_CH_OCS) & 0xFFF;
+			}
+		}
+		S12ad1->ADCSR.BIT.ADST = 0;
+	}
+	unit->is_scanning = 0;
+	unit->scan_count++;
+}
+
+/**
+ * ADCSRへの書き込みで、スキャンを開始/停止する。
+ */
+static void
+s12ad_after_access(struct host_io_region *region, uint32_t offset, int is_write)
+{
+	struct s12ad_unit *unit = (struct s12ad_unit *)(region->arg);
+
+	if (!is_write || ((offset & ~1U) != offsetof(struct st_s12ad, ADCSR))) {
+		return ;
+	}
+	uint8_t adst = (unit->no == 0) ? S12ad->ADCSR.BIT.ADST : S12ad1->ADCSR.BIT.ADST;
+	if (adst && !unit->is_scanning) {
+		uint64_t nsec = (get_scan_states(unit) * NSEC_PER_SEC + S12AD_MODEL_ADCLK - 1) / S12AD_MODEL_ADCLK;
+		unit->is_scanning = 1;
+		host_sim_add_event(&(unit->event), host_sim_get_time() + nsec, scan_end_proc);
+	} else if (!adst && unit->is_scanning) {
+		unit->is_scanning = 0;
+		host_sim_remove_event(&(unit->event));
+	}
+}
+
+/**
+ * 自己診断の結果を得る。
+ * b15-b14に診断電圧の種類、b11-b0に変換値を入れる。
+ *
+ * @param diagval ADCER.DIAGVAL (1: 0V, 2: VREFH0 x 1/2, 3: VREFH0)
+ * @return ADRDの値
+ */
+static uint16_t
+get_diag_value(uint8_t diagval)
+{
+	static const uint16_t values[] = { 0x000, 0x000, 0x800, 0xFFF };
+	return (uint16_t)(((uint16_t)(diagval & 3) << 14) | values[diagval & 3]);
+}
+
+/**
+ * 既定の入力
+ * ユニットとチャンネル毎に異なる固定値を返す。
+ */
+static uint16_t
+default_source(uint8_t unit, uint8_t ch)
+{
+	return (uint16_t)(0x400 + (unit * 0x100) + (ch * 0x10));
+}
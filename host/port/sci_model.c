@@ -0,0 +1,346 @@
+/**
+ * @file SCI(シリアルコミュニケーションインタフェース)のモデル (ホストビルド用)
+ *       src/drv/sci/sci.c が使用するSCI5, SCI9の調歩同期式モードを模擬する。
+ *
+ *       送信: TE=1でTDRに書き込むと、TSRが空いていればすぐにTSRへ転送し、TIE=1であればTXIを要求する。
+ *             1フレームの時間が経過すると送信先に1バイト渡し、TDRにデータがあれば続けて転送する。
+ *             無ければSSR.TENDを1にする。
+ *       受信: sci_model_inject()で与えたデータを1フレーム毎にRDRに入れ、RIE=1であればRXIを要求する。
+ *             RDRを読み出す前に次のデータを受信した場合は、SSR.ORERを1にしてデータを捨てる。
+ *             RE=0の間に届いたデータは捨てる。
+ * @author
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <iodefine.h>
+#include "../../src/drv/board_config.h"
+#include "host_io.h"
+#include "host_sim.h"
+#include "periph_model.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/**
+ * 受信待ちデータのバッファサイズ
+ */
+#define SCI_MODEL_RX_QUEUE_SIZE 1024
+
+/**
+ * SCIのチャンネル
+ */
+struct sci_channel {
+	struct host_io_region region; /* レジスタ領域 */
+	struct host_sim_event tx_event; /* 送信フレームの終了 */
+	struct host_sim_event rx_event; /* 受信フレームの終了 */
+	volatile struct st_sci0 *regs; /* レジスタ(別名) */
+	sci_model_sink_t sink; /* 送信先 */
+	struct sci_model_stats stats; /* 統計 */
+	uint8_t rx_queue[SCI_MODEL_RX_QUEUE_SIZE]; /* 受信待ちデータ */
+	uint16_t rx_in; /* 受信待ちデータの書き込み位置 */
+	uint16_t rx_count; /* 受信待ちデータの数 */
+	uint8_t no; /* SCIの番号 */
+	uint8_t txi_vect; /* TXIのベクタ番号 */
+	uint8_t rxi_vect; /* RXIのベクタ番号 */
+	uint8_t tsr; /* 送信中のデータ */
+	uint8_t is_tdr_full; /* TDRに送信待ちのデータがあるかどうか */
+	uint8_t is_tsr_busy; /* 送信中かどうか */
+	uint8_t is_rdr_full; /* RDRに未読のデータがあるかどうか */
+};
+
+static struct sci_channel Channels[2];
+
+static struct sci_channel *get_channel(uint8_t sci_no);
+static uint64_t get_frame_nsec(const struct sci_channel *ch);
+static void start_tx(struct sci_channel *ch);
+static void tx_end_proc(struct host_sim_event *ev);
+static void rx_end_proc(struct host_sim_event *ev);
+static void sci_before_access(struct host_io_region *region, uint32_t offset, int is_write);
+static void sci_after_access(struct host_io_region *region, uint32_t offset, int is_write);
+static void stdout_sink(uint8_t sci_no, uint8_t data);
+
+
+/**
+ * SCIのモデルを初期化する。
+ * SCI9(デバッグ用)の送信先は標準出力、SCI5の送信先は無し(統計だけ数える)にする。
+ */
+void
+sci_model_init(void)
+{
+	Channels[0].regs = &HOST_IO_ALIAS(SCI5);
+	Channels[0].no = 5;
+	Channels[0].txi_vect = VECT(SCI5, TXI5);
+	Channels[0].rxi_vect = VECT(SCI5, RXI5);
+	Channels[0].sink = NULL;
+	Channels[1].regs = &HOST_IO_ALIAS(SCI9);
+	Channels[1].no = 9;
+	Channels[1].txi_vect = VECT(SCI9, TXI9);
+	Channels[1].rxi_vect = VECT(SCI9, RXI9);
+	Channels[1].sink = stdout_sink;
+
+	for (int i = 0; i < 2; i++) {
+		struct sci_channel *ch = &(Channels[i]);
+		ch->tx_event.is_active = 0;
+		ch->rx_event.is_active = 0;
+		ch->stats.tx_bytes = 0;
+		ch->stats.rx_bytes = 0;
+		ch->stats.overruns = 0;
+		ch->rx_in = 0;
+		ch->rx_count = 0;
+		ch->is_tdr_full = 0;
+		ch->is_tsr_busy = 0;
+		ch->is_rdr_full = 0;
+		/* リセット値 */
+		ch->regs->BRR = 0xFF;
+		ch->regs->SSR.BYTE = 0x84;
+		ch->regs->SCMR.BYTE = 0xF2;
+	}
+	host_io_add_region(&(Channels[0].region), (uintptr_t)(&SCI5), sizeof(SCI5),
+			sci_before_access, sci_after_access, &(Channels[0]));
+	host_io_add_region(&(Channels[1].region), (uintptr_t)(&SCI9), sizeof(SCI9),
+			sci_before_access, sci_after_access, &(Channels[1]));
+}
+
+/**
+ * 送信先を設定する。
+ *
+ * @param sci_no SCIの番号 (5, 9)
+ * @param sink 送信先。NULLの場合は捨てる。
+ */
+void
+sci_model_set_sink(uint8_t sci_no, sci_model_sink_t sink)
+{
+	struct sci_channel *ch = get_channel(sci_no);
+	if (ch != NULL) {
+		ch->sink = sink;
+	}
+}
+
+/**
+ * 受信データを与える。
+ * 前に与えたデータに続けて、1フレームの時間毎に受信する。
+ *
+ * @param sci_no SCIの番号 (5, 9)
+ * @param data データ
+ * @param len データの長さ
+ * @return 受け付けたバイト数。バッファに入りきらない分は捨てる。
+ */
+int
+sci_model_inject(uint8_t sci_no, const uint8_t *data, uint16_t len)
+{
+	struct sci_channel *ch = get_channel(sci_no);
+	int count = 0;
+
+	if (ch == NULL) {
+		return -1;
+	}
+	while ((count < len) && (ch->rx_count < SCI_MODEL_RX_QUEUE_SIZE)) {
+		ch->rx_queue[ch->rx_in] = data[count];
+		ch->rx_in = (ch->rx_in + 1) % SCI_MODEL_RX_QUEUE_SIZE;
+		ch->rx_count++;
+		count++;
+	}
+	if ((ch->rx_count > 0) && !ch->rx_event.is_active) {
+		host_sim_add_event(&(ch->rx_event), host_sim_get_time() + get_frame_nsec(ch), rx_end_proc);
+	}
+	return count;
+}
+
+/**
+ * 送信中かどうかを得る。
+ *
+ * @param sci_no SCIの番号 (5, 9)
+ * @return TDRまたはTSRにデータがある場合は1、それ以外は0
+ */
+int
+sci_model_is_busy(uint8_t sci_no)
+{
+	struct sci_channel *ch = get_channel(sci_no);
+	return (ch != NULL) && (ch->is_tdr_full || ch->is_tsr_busy);
+}
+
+/**
+ * 統計を得る。
+ *
+ * @param sci_no SCIの番号 (5, 9)
+ * @param stats 統計を格納する領域
+ */
+void
+sci_model_get_stats(uint8_t sci_no, struct sci_model_stats *stats)
+{
+	struct sci_channel *ch = get_channel(sci_no);
+	if (ch != NULL) {
+		*stats = ch->stats;
+	}
+}
+
+/**
+ * 現在の設定での1フレームの時間を得る。
+ *
+ * @param sci_no SCIの番号 (5, 9)
+ * @return 1フレームの時間[ナノ秒]
+ */
+uint32_t
+sci_model_get_frame_nsec(uint8_t sci_no)
+{
+	struct sci_channel *ch = get_channel(sci_no);
+	return (ch != NULL) ? (uint32_t)(get_frame_nsec(ch)) : 0;
+}
+
+/**
+ * SCIの番号に対応するチャンネルを得る。
+ *
+ * @param sci_no SCIの番号
+ * @return チャンネル。模擬していない場合はNULL
+ */
+static struct sci_channel *
+get_channel(uint8_t sci_no)
+{
+	for (int i = 0; i < 2; i++) {
+		if (Channels[i].no == sci_no) {
+			return &(Channels[i]);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * 1フレームの時間を求める。
+ * ビットレート B = PCLKB / (64 * 2^(2n-1) * (N+1)) (ABCS=1, BGDM=1の場合はそれぞれ2倍)
+ * フレームはスタートビット、データ(7/8/9ビット)、パリティ、ストップビット(1/2)からなる。
+ *
+ * @param ch チャンネル
+ * @return 1フレームの時間[ナノ秒]
+ */
+static uint64_t
+get_frame_nsec(const struct sci_channel *ch)
+{
+	volatile struct st_sci0 *sci = ch->regs;
+	uint64_t divider = 32ULL << (sci->SMR.BIT.CKS * 2);
+	if (sci->SEMR.BIT.ABCS) {
+		divider /= 2;
+	}
+	if (sci->SEMR.BIT.BGDM) {
+		divider /= 2;
+	}
+
+	uint32_t bits = 1;
+	if (sci->SCMR.BIT.CHR1 == 0) {
+		bits += 9;
+	} else {
+		bits += (sci->SMR.BIT.CHR != 0) ? 7 : 8;
+	}
+	bits += (sci->SMR.BIT.PE != 0) ? 1 : 0;
+	bits += (sci->SMR.BIT.STOP != 0) ? 2 : 1;
+
+	return (bits * divider * (sci->BRR + 1ULL) * NSEC_PER_SEC) / PCLKB_CLOCK;
+}
+
+/**
+ * TDRのデータをTSRに転送して送信を開始する。
+ *
+ * @param ch チャンネル
+ */
+static void
+start_tx(struct sci_channel *ch)
+{
+	ch->tsr = ch->regs->TDR;
+	ch->is_tdr_full = 0;
+	ch->is_tsr_busy = 1;
+	ch->regs->SSR.BIT.TDRE = 1;
+	ch->regs->SSR.BIT.TEND = 0;
+	host_sim_add_event(&(ch->tx_event), host_sim_get_time() + get_frame_nsec(ch), tx_end_proc);
+	if (ch->regs->SCR.BIT.TIE) {
+		host_sim_raise_irq(ch->txi_vect);
+	}
+}
+
+/**
+ * 送信フレームの終了
+ */
+static void
+tx_end_proc(struct host_sim_event *ev)
+{
+	struct sci_channel *ch = (ev == &(Channels[0].tx_event)) ? &(Channels[0]) : &(Channels[1]);
+
+	ch->is_tsr_busy = 0;
+	ch->stats.tx_bytes++;
+	if (ch->sink != NULL) {
+		ch->sink(ch->no, ch->tsr);
+	}
+	if (ch->is_tdr_full && ch->regs->SCR.BIT.TE) {
+		start_tx(ch);
+	} else {
+		ch->regs->SSR.BIT.TEND = 1;
+	}
+}
+
+/**
+ * 受信フレームの終了
+ */
+static void
+rx_end_proc(struct host_sim_event *ev)
+{
+	struct sci_channel *ch = (ev == &(Channels[0].rx_event)) ? &(Channels[0]) : &(Channels[1]);
+	uint16_t out = (ch->rx_in + SCI_MODEL_RX_QUEUE_SIZE - ch->rx_count) % SCI_MODEL_RX_QUEUE_SIZE;
+	uint8_t data = ch->rx_queue[out];
+
+	ch->rx_count--;
+	if (ch->regs->SCR.BIT.RE) {
+		if (ch->is_rdr_full) {
+			ch->regs->SSR.BIT.ORER = 1;
+			ch->stats.overruns++;
+		} else {
+			ch->regs->RDR = data;
+			ch->is_rdr_full = 1;
+			ch->regs->SSR.BIT.RDRF = 1;
+			ch->stats.rx_bytes++;
+			if (ch->regs->SCR.BIT.RIE) {
+				host_sim_raise_irq(ch->rxi_vect);
+			}
+		}
+	}
+	if (ch->rx_count > 0) {
+		host_sim_add_event(&(ch->rx_event), ev->time + get_frame_nsec(ch), rx_end_proc);
+	}
+}
+
+/**
+ * RDRの読み出しで、未読のデータを読み出し済みにする。
+ */
+static void
+sci_before_access(struct host_io_region *region, uint32_t offset, int is_write)
+{
+	struct sci_channel *ch = (struct sci_channel *)(region->arg);
+
+	if (!is_write && (offset == offsetof(struct st_sci0, RDR))) {
+		ch->is_rdr_full = 0;
+		ch->regs->SSR.BIT.RDRF = 0;
+	}
+}
+
+/**
+ * TDRへの書き込みで、送信を開始する。
+ */
+static void
+sci_after_access(struct host_io_region *region, uint32_t offset, int is_write)
+{
+	struct sci_channel *ch = (struct sci_channel *)(region->arg);
+
+	if (!is_write || (offset != offsetof(struct st_sci0, TDR)) || !ch->regs->SCR.BIT.TE) {
+		return ;
+	}
+	ch->is_tdr_full = 1;
+	ch->regs->SSR.BIT.TDRE = 0;
+	if (!ch->is_tsr_busy) {
+		start_tx(ch);
+	}
+}
+
+/**
+ * 標準出力に書き出す送信先
+ */
+static void
+stdout_sink(uint8_t sci_no, uint8_t data)
+{
+	putchar(data);
+}
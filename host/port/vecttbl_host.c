@@ -0,0 +1,49 @@
+/**
+ * @file 割り込みベクタテーブル (ホストビルド用)
+ *       RXではCC-RXが #pragma interrupt の指定から可変ベクタテーブルを作るが、
+ *       ホストではドライバの割り込みハンドラをここでhost_simに登録する。
+ *       ソフトウェア割り込み(SWINT)は kernel_port_host.c で登録する。
+ * @author
+ */
+#include <iodefine.h>
+#include "host_sim.h"
+
+/* src/drv/cmt/cmt.c */
+void Excep_CMT0_CMI0(void);
+void Excep_CMT1_CMI1(void);
+/* src/drv/sci/sci.c */
+void INT_Excep_SCI5_TXI5(void);
+void INT_Excep_SCI5_RXI5(void);
+void INT_Excep_SCI9_TXI9(void);
+void INT_Excep_SCI9_RXI9(void);
+
+/**
+ * ベクタテーブルのエントリ
+ */
+struct vector_entry {
+	uint8_t vect; /* ベクタ番号 */
+	uint8_t ipr; /* IPRレジスタの番号 */
+	host_sim_isr_t isr; /* 割り込みハンドラ */
+	const char *name; /* 名前 */
+};
+
+static const struct vector_entry VectorTable[] = {
+	{ VECT(CMT0, CMI0), IPR_CMT0_CMI0, Excep_CMT0_CMI0, "CMT0_CMI0" },
+	{ VECT(CMT1, CMI1), IPR_CMT1_CMI1, Excep_CMT1_CMI1, "CMT1_CMI1" },
+	{ VECT(SCI5, RXI5), IPR_SCI5_RXI5, INT_Excep_SCI5_RXI5, "SCI5_RXI5" },
+	{ VECT(SCI5, TXI5), IPR_SCI5_TXI5, INT_Excep_SCI5_TXI5, "SCI5_TXI5" },
+	{ VECT(SCI9, RXI9), IPR_SCI9_RXI9, INT_Excep_SCI9_RXI9, "SCI9_RXI9" },
+	{ VECT(SCI9, TXI9), IPR_SCI9_TXI9, INT_Excep_SCI9_TXI9, "SCI9_TXI9" },
+};
+
+/**
+ * ドライバの割り込みハンドラを登録する。
+ */
+void
+host_vecttbl_init(void)
+{
+	for (unsigned int i = 0; i < sizeof(VectorTable) / sizeof(VectorTable[0]); i++) {
+		const struct vector_entry *e = &(VectorTable[i]);
+		host_sim_set_vector(e->vect, e->ipr, e->isr, e->name);
+	}
+}
@@ -0,0 +1,96 @@
+/**
+ * @file 静的コンフィギュレーションのデモ (ホストビルド用)
+ *       host_main.c と同じタスク構成を、host/static_demo.cfg から tools/gen_kernel_static.py で
+ *       生成した初期化済みデータで動かす。タスクの登録とオブジェクトの初期化は行わない。
+ *       KERNEL_STATIC_CONFIG=1 でビルドしたカーネルとリンクする。
+ */
+#include <stdio.h>
+#include "../src/drv/sci/sci.h"
+#include "../src/drv/cmt/cmt.h"
+#include "../src/rx_utils/rx_utils.h"
+
+#include "../src/os/kernel.h"
+#include "../src/os/kernel_api.h"
+#include "port/host_sim.h"
+#include "port/periph_model.h"
+
+/*
+ * タスクの関数とSem, Mutexは static_demo.cfg に書いたもの。
+ * 関数は生成したデータから参照するため、staticにしない。
+ */
+void task1(void *arg);
+void task2(void *arg);
+void task3(void *arg);
+
+
+void
+task1(void *arg)
+{
+	mutex_lock(&Mutex);
+	const char *name = (const char*)(arg);
+	for (int i = 0; i < 10; i++) {
+		sem_wait(&Sem);
+		rx_debug("%s\n", name);
+	}
+	mutex_unlock(&Mutex);
+
+	return ;
+}
+
+void
+task2(void *arg)
+{
+	const char *name = (const char*)(arg);
+
+	mutex_lock(&Mutex);
+	for (int i = 0; i < 5; i++) {
+		sem_wait(&Sem);
+		rx_debug("%s\n", name);
+	}
+	mutex_unlock(&Mutex);
+
+	return ;
+}
+
+void
+task3(void *arg)
+{
+	const char *name = (const char*)(arg);
+	rx_debug("%s\n", name);
+
+	while (kernel_task_is_alive(KERNEL_STATIC_ID_task1) || kernel_task_is_alive(KERNEL_STATIC_ID_task2)) {
+		sleep(1000);
+		rx_debug("%s post one.\n", name);
+		sem_post(&Sem);
+	}
+
+	rx_debug("%s exit.\n", name);
+}
+
+int
+main(void)
+{
+	host_sim_init();
+	drv_cmt_init();
+	drv_sci_init();
+
+	kernel_init();
+
+	rx_debug("-----------------------\n");
+	kernel_start_scheduler();
+
+	kernel_report_stats();
+	rx_debug("-----------------------\n");
+	rx_debug("elapsed %u ms\n", drv_cmt_get_counter());
+
+	/* デバッグ出力(SCI9)の送信が終わるまで待つ */
+	while (sci_model_is_busy(9)) {
+		rx_util_wait();
+	}
+	host_sim_report_vector_stats();
+
+	drv_sci_destroy();
+	drv_cmt_destroy();
+
+	return 0;
+}
@@ -0,0 +1,481 @@
+/**
+ * @file カーネルのベンチマーク
+ *       項目毎にタスクを登録してスケジューラを実行し、タスクが全て終了したら次の項目に進む。
+ *       計測中はrx_debug()を呼ばず(SCIの送信割り込みが入るため)、結果は最後にまとめて出力する。
+ *
+ *       計測区間は次の通り。
+ *         - counter         : カウンタを連続して2回読み出す間
+ *         - yield           : yield()を呼ぶ直前から、切り替え先のタスクでyield()から戻るまで
+ *         - sem ping-pong   : sem_post()で相手を起こし、相手のsem_post()でsem_wait()から戻るまで
+ *         - mutex           : 競合の無い mutex_lock(), mutex_unlock() の組
+ *         - mutex contended : 低プライオリティのタスクがmutex_unlock()を呼ぶ直前から、
+ *                             待っていた高プライオリティのタスクでmutex_lock()から戻るまで
+ *         - isr to task     : 割り込みハンドラでsem_post_from_isr()を呼ぶ直前から、
+ *                             待っていたタスクでsem_wait()から戻るまで
+ *                             (RXはCMT1のタイマー、ホストはレジスタにアクセスしない模擬割り込み)
+ *                             低プライオリティのタスクがビジーループで動き続け、アイドルからの
+ *                             復帰(ティックレスの終了処理)を含まない、タスクのプリエンプトを計測する。
+ *         - message         : 同じプライオリティのタスク間でメッセージを送受信した時の、
+ *                             KERNEL_BENCH_MQ_CAPACITY 個毎の受信間隔を個数で割った値
+ *         - dispatch (N)    : yield と同じ区間を、低いプライオリティのタスクを加えて
+ *                             N個のタスクが実行可能な状態で計測する。
+ *                             タスク数によらず一定であれば、スケジューラのタスク選択はO(1)になっている。
+ *                             MAX_TASKS に収まらないタスク数は計測しない。
+ *
+ *       タイマー割り込み(1ms毎のティックとCMT1)が計測区間に入った場合、その分は最大値に表れる。
+ *       比較には最小値と平均値を使うこと。
+ * @author
+ */
+#include "kernel_bench.h"
+#include "../drv/cmt/cmt.h"
+#include "../rx_utils/rx_utils.h"
+#include "../rx_utils/error_code.h"
+#include "../os/kernel.h"
+#include "../os/kernel_api.h"
+
+/**
+ * メッセージキューの容量
+ */
+#define KERNEL_BENCH_MQ_CAPACITY 16
+
+/**
+ * ベンチマーク用タスクのスタックサイズ
+ */
+#define KERNEL_BENCH_STACK_SIZE 128
+
+/**
+ * dispatch で加えるタスクのスタックサイズ
+ * 何もせずに終了するので、初期コンテキストが入る大きさにする。
+ */
+#define KERNEL_BENCH_FILLER_STACK_SIZE 64
+
+/**
+ * dispatch で加えるタスクのプライオリティの種類数
+ * 0～(KERNEL_BENCH_FILLER_PRIORITIES - 1) に分散させ、計測するタスク(10)より低くする。
+ */
+#define KERNEL_BENCH_FILLER_PRIORITIES 10
+
+/**
+ * 結果を1行出力する毎に待つ時間[ミリ秒]
+ * デバッグ出力の送信FIFOが溢れて、後の行が欠けないようにする。
+ */
+#define KERNEL_BENCH_REPORT_INTERVAL 10
+
+static stack_type_t BenchStack1[KERNEL_BENCH_STACK_SIZE];
+static stack_type_t BenchStack2[KERNEL_BENCH_STACK_SIZE];
+#if MAX_TASKS > 2
+static stack_type_t FillerStacks[MAX_TASKS - 2][KERNEL_BENCH_FILLER_STACK_SIZE];
+#endif
+
+static struct kernel_bench_result Results[KERNEL_BENCH_NUM_ITEMS];
+
+static const char *const ItemNames[KERNEL_BENCH_NUM_ITEMS] = {
+	"counter",
+	"yield",
+	"sem ping-pong",
+	"mutex",
+	"mutex contended",
+	"isr to task",
+	"message",
+	"dispatch (8)",
+	"dispatch (32)",
+	"dispatch (128)",
+};
+
+/**
+ * dispatch の項目毎のタスク数
+ */
+static const uint16_t DispatchTaskCounts[] = { 8, 32, 128 };
+
+static struct semaphore SemA;
+static struct semaphore SemB;
+static struct mutex Mutex;
+static struct message_queue Mq;
+static void *MqBuffer[KERNEL_BENCH_MQ_CAPACITY];
+
+/**
+ * 計測区間の開始時刻
+ * 開始するタスク(または割り込みハンドラ)と、終了するタスクが異なる項目で使用する。
+ */
+static volatile uint32_t Stamp;
+static volatile uint8_t IsStampValid;
+
+/**
+ * タスクがタイマー割り込みからのポストを待っているかどうか
+ */
+static volatile uint8_t IsIsrWaiting;
+
+/**
+ * isr to task の計測が終わったかどうか
+ */
+static volatile uint8_t IsIsrDone;
+
+/**
+ * yield_task()が記録する項目
+ */
+static uint8_t YieldItem;
+
+static void record(uint8_t item, uint32_t cycles);
+static void run_tasks(task_func_t func1, uint16_t priority1,
+		task_func_t func2, uint16_t priority2);
+
+static void bench_counter(void);
+static void yield_task(void *arg);
+static void pingpong_task(void *arg);
+static void pingpong_echo_task(void *arg);
+static void mutex_task(void *arg);
+static void mutex_high_task(void *arg);
+static void mutex_low_task(void *arg);
+static void isr_task(void *arg);
+static void isr_busy_task(void *arg);
+static void isr_timer_proc(uint32_t elapse_millis);
+static void mq_send_task(void *arg);
+static void mq_receive_task(void *arg);
+static void bench_dispatch(uint8_t item, uint16_t num_tasks);
+static void filler_task(void *arg);
+
+
+/**
+ * 全項目を計測し、結果を出力する。
+ * kernel_init()の後、スケジューラを実行していない状態で呼び出すこと。
+ * RXでは、isr to task の計測でTIMER_2を使用する。
+ */
+void
+kernel_bench_run(void)
+{
+	for (uint8_t i = 0; i < KERNEL_BENCH_NUM_ITEMS; i++) {
+		Results[i].name = ItemNames[i];
+		Results[i].count = 0;
+		Results[i].min = 0;
+		Results[i].max = 0;
+		Results[i].total = 0;
+	}
+
+	bench_counter();
+
+	IsStampValid = 0;
+	YieldItem = KERNEL_BENCH_YIELD;
+	run_tasks(yield_task, 10, yield_task, 10);
+
+	sem_init(&SemA, 0);
+	sem_init(&SemB, 0);
+	run_tasks(pingpong_task, 10, pingpong_echo_task, 10);
+	sem_destroy(&SemB);
+	sem_destroy(&SemA);
+
+	mutex_init(&Mutex);
+	run_tasks(mutex_task, 10, NULL, 0);
+	mutex_destroy(&Mutex);
+
+	sem_init(&SemA, 0);
+	mutex_init(&Mutex);
+	run_tasks(mutex_high_task, 11, mutex_low_task, 10);
+	mutex_destroy(&Mutex);
+	sem_destroy(&SemA);
+
+	sem_init(&SemA, 0);
+	IsIsrWaiting = 0;
+	IsIsrDone = 0;
+	KERNEL_BENCH_START_ISR(isr_timer_proc);
+	run_tasks(isr_task, 10, isr_busy_task, 9);
+	KERNEL_BENCH_STOP_ISR();
+	sem_destroy(&SemA);
+
+	mq_init(&Mq, MqBuffer, KERNEL_BENCH_MQ_CAPACITY);
+	run_tasks(mq_send_task, 10, mq_receive_task, 10);
+	mq_destroy(&Mq);
+
+	for (uint8_t i = 0; i < sizeof(DispatchTaskCounts) / sizeof(DispatchTaskCounts[0]); i++) {
+		bench_dispatch((uint8_t)(KERNEL_BENCH_DISPATCH_8 + i), DispatchTaskCounts[i]);
+	}
+
+	kernel_bench_report();
+}
+
+/**
+ * 計測結果を得る。
+ *
+ * @param item 計測項目 (KERNEL_BENCH_xを指定する)
+ * @param result 計測結果を格納する領域
+ * @return 成功した場合には0、itemが不正な場合にはERR_INVAL。
+ */
+int
+kernel_bench_get_result(uint8_t item, struct kernel_bench_result *result)
+{
+	if ((item >= KERNEL_BENCH_NUM_ITEMS) || (result == NULL)) {
+		return ERR_INVAL;
+	}
+	*result = Results[item];
+
+	return 0;
+}
+
+/**
+ * 計測結果をrx_debug()で出力する。
+ * 値はサイクル数。計測しなかった項目は skipped と出力する。
+ */
+void
+kernel_bench_report(void)
+{
+	for (uint8_t i = 0; i < KERNEL_BENCH_NUM_ITEMS; i++) {
+		const struct kernel_bench_result *r = &(Results[i]);
+		if (r->count == 0) {
+			rx_debug("kbench: %s: skipped\n", r->name);
+		} else {
+			uint32_t avg = (uint32_t)(r->total / r->count);
+			rx_debug("kbench: %s: min %u avg %u max %u (n=%u)\n",
+					r->name, r->min, avg, r->max, r->count);
+		}
+		drv_cmt_delay_ms(KERNEL_BENCH_REPORT_INTERVAL);
+	}
+}
+
+/**
+ * 計測値を集計する。
+ *
+ * @param item 計測項目
+ * @param cycles 計測値[サイクル]
+ */
+static void
+record(uint8_t item, uint32_t cycles)
+{
+	struct kernel_bench_result *r = &(Results[item]);
+
+	if ((r->count == 0) || (cycles < r->min)) {
+		r->min = cycles;
+	}
+	if (cycles > r->max) {
+		r->max = cycles;
+	}
+	r->total += cycles;
+	r->count++;
+}
+
+/**
+ * タスクを登録してスケジューラを実行し、全てのタスクが終了するまで待つ。
+ *
+ * @param func1 1つ目のタスク
+ * @param priority1 1つ目のタスクのプライオリティ
+ * @param func2 2つ目のタスク。NULLの場合は登録しない。
+ * @param priority2 2つ目のタスクのプライオリティ
+ */
+static void
+run_tasks(task_func_t func1, uint16_t priority1,
+		task_func_t func2, uint16_t priority2)
+{
+	kernel_register_task(priority1, func1, NULL, BenchStack1, sizeof(BenchStack1));
+	if (func2 != NULL) {
+		kernel_register_task(priority2, func2, NULL, BenchStack2, sizeof(BenchStack2));
+	}
+	kernel_start_scheduler();
+}
+
+/**
+ * カウンタの読み出しにかかる時間を計測する。
+ * 他の項目の値は、この時間を含んでいる。
+ */
+static void
+bench_counter(void)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		uint32_t start = KERNEL_BENCH_GET_CYCLES();
+		uint32_t end = KERNEL_BENCH_GET_CYCLES();
+		record(KERNEL_BENCH_COUNTER, end - start);
+	}
+}
+
+/**
+ * yield
+ * 同じプライオリティの2つのタスクで交互にyield()し、切り替え毎に計測する。
+ */
+static void
+yield_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS / 2; i++) {
+		uint32_t now = KERNEL_BENCH_GET_CYCLES();
+		if (IsStampValid) {
+			record(YieldItem, now - Stamp);
+		}
+		IsStampValid = 1;
+		Stamp = KERNEL_BENCH_GET_CYCLES();
+		yield();
+	}
+	IsStampValid = 0;
+}
+
+/**
+ * sem ping-pong (計測する側)
+ */
+static void
+pingpong_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		uint32_t start = KERNEL_BENCH_GET_CYCLES();
+		sem_post(&SemA);
+		sem_wait(&SemB);
+		record(KERNEL_BENCH_SEM_PINGPONG, KERNEL_BENCH_GET_CYCLES() - start);
+	}
+}
+
+/**
+ * sem ping-pong (応答する側)
+ */
+static void
+pingpong_echo_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		sem_wait(&SemA);
+		sem_post(&SemB);
+	}
+}
+
+/**
+ * mutex
+ */
+static void
+mutex_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		uint32_t start = KERNEL_BENCH_GET_CYCLES();
+		mutex_lock(&Mutex);
+		mutex_unlock(&Mutex);
+		record(KERNEL_BENCH_MUTEX, KERNEL_BENCH_GET_CYCLES() - start);
+	}
+}
+
+/**
+ * mutex contended (高プライオリティ側)
+ * 低プライオリティのタスクがロックしている間にロックを試みて待ち、
+ * アンロックされてから動き出すまでを計測する。
+ */
+static void
+mutex_high_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		sem_wait(&SemA);
+		mutex_lock(&Mutex);
+		record(KERNEL_BENCH_MUTEX_CONTENDED, KERNEL_BENCH_GET_CYCLES() - Stamp);
+		mutex_unlock(&Mutex);
+	}
+}
+
+/**
+ * mutex contended (低プライオリティ側)
+ */
+static void
+mutex_low_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		mutex_lock(&Mutex);
+		sem_post(&SemA); /* 高プライオリティのタスクが動き、ロックを待つ */
+		Stamp = KERNEL_BENCH_GET_CYCLES();
+		mutex_unlock(&Mutex);
+	}
+}
+
+/**
+ * isr to task
+ */
+static void
+isr_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		IsIsrWaiting = 1;
+		sem_wait(&SemA);
+		record(KERNEL_BENCH_ISR_TO_TASK, KERNEL_BENCH_GET_CYCLES() - Stamp);
+	}
+	IsIsrDone = 1;
+}
+
+/**
+ * isr to task で、待っているタスクの代わりに動き続けるタスク
+ */
+static void
+isr_busy_task(void *arg)
+{
+	while (!IsIsrDone) {
+		KERNEL_BENCH_SPIN();
+	}
+}
+
+/**
+ * isr to task の割り込みハンドラ
+ * (RXはCMT1の割り込みハンドラ、ホストはkernel_bench_host.cの割り込みハンドラから呼ばれる)
+ * タスクが待っている時だけポストする。
+ */
+static void
+isr_timer_proc(uint32_t elapse_millis)
+{
+	if (IsIsrWaiting) {
+		IsIsrWaiting = 0;
+		Stamp = KERNEL_BENCH_GET_CYCLES();
+		sem_post_from_isr(&SemA);
+	}
+}
+
+/**
+ * message (送信側)
+ */
+static void
+mq_send_task(void *arg)
+{
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		mq_send(&Mq, (void *)((uintptr_t)(i)));
+	}
+}
+
+/**
+ * message (受信側)
+ */
+static void
+mq_receive_task(void *arg)
+{
+	uint32_t last = 0;
+
+	for (int i = 0; i < KERNEL_BENCH_ITERATIONS; i++) {
+		void *msg;
+		mq_receive(&Mq, &msg);
+		if ((i % KERNEL_BENCH_MQ_CAPACITY) == (KERNEL_BENCH_MQ_CAPACITY - 1)) {
+			uint32_t now = KERNEL_BENCH_GET_CYCLES();
+			if (i >= KERNEL_BENCH_MQ_CAPACITY) {
+				record(KERNEL_BENCH_MESSAGE, (now - last) / KERNEL_BENCH_MQ_CAPACITY);
+			}
+			last = now;
+		}
+	}
+}
+
+/**
+ * dispatch
+ * 計測する2つのタスク(プライオリティ10)に、それより低いプライオリティで実行可能なタスクを加え、
+ * 合計num_tasks個のタスクが存在する状態でyieldの切り替えを計測する。
+ * 加えたタスクは、計測が終わってから実行されて終了する。
+ *
+ * @param item 計測項目
+ * @param num_tasks タスク数
+ */
+static void
+bench_dispatch(uint8_t item, uint16_t num_tasks)
+{
+	if (num_tasks > MAX_TASKS) {
+		return ;
+	}
+#if MAX_TASKS > 2
+	for (uint16_t i = 0; i < num_tasks - 2; i++) {
+		kernel_register_task_ex(i % KERNEL_BENCH_FILLER_PRIORITIES, filler_task, NULL,
+				FillerStacks[i], sizeof(FillerStacks[i]), 0);
+	}
+#endif
+	IsStampValid = 0;
+	YieldItem = item;
+	run_tasks(yield_task, 10, yield_task, 10);
+}
+
+/**
+ * dispatch で加えるタスク
+ */
+static void
+filler_task(void *arg)
+{
+	/* no action. */
+}
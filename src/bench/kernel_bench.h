@@ -0,0 +1,112 @@
+/**
+ * @file カーネルのベンチマーク
+ *       タスク切り替えやカーネルオブジェクトの操作にかかる時間を、サイクル数で計測する。
+ *       カーネルの変更前後で同じ項目を比較するために使用する。
+ *
+ *       サイクル数は、RXではCMT0から求めたICLKのサイクル数(分解能16サイクル)、
+ *       ホストビルド(KERNEL_PORT_HOST)ではCPUのタイムスタンプカウンタの値になる。
+ * @author
+ */
+
+#ifndef KERNEL_BENCH_H_
+#define KERNEL_BENCH_H_
+
+#include "../rx_utils/rx_types.h"
+#include "../rx_utils/rx_utils_cpu.h"
+#include "../drv/cmt/cmt.h"
+
+/**
+ * 計測項目
+ */
+enum {
+	KERNEL_BENCH_COUNTER = 0, /* カウンタの読み出し(計測のオーバーヘッド) */
+	KERNEL_BENCH_YIELD, /* yield()による同じプライオリティのタスクへの切り替え */
+	KERNEL_BENCH_SEM_PINGPONG, /* 2つのセマフォによるタスク間の往復 */
+	KERNEL_BENCH_MUTEX, /* 競合の無いミューテックスのロックとアンロック */
+	KERNEL_BENCH_MUTEX_CONTENDED, /* アンロックから、待っていた高プライオリティのタスクがロックするまで */
+	KERNEL_BENCH_ISR_TO_TASK, /* 割り込みハンドラでのポストから、待っていたタスクが動くまで */
+	KERNEL_BENCH_MESSAGE, /* メッセージキューの送受信(1メッセージあたり) */
+	KERNEL_BENCH_DISPATCH_8, /* 8タスクが実行可能な状態でのyield()による切り替え */
+	KERNEL_BENCH_DISPATCH_32, /* 同 32タスク */
+	KERNEL_BENCH_DISPATCH_128, /* 同 128タスク */
+	KERNEL_BENCH_NUM_ITEMS
+};
+
+/**
+ * 1項目の計測回数
+ */
+#define KERNEL_BENCH_ITERATIONS 1000
+
+/**
+ * 計測結果
+ */
+struct kernel_bench_result {
+	const char *name; /* 項目名 */
+	uint32_t count; /* 計測回数 */
+	uint32_t min; /* 最小[サイクル] */
+	uint32_t max; /* 最大[サイクル] */
+	uint64_t total; /* 合計[サイクル] */
+};
+
+#ifdef KERNEL_PORT_HOST
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t kernel_bench_port_get_cycles(void);
+void kernel_bench_port_start_isr(timer_handler_t handler);
+void kernel_bench_port_stop_isr(void);
+void kernel_bench_port_spin(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * サイクル数単位のカウンタ値を得る。
+ * ホストの実装は host/port/kernel_bench_host.c にある。
+ */
+#define KERNEL_BENCH_GET_CYCLES() kernel_bench_port_get_cycles()
+
+/**
+ * isr to task の割り込みを1ミリ秒毎に発生させる/止める。
+ * ホストではCMT1の割り込みハンドラが模擬レジスタにアクセスし、そのトラップの時間が
+ * 計測値の大半を占めるため、レジスタにアクセスしない割り込みを使う。
+ */
+#define KERNEL_BENCH_START_ISR(handler) kernel_bench_port_start_isr(handler)
+#define KERNEL_BENCH_STOP_ISR() kernel_bench_port_stop_isr()
+
+/**
+ * ビジーループの1回分の処理
+ * ホストの仮想時間はCPUを使っても進まないので、1マイクロ秒を消費する。
+ */
+#define KERNEL_BENCH_SPIN() kernel_bench_port_spin()
+
+#else /* KERNEL_PORT_HOST */
+
+#define KERNEL_BENCH_GET_CYCLES() drv_cmt_get_cycle_counter()
+
+/**
+ * isr to task の割り込みを1ミリ秒毎に発生させる/止める。(TIMER_2を使用する)
+ */
+#define KERNEL_BENCH_START_ISR(handler) drv_cmt_start(TIMER_2, 1, (handler))
+#define KERNEL_BENCH_STOP_ISR() drv_cmt_stop(TIMER_2)
+
+#define KERNEL_BENCH_SPIN() rx_util_nop()
+
+#endif /* KERNEL_PORT_HOST */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void kernel_bench_run(void);
+int kernel_bench_get_result(uint8_t item, struct kernel_bench_result *result);
+void kernel_bench_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KERNEL_BENCH_H_ */
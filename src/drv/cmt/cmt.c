@@ -37,6 +37,48 @@
  */
 #define CMT_TIMER_COUNT_1MS   (7499)
 
+/**
+ * ティックレスモードで、1msに相当するカウント数
+ *
+ * ティックレスモードではCMCNT(16bit)で長い時間を計るため、PCLK/32でカウントする。
+ * CMT_TICKLESS_COUNT_1MS = (PCLKB / 32) / 1000
+ *                        = 60000000 / 32 / 1000
+ *                        = 1875
+ */
+#define CMT_TICKLESS_COUNT_1MS (1875)
+
+/**
+ * ティックレスモードで、割り込みを止められる最大時間[ミリ秒]
+ * 65535 / CMT_TICKLESS_COUNT_1MS = 34.95...
+ */
+#define CMT_TICKLESS_MAX_MSEC (34)
+
+/**
+ * CMT0の1カウントあたりのICLKサイクル数
+ *
+ * CMT_CYCLES_PER_COUNT = ICLK / (PCLKB / 8)
+ *                      = 120000000 / (60000000 / 8)
+ *                      = 16
+ * ティックレスモード中は PCLKB / 32 でカウントするため、4倍の64になる。
+ */
+#define CMT_CYCLES_PER_COUNT (16)
+#define CMT_TICKLESS_CYCLES_PER_COUNT (64)
+
+/**
+ * 1msあたりのICLKサイクル数
+ *
+ * CMT_CYCLES_PER_MS = ICLK / 1000
+ *                   = 120000000 / 1000
+ *                   = 120000
+ */
+#define CMT_CYCLES_PER_MS (120000)
+
+/**
+ * CMCR.CKS の設定値
+ */
+#define CMT_CKS_PCLK_8  (0)
+#define CMT_CKS_PCLK_32 (1)
+
 /**
  * 基底タイマーのTICK は1ミリ秒
  */
@@ -64,6 +106,12 @@ struct timer_data {
  */
 static volatile uint32_t TimerCounter = 0;
 
+/**
+ * CMT0のコンペアマッチ1回あたりのミリ秒数。
+ * 通常は1で、ティックレスモード中のみ割り込みを止めている時間になる。
+ */
+static volatile uint32_t TickMillis = 1;
+
 /**
  * タイマーデータ
  */
@@ -100,6 +148,7 @@ drv_cmt_init(void)
 
     rx_memset(&TimerData, 0x0, sizeof(TimerData));
     TimerCounter = 0;
+    TickMillis = 1;
 
     /* CMT1.CMCR
      *   b15-b8: 0固定
@@ -242,9 +291,10 @@ drv_cmt_delay_ms(uint32_t msec)
         return ; /* タイマー0が稼動していない。 */
     }
 
-    enter_count = TimerCounter;
+    enter_count = drv_cmt_get_counter();
     do {
-        elapse = TimerCounter - enter_count;
+        rx_util_nop(); /* ホストビルドでは、ここで仮想時間が進む */
+        elapse = drv_cmt_get_counter() - enter_count;
     } while (elapse < msec);
 
     return ;
@@ -313,8 +363,186 @@ drv_cmt_delay_us(uint16_t usec)
 uint32_t
 drv_cmt_get_counter(void)
 {
-    return TimerCounter;
+    uint32_t counter;
+    uint32_t tick_millis;
+    uint16_t count;
+    uint8_t is_pending;
+
+    if (TickMillis == 1) {
+        return TimerCounter;
+    }
+
+    /* ティックレスモード中は、割り込みを止めている間に経過した分を加算する。
+     * drv_cmt_get_usec_counter()と同じく未処理のコンペアマッチも反映し、
+     * 割り込みハンドラより先に読み出しても値が戻らないようにする。
+     * 読み出し中にコンペアマッチした場合には読み直す。 */
+    do {
+        counter = TimerCounter;
+        tick_millis = TickMillis;
+        is_pending = IR(CMT0, CMI0);
+        count = CMT0.CMCNT;
+    } while ((counter != TimerCounter) || (is_pending != IR(CMT0, CMI0)));
+
+    if (is_pending) {
+        /* コンペアマッチしたが割り込みハンドラが実行されていない。 */
+        counter += tick_millis;
+    }
+    if (tick_millis == 1) {
+        /* 読み出し中にティックレスモードが終了した */
+        return counter;
+    }
+    return counter + (count / CMT_TICKLESS_COUNT_1MS);
+}
+
+/**
+ * マイクロ秒単位のカウンタ値を取得する。
+ * 1ms毎に歩進するカウンタと、CMT0のカウント値から求める。
+ * 32bit符号なし整数で約71分で0に戻るため、drv_cmt_get_counter()と同じく
+ * 差分をとって経過時間を求めること。
+ * 割り込み禁止状態で呼び出された場合も、未処理のコンペアマッチを反映する。
+ *
+ * @return カウンタの値[マイクロ秒]
+ */
+uint32_t
+drv_cmt_get_usec_counter(void)
+{
+    uint32_t counter;
+    uint32_t tick_millis;
+    uint16_t count;
+    uint8_t is_pending;
+
+    /* 読み出し中にコンペアマッチした場合には読み直す。 */
+    do {
+        counter = TimerCounter;
+        tick_millis = TickMillis;
+        is_pending = IR(CMT0, CMI0);
+        count = CMT0.CMCNT;
+    } while ((counter != TimerCounter) || (is_pending != IR(CMT0, CMI0)));
+
+    if (is_pending) {
+        /* コンペアマッチしたが割り込みハンドラが実行されていない。 */
+        counter += tick_millis;
+    }
+    if (tick_millis == 1) {
+        return counter * 1000 + (uint32_t)(count) * US_DELAY_TICK / US_DELAY_TICK_COUNT;
+    } else {
+        return counter * 1000 + (uint32_t)(count) * 1000 / CMT_TICKLESS_COUNT_1MS;
+    }
+}
+
+/**
+ * ICLKのサイクル数単位のカウンタ値を取得する。
+ * drv_cmt_get_usec_counter()と同じく1ms毎に歩進するカウンタとCMT0のカウント値から求めるため、
+ * 分解能は16サイクル(ティックレスモード中は64サイクル)になる。
+ * 32bit符号なし整数で約35秒で0に戻るため、差分をとって経過時間を求めること。
+ * ベンチマークなど、短い処理時間の計測に使用する。
+ *
+ * @return カウンタの値[サイクル]
+ */
+uint32_t
+drv_cmt_get_cycle_counter(void)
+{
+    uint32_t counter;
+    uint32_t tick_millis;
+    uint16_t count;
+    uint8_t is_pending;
+
+    /* 読み出し中にコンペアマッチした場合には読み直す。 */
+    do {
+        counter = TimerCounter;
+        tick_millis = TickMillis;
+        is_pending = IR(CMT0, CMI0);
+        count = CMT0.CMCNT;
+    } while ((counter != TimerCounter) || (is_pending != IR(CMT0, CMI0)));
+
+    if (is_pending) {
+        /* コンペアマッチしたが割り込みハンドラが実行されていない。 */
+        counter += tick_millis;
+    }
+    if (tick_millis == 1) {
+        return counter * CMT_CYCLES_PER_MS + (uint32_t)(count) * CMT_CYCLES_PER_COUNT;
+    } else {
+        return counter * CMT_CYCLES_PER_MS + (uint32_t)(count) * CMT_TICKLESS_CYCLES_PER_COUNT;
+    }
+}
+
+/**
+ * ティックレスモードに移行する。
+ * 1ミリ秒毎の割り込みを止め、msecミリ秒後まで割り込みが発生しないようにCMT0を再設定する。
+ * 割り込み停止中に経過した時間は、割り込み発生時またはdrv_cmt_exit_tickless()で
+ * タイマーカウンタに反映される。
+ * 1ミリ秒毎のハンドラは、割り込みが発生するまで呼び出されない。
+ *
+ * 割り込み禁止状態で呼び出すこと。
+ *
+ * @param msec 割り込みを止める時間[ミリ秒]。
+ *             CMT_TICKLESS_MAX_MSEC を超える場合には CMT_TICKLESS_MAX_MSEC となる。
+ * @return 割り込みを止めた時間[ミリ秒]。ティックレスモードに移行しなかった場合には0が返る。
+ */
+uint32_t
+drv_cmt_enter_tickless(uint32_t msec)
+{
+    uint16_t count;
+
+    if ((msec <= 1) || (TickMillis != 1) || (CMT.CMSTR0.BIT.STR0 == 0)
+            || (IR(CMT0, CMI0) != 0)) {
+        /* 止める意味が無いか、未処理のコンペアマッチがある。 */
+        return 0;
+    }
+    if (msec > CMT_TICKLESS_MAX_MSEC) {
+        msec = CMT_TICKLESS_MAX_MSEC;
+    }
+
+    CMT.CMSTR0.BIT.STR0 = 0; /* タイマカウント停止 */
+
+    /* 現在の1ミリ秒内の経過カウントを、PCLK/32のカウントに換算して引き継ぐ。 */
+    count = CMT0.CMCNT;
+    CMT0.CMCR.BIT.CKS = CMT_CKS_PCLK_32;
+    CMT0.CMCOR = (uint16_t)(msec * CMT_TICKLESS_COUNT_1MS - 1);
+    CMT0.CMCNT = count / 4;
+    TickMillis = msec;
 
+    CMT.CMSTR0.BIT.STR0 = 1; /* タイマカウント開始 */
+
+    return msec;
+}
+
+/**
+ * ティックレスモードを終了し、1ミリ秒毎の割り込みに戻す。
+ * 割り込みを止めている間に経過した時間はタイマーカウンタに反映される。
+ * ティックレスモードでない場合には何もしない。
+ *
+ * 割り込み禁止状態で呼び出すこと。
+ */
+void
+drv_cmt_exit_tickless(void)
+{
+    uint16_t count;
+
+    if (TickMillis == 1) {
+        return ;
+    }
+
+    CMT.CMSTR0.BIT.STR0 = 0; /* タイマカウント停止 */
+
+    count = CMT0.CMCNT;
+    if (IR(CMT0, CMI0) != 0) {
+        /* コンペアマッチしたが割り込みハンドラが実行されていない。
+         * ここで反映させ、割り込みは発生させない。 */
+        IR(CMT0, CMI0) = 0;
+        TimerCounter += TickMillis;
+    }
+    TimerCounter += count / CMT_TICKLESS_COUNT_1MS;
+
+    /* 1ミリ秒内の経過カウントを、PCLK/8のカウントに換算して引き継ぐ。 */
+    CMT0.CMCR.BIT.CKS = CMT_CKS_PCLK_8;
+    CMT0.CMCOR = CMT_TIMER_COUNT_1MS;
+    CMT0.CMCNT = (count % CMT_TICKLESS_COUNT_1MS) * 4;
+    TickMillis = 1;
+
+    CMT.CMSTR0.BIT.STR0 = 1; /* タイマカウント開始 */
+
+    return ;
 }
 
 /**
@@ -349,14 +577,16 @@ is_valid_timer_exists(void)
 void
 Excep_CMT0_CMI0(void)
 {
+    rx_util_isr_enter(VECT(CMT0, CMI0));
     CMT0.CMCR.BIT.CMIE = 0; /* CMI0割り込み停止 */
     IR(CMT0, CMI0) = 0; /* 割り込みフラグクリア */
-    TimerCounter++;
+    TimerCounter += TickMillis;
 
     if (MilliSecondHandler) {
         MilliSecondHandler();
     }
     CMT0.CMCR.BIT.CMIE = 1; /* CMI0 割り込み許可 */
+    rx_util_isr_exit(VECT(CMT0, CMI0));
 }
 
 #pragma interrupt (Excep_CMT1_CMI1(vect=VECT(CMT1, CMI1)))
@@ -366,6 +596,7 @@ Excep_CMT1_CMI1(void)
     uint8_t no;
     uint8_t is_interrupt_enable;
 
+    rx_util_isr_enter(VECT(CMT1, CMI1));
     CMT1.CMCR.BIT.CMIE = 0; /* CMI1割り込み停止 */
     IR(CMT1, CMI1) = 0; /* 割り込みフラグクリア */
 
@@ -385,6 +616,7 @@ Excep_CMT1_CMI1(void)
     }
 
     CMT1.CMCR.BIT.CMIE = 1; /* CMI1 割り込み許可 */
+    rx_util_isr_exit(VECT(CMT1, CMI1));
 }
 
 /**
@@ -395,10 +627,11 @@ Excep_CMT1_CMI1(void)
 static void
 timer_proc(struct timer_data *timer)
 {
-	uint32_t elapse = TimerCounter - timer->time_counter;
+	uint32_t now = drv_cmt_get_counter();
+	uint32_t elapse = now - timer->time_counter;
     if (elapse >= timer->interval_millis) {
         /* 指定ミリ秒経過したのでハンドラを呼び出す。 */
-    	timer->time_counter = TimerCounter;
+    	timer->time_counter = now;
         timer->handler(TIMER_TICK);
     }
 
@@ -419,7 +652,7 @@ timer_set(struct timer_data *timer, uint32_t interval_msec,
 	/* time_counterの初期値をinterval_msecより前にすることで、
 	 * 最初のタイマー割り込みで実行されるようにする。
 	 * 初回呼び出しを遅延させたい場合には、ここで減算する値に加算すればよい。 */
-    timer->time_counter = TimerCounter - interval_msec;
+    timer->time_counter = drv_cmt_get_counter() - interval_msec;
     timer->interval_millis = interval_msec;
     timer->handler = handler;
 }
@@ -28,6 +28,11 @@ void drv_cmt_stop(uint8_t id);
 void drv_cmt_delay_ms(uint32_t msec);
 void drv_cmt_delay_us(uint16_t usec);
 uint32_t drv_cmt_get_counter(void);
+uint32_t drv_cmt_get_usec_counter(void);
+uint32_t drv_cmt_get_cycle_counter(void);
+
+uint32_t drv_cmt_enter_tickless(uint32_t msec);
+void drv_cmt_exit_tickless(void);
 
 #ifdef __cplusplus
 }
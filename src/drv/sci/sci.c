@@ -477,20 +477,26 @@ sci0_rx_intr_handler(struct sci0_entry *entry)
 void
 INT_Excep_SCI5_TXI5(void)
 {
+    rx_util_isr_enter(VECT(SCI5, TXI5));
     sci0_tx_intr_handler(&Sci5);
+    rx_util_isr_exit(VECT(SCI5, TXI5));
 }
 #pragma interrupt(INT_Excep_SCI5_RXI5(vect=VECT(SCI5, RXI5)))
 void
 INT_Excep_SCI5_RXI5(void)
 {
+    rx_util_isr_enter(VECT(SCI5, RXI5));
     sci0_rx_intr_handler(&Sci5);
+    rx_util_isr_exit(VECT(SCI5, RXI5));
 }
 
 #pragma interrupt(INT_Excep_SCI9_TXI9(vect=VECT(SCI9, TXI9)))
 void
 INT_Excep_SCI9_TXI9(void)
 {
+	rx_util_isr_enter(VECT(SCI9, TXI9));
 	sci0_tx_intr_handler(&Sci9);
+	rx_util_isr_exit(VECT(SCI9, TXI9));
 }
 
 
@@ -498,5 +504,7 @@ INT_Excep_SCI9_TXI9(void)
 void
 INT_Excep_SCI9_RXI9(void)
 {
+	rx_util_isr_enter(VECT(SCI9, RXI9));
 	sci0_rx_intr_handler(&Sci9);
+	rx_util_isr_exit(VECT(SCI9, RXI9));
 }
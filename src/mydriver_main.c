@@ -10,6 +10,9 @@
 
 #include "os/kernel.h"
 #include "os/kernel_api.h"
+#ifdef KERNEL_BENCH
+#include "bench/kernel_bench.h"
+#endif
 
 static struct semaphore Sem;
 static struct mutex Mutex;
@@ -96,9 +99,16 @@ main(void)
 
 	kernel_init();
 
+#ifdef KERNEL_BENCH
+	/* ベンチマークのビルドでは、デモの代わりにカーネルのベンチマークを繰り返す */
+	while (1) {
+		drv_cmt_delay_ms(1000);
+		kernel_bench_run();
+	}
+#endif
+
 	drv_s12ad_start_normal();
 
-//	drv_cmt_set_msec_handler(kernel_request_swtich);
 	drv_cmt_start(TIMER_1, 1000, timer_task);
 	drv_cmt_start(TIMER_2, 10, timer_task_10ms);
 
@@ -0,0 +1,320 @@
+/**
+ * @file イベントフラグ実装
+ *       待っているタスクは、待ち条件（いずれか/全て）と待っているフラグを
+ *       タスクパラメータに保持する。
+ *       フラグをセットした時に待っているタスクを走査し、条件が成立したタスクだけを
+ *       待機解除するため、複数の要因を待つタスクは1回の待機と1回の待機解除で済む。
+ * @author 
+ */
+
+#include "kernel.h"
+#include "task.h"
+#include "event_flags.h"
+#include "../rx_utils/error_code.h"
+
+static int wait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result, uint8_t is_timed, uint32_t timeout_millis);
+static int is_satisfied(uint32_t current, uint32_t flags, uint8_t mode);
+static int is_valid_mode(uint8_t mode);
+static int set_flags(struct event_flags *ef, uint32_t flags);
+static void set_from_isr_proc(void *obj, uintptr_t value);
+
+/**
+ * イベントフラグを初期化する。
+ *
+ * @param ef イベントフラグ
+ * @param initial_flags フラグの初期値
+ */
+void
+event_flags_init(struct event_flags *ef, uint32_t initial_flags)
+{
+	wait_object_init(&(ef->wait_obj));
+	ef->flags = initial_flags;
+
+	return ;
+}
+
+/**
+ * イベントフラグを破棄する。
+ *
+ * @param ef イベントフラグ
+ */
+void
+event_flags_destroy(struct event_flags *ef)
+{
+	wait_object_destroy(&(ef->wait_obj));
+	ef->flags = 0;
+
+	return ;
+}
+
+/**
+ * フラグをセットする。
+ * 待ち条件が成立したタスクを全て待機解除する。
+ * EVENT_FLAGS_CLEARを指定して待っていたタスクのフラグは、
+ * 全てのタスクを判定した後にクリアする。
+ *
+ * @param ef イベントフラグ
+ * @param flags セットするフラグ
+ */
+void
+event_flags_set(struct event_flags *ef, uint32_t flags)
+{
+	int is_released;
+
+	kernel_disable_context_switch();
+	is_released = set_flags(ef, flags);
+	kernel_enable_context_switch();
+	if (is_released) {
+		kernel_request_swtich();
+	}
+
+	return ;
+}
+
+/**
+ * 割り込みハンドラからフラグをセットする。
+ * セットはスケジューラで行われ、待ち条件が成立したタスクは割り込みからの復帰時に
+ * ディスパッチされる。
+ *
+ * @param ef イベントフラグ
+ * @param flags セットするフラグ
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+event_flags_set_from_isr(struct event_flags *ef, uint32_t flags)
+{
+	return kernel_request_from_isr(set_from_isr_proc, ef, flags);
+}
+
+/**
+ * フラグをセットし、待ち条件が成立したタスクを待機解除する。
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param ef イベントフラグ
+ * @param flags セットするフラグ
+ * @return 待機解除したタスクがある場合には非0、無い場合には0
+ */
+static int
+set_flags(struct event_flags *ef, uint32_t flags)
+{
+	struct task_entry *entry;
+	struct task_entry *next;
+	uint32_t clear_flags = 0;
+	int is_released = 0;
+
+	ef->flags |= flags;
+	entry = ef->wait_obj.wait_entries;
+	while (entry != NULL) {
+		next = entry->wait_next;
+		if (is_satisfied(ef->flags, entry->param.wait_flags, entry->param.wait_mode)) {
+			if (entry->param.wait_mode & EVENT_FLAGS_CLEAR) {
+				clear_flags |= entry->param.wait_flags;
+			}
+			entry->param.wait_flags = ef->flags;
+			kernel_signal_task(&(ef->wait_obj), entry);
+			is_released = 1;
+		}
+		entry = next;
+	}
+	ef->flags &= ~clear_flags;
+
+	return is_released;
+}
+
+/**
+ * event_flags_set_from_isr()で依頼された処理をスケジューラで実行する。
+ *
+ * @param obj イベントフラグ
+ * @param value セットするフラグ
+ */
+static void
+set_from_isr_proc(void *obj, uintptr_t value)
+{
+	set_flags((struct event_flags *)(obj), value);
+}
+
+/**
+ * フラグをクリアする。
+ *
+ * @param ef イベントフラグ
+ * @param flags クリアするフラグ
+ */
+void
+event_flags_clear(struct event_flags *ef, uint32_t flags)
+{
+	kernel_disable_context_switch();
+	ef->flags &= ~flags;
+	kernel_enable_context_switch();
+
+	return ;
+}
+
+/**
+ * 現在のフラグを得る。
+ *
+ * @param ef イベントフラグ
+ * @return フラグ
+ */
+uint32_t
+event_flags_get(struct event_flags *ef)
+{
+	return ef->flags;
+}
+
+/**
+ * フラグがセットされるのを待つ。
+ *
+ * @param ef イベントフラグ
+ * @param flags 待つフラグ
+ * @param mode 待ち条件。EVENT_FLAGS_WAIT_ANY または EVENT_FLAGS_WAIT_ALL。
+ *             EVENT_FLAGS_CLEARを論理和で指定できる。
+ * @param result 待機解除した時点のフラグを格納する変数。不要な場合はNULL。
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+event_flags_wait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result)
+{
+	return wait(ef, flags, mode, result, 0, 0);
+}
+
+/**
+ * フラグがセットされているかどうかを確認する。待機はしない。
+ *
+ * @param ef イベントフラグ
+ * @param flags 待つフラグ
+ * @param mode 待ち条件。EVENT_FLAGS_WAIT_ANY または EVENT_FLAGS_WAIT_ALL。
+ *             EVENT_FLAGS_CLEARを論理和で指定できる。
+ * @param result 条件が成立した時点のフラグを格納する変数。不要な場合はNULL。
+ * @return 条件が成立している場合には0、成立していない場合にはERR_OPERATION_STATEを返す。
+ */
+int
+event_flags_trywait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result)
+{
+	int retval;
+
+	if ((flags == 0) || !is_valid_mode(mode)) {
+		return ERR_INVAL;
+	}
+
+	kernel_disable_context_switch();
+	if (is_satisfied(ef->flags, flags, mode)) {
+		if (result != NULL) {
+			*result = ef->flags;
+		}
+		if (mode & EVENT_FLAGS_CLEAR) {
+			ef->flags &= ~flags;
+		}
+		retval = 0;
+	} else {
+		retval = ERR_OPERATION_STATE;
+	}
+	kernel_enable_context_switch();
+
+	return retval;
+}
+
+/**
+ * フラグがセットされるのを待つ。
+ * 指定時間内に条件が成立しない場合にはエラーを返す。
+ *
+ * @param ef イベントフラグ
+ * @param flags 待つフラグ
+ * @param mode 待ち条件。EVENT_FLAGS_WAIT_ANY または EVENT_FLAGS_WAIT_ALL。
+ *             EVENT_FLAGS_CLEARを論理和で指定できる。
+ * @param result 待機解除した時点のフラグを格納する変数。不要な場合はNULL。
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+int
+event_flags_timedwait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result, uint32_t timeout_millis)
+{
+	return wait(ef, flags, mode, result, 1, timeout_millis);
+}
+
+/**
+ * フラグがセットされるのを待つ。
+ *
+ * @param ef イベントフラグ
+ * @param flags 待つフラグ
+ * @param mode 待ち条件
+ * @param result 待機解除した時点のフラグを格納する変数。不要な場合はNULL。
+ * @param is_timed タイムアウトするかどうか
+ * @param timeout_millis タイムアウト時間[ミリ秒]
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+static int
+wait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result, uint8_t is_timed, uint32_t timeout_millis)
+{
+	struct task_entry *self = kernel_get_current_task();
+	int retval;
+
+	if ((flags == 0) || !is_valid_mode(mode)) {
+		return ERR_INVAL;
+	}
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
+	}
+
+	kernel_disable_context_switch();
+	if (is_satisfied(ef->flags, flags, mode)) {
+		if (result != NULL) {
+			*result = ef->flags;
+		}
+		if (mode & EVENT_FLAGS_CLEAR) {
+			ef->flags &= ~flags;
+		}
+		kernel_enable_context_switch();
+		return 0;
+	}
+
+	/* event_flags_set()で条件が成立した時に、成立したフラグを設定して待機解除される */
+	self->param.wait_flags = flags;
+	self->param.wait_mode = mode;
+	if (!is_timed) {
+		retval = kernel_sysc_wait_object(&(ef->wait_obj));
+	} else {
+		retval = kernel_sysc_wait_object_timeout(&(ef->wait_obj), timeout_millis);
+	}
+	if ((retval == 0) && (result != NULL)) {
+		*result = self->param.wait_flags;
+	}
+
+	return retval;
+}
+
+/**
+ * 待ち条件が成立しているかどうかを判定する。
+ *
+ * @param current 現在のフラグ
+ * @param flags 待っているフラグ
+ * @param mode 待ち条件
+ * @return 成立している場合には非0、成立していない場合には0
+ */
+static int
+is_satisfied(uint32_t current, uint32_t flags, uint8_t mode)
+{
+	if (mode & EVENT_FLAGS_WAIT_ALL) {
+		return ((current & flags) == flags);
+	} else {
+		return ((current & flags) != 0);
+	}
+}
+
+/**
+ * 待ち条件が正しいかどうかを判定する。
+ *
+ * @param mode 待ち条件
+ * @return 正しい場合には非0、正しくない場合には0
+ */
+static int
+is_valid_mode(uint8_t mode)
+{
+	return ((mode & ~(EVENT_FLAGS_WAIT_ALL | EVENT_FLAGS_CLEAR)) == 0);
+}
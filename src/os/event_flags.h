@@ -0,0 +1,58 @@
+/**
+ * @file イベントフラグ
+ * @author 
+ */
+
+#ifndef EVENT_FLAGS_H_
+#define EVENT_FLAGS_H_
+
+#include "../rx_utils/rx_types.h"
+#include "wait_object.h"
+
+/**
+ * 待っているフラグのいずれかがセットされたら待機解除する。
+ */
+#define EVENT_FLAGS_WAIT_ANY 0x00
+/**
+ * 待っているフラグが全てセットされたら待機解除する。
+ */
+#define EVENT_FLAGS_WAIT_ALL 0x01
+/**
+ * 待機解除した時に、待っていたフラグをクリアする。
+ * EVENT_FLAGS_WAIT_ANY または EVENT_FLAGS_WAIT_ALL と組み合わせて指定する。
+ */
+#define EVENT_FLAGS_CLEAR    0x02
+
+struct event_flags {
+	struct wait_object wait_obj;
+	uint32_t flags;
+};
+
+/**
+ * イベントフラグの初期化子
+ * 静的に配置するイベントフラグを、event_flags_init()を呼ばずに初期化する。
+ */
+#define EVENT_FLAGS_INITIALIZER(initial_flags) { WAIT_OBJECT_INITIALIZER, (initial_flags) }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void event_flags_init(struct event_flags *ef, uint32_t initial_flags);
+void event_flags_destroy(struct event_flags *ef);
+void event_flags_set(struct event_flags *ef, uint32_t flags);
+int event_flags_set_from_isr(struct event_flags *ef, uint32_t flags);
+void event_flags_clear(struct event_flags *ef, uint32_t flags);
+uint32_t event_flags_get(struct event_flags *ef);
+int event_flags_wait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result);
+int event_flags_trywait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result);
+int event_flags_timedwait(struct event_flags *ef, uint32_t flags, uint8_t mode,
+		uint32_t *result, uint32_t timeout_millis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_FLAGS_H_ */
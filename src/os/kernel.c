@@ -3,21 +3,46 @@
  * @author
  */
 
-#include <iodefine.h>
 #include "../rx_utils/rx_utils.h"
 #include "../rx_utils/error_code.h"
 #include "../drv/cmt/cmt.h"
 #include "task.h"
 #include "task_list.h"
-#include "wait_object_list.h"
+#include "ready_queue.h"
+#include "sleep_queue.h"
+#include "wait_object.h"
+#include "mutex.h"
 #include "kernel.h"
-
-static void* init_stack(void *stack, void *func, void *arg);
-static struct task_entry *next_task(void);
-static void update_waiting_objects(void);
-static void update_waiting_tasks(void);
-static int update_waiting_condition(struct task_entry *entry);
+#if KERNEL_STATIC_CONFIG
+#include "semaphore.h"
+#include "message_queue.h"
+#include "event_flags.h"
+#endif
+#include "kernel_port.h"
+#include "kernel_trace.h"
+
+static int register_task(uint16_t priority, task_func_t func, void *arg,
+		stack_type_t *stack, uint32_t stack_size, uint8_t options);
+static void *init_task_stack(struct task_entry *entry, stack_type_t *stack,
+		uint32_t stack_size, uint8_t options);
+static struct task_entry *terminate_task(struct task_entry *entry);
+static void release_task(struct task_entry *entry);
+static stack_type_t *alloc_stack(void);
+static void free_stack(stack_type_t *stack);
+#if KERNEL_STACK_CHECK
+static uint32_t get_stack_max_used(const struct task_entry *entry);
+static void check_stack(struct task_entry *entry);
+#endif
+static void wakeup_sleeping_tasks(void);
+static void wakeup_task(struct task_entry *entry);
+static void process_isr_requests(void);
+static void idle_proc(void);
+static void tick_proc(void);
+
+static void sysc_trap(void);
 static void task_entry_proc(struct task_param *param);
+static struct task_entry *find_task(int taskid);
+static int join_task(int taskid, uint8_t is_timed, uint32_t timeout_millis);
 
 
 /**
@@ -27,8 +52,24 @@ static volatile uint8_t IsSchedulerRuning = 0;
 
 /**
  * コンテキストスイッチを有効にするかどうか
+ * ContextSwitchLockCountが0の時だけ有効になる。
  */
 static uint8_t ContextSwitchEnable = 0;
+/**
+ * 実行中のタスクがコンテキストスイッチを無効にしたネスト数
+ * タスクを切り替える時にタスク毎に保存、復元する。
+ */
+static volatile uint16_t ContextSwitchLockCount = 0;
+/**
+ * システムコールトラップでスケジューラに入ったかどうか
+ */
+static uint8_t IsSyscall = 0;
+/**
+ * 現在のタスクを同じプライオリティの末尾に回すかどうか。
+ * タイムスライスを使い切った時と、タスクがCPUの使用権を譲った時にセットする。
+ */
+static volatile uint8_t SliceExpired = 0;
+
 /**
  * 戻りコンテキストブロック
  */
@@ -45,19 +86,49 @@ struct rxcc_tcb *CurrentTcb;
  */
 static struct task_entry *CurrentTask;
 
+
 /**
- * タスク開始時のPSWレジスタ初期値
- * b20: 1 ユーザーモードで実行
- * b17: 1 USP
- * b16: 1 割り込み許可
+ * 時間待ちをしているタスクのキュー
+ * 待機オブジェクトを待っているタスクは、各待機オブジェクトが保持する。
  */
-#define INITIAL_PSW 0x00130000
+static struct sleep_queue SleepQueue;
+
 /**
- * タスク開始時のFPSWレジスタ初期値
+ * 割り込みハンドラからの要求
  */
-#define INITIAL_FPSW 0x00000100
+struct isr_request {
+	kernel_isr_proc_t proc; /* 実行する処理 */
+	void *obj; /* 対象オブジェクト */
+	uintptr_t value; /* 値 */
+};
 
+/**
+ * 割り込みハンドラからの要求キュー
+ * 割り込みハンドラが末尾に追加し、スケジューラが先頭から取り出して実行する。
+ * スケジューラは割り込み禁止状態で動作するため、取り出し中に追加されることは無い。
+ */
+static struct isr_request IsrRequests[KERNEL_ISR_QUEUE_SIZE];
+/**
+ * 次に実行する要求の位置
+ */
+static volatile uint16_t IsrRequestHead = 0;
+/**
+ * 保持している要求の数
+ */
+static volatile uint16_t IsrRequestCount = 0;
 
+#if KERNEL_STATIC_CONFIG
+/*
+ * タスクデータ、空きタスク、実行可能なタスクのキュー、生存しているタスクの数と、
+ * 静的タスクのスタック、カーネルオブジェクトは、tools/gen_kernel_static.py で
+ * 設定ファイルから生成した初期化済みデータを使用する。
+ */
+#include <kernel_static_data.h>
+#else
+/**
+ * タスクデータ
+ */
+static struct task_entry TaskEntries[MAX_TASKS];
 
 /**
  * 空きタスク
@@ -65,27 +136,81 @@ static struct task_entry *CurrentTask;
 static struct task_list BlankEntries;
 
 /**
- * 待機エントリ
+ * 実行可能なタスクのキュー
  */
-static struct task_list WaitingEntries;
+static struct ready_queue ReadyQueue;
 
 /**
- * アクティブエントリ
+ * 生存しているタスクの数
+ * 待機オブジェクトを待っているタスクはカーネルのリストに含まれないため、
+ * スケジューラの終了判定にはこの値を使用する。
  */
-static struct task_list ActiveEntries;
+static uint16_t AliveTaskCount = 0;
+#endif
+
 
-static struct wait_object_list WaitObjectList;
+#if MAX_TASKS > (1 << KERNEL_TASK_ID_INDEX_BITS)
+#error "MAX_TASKS must not exceed 2^KERNEL_TASK_ID_INDEX_BITS."
+#endif
+#if KERNEL_TASK_ID_INDEX_BITS > 8
+#error "KERNEL_TASK_ID_INDEX_BITS must leave at least 8 bits for the generation."
+#endif
 
 /**
- * タスクデータ
+ * タスクIDからタスクエントリの位置を取り出すマスク
  */
-static struct task_entry TaskEntries[MAX_TASKS];
+#define TASK_ID_INDEX_MASK ((1 << KERNEL_TASK_ID_INDEX_BITS) - 1)
+/**
+ * タスクIDの世代番号の最大値
+ * タスクIDは task_id_t に収まり、かつ0にならないように、世代番号は1から始める。
+ */
+#define TASK_ID_MAX_GENERATION ((task_id_t)(~0) >> KERNEL_TASK_ID_INDEX_BITS)
+
+/**
+ * スタックオーバーフローを検出した時に呼び出される処理
+ */
+static kernel_stack_overflow_handler_t StackOverflowHandler = NULL;
+
+/**
+ * 割り当てたTLSのスロット数
+ * スロットは解放しないため、0からこの値の手前までが割り当て済みになる。
+ */
+static uint8_t TlsSlotCount = 0;
+/**
+ * TLSのスロット毎の、タスク終了時に値を解放する処理
+ */
+static kernel_tls_destructor_t TlsDestructors[KERNEL_TLS_SLOTS];
 
+#if KERNEL_RUNTIME_STATS
+/**
+ * 実行中のタスクをディスパッチした時刻[マイクロ秒]
+ */
+static uint32_t DispatchTime = 0;
+/**
+ * 実行可能なタスクが無かった時間の累計[マイクロ秒]
+ */
+static uint64_t IdleTime = 0;
+/**
+ * コンテキストスイッチ回数
+ */
+static uint32_t SwitchCount = 0;
+/**
+ * 計測を開始したタイマーカウンタ値[ミリ秒]
+ */
+static uint32_t StatsStartTick = 0;
+#endif
 
+#if KERNEL_STACK_POOL_COUNT > 0
+/**
+ * スタックプール
+ */
+static stack_type_t StackPool[KERNEL_STACK_POOL_COUNT][KERNEL_STACK_POOL_STACK_SIZE / sizeof(stack_type_t)];
 /**
- * タスクIDジェネレータ
+ * 空きスタックのリスト
+ * 空きスタックの先頭に、次の空きスタックへのポインタを格納する。
  */
-static uint16_t TaskIdGen = 1;
+static stack_type_t *FreeStacks;
+#endif
 
 /**
  * カーネルを初期化する。
@@ -94,24 +219,43 @@ void
 kernel_init(void)
 {
     rx_memset(&ReturnTcb, 0x0, sizeof(ReturnTcb));
+    /* スケジューラを開始したコンテキストは、どのレジスタを使っているか分からない */
+    ReturnTcb.flags = TASK_OPTION_FPU | TASK_OPTION_DSP;
     CurrentTcb = NULL;
 
-    task_list_init(&ActiveEntries);
+    IsrRequestHead = 0;
+    IsrRequestCount = 0;
+#if KERNEL_STATIC_CONFIG
+    /* タスクエントリとレディキューは初期化済み。静的タスクの初期コンテキストだけを作る */
+    for (int i = 0; i < KERNEL_STATIC_NUM_TASKS; i++) {
+    	struct task_entry *entry = &(TaskEntries[i]);
+    	entry->param.tcb.usp = init_task_stack(entry, entry->stack, entry->stack_size,
+    			(uint8_t)(entry->param.tcb.flags));
+    }
+#else
+    ready_queue_init(&ReadyQueue);
     task_list_init(&BlankEntries);
     for (int i = 0; i < MAX_TASKS; i++) {
     	struct task_entry *entry = &(TaskEntries[i]);
         task_init(entry);
         task_list_add(&BlankEntries, entry);
     }
+#endif
+#if KERNEL_STACK_POOL_COUNT > 0
+    FreeStacks = NULL;
+    for (int i = 0; i < KERNEL_STACK_POOL_COUNT; i++) {
+    	free_stack(StackPool[i]);
+    }
+#endif
 
-    IPR(ICU, SWINT) = KERNEL_PRIORITY;
-    IEN(ICU, SWINT) = 1;
+    KERNEL_PORT_INIT();
     return ;
 }
 
 
 /**
  * タスクを登録する。
+ * タスクオプションは KERNEL_DEFAULT_TASK_OPTIONS になる。
  *
  * @param priority プライオリティ
  * @param func 関数
@@ -119,78 +263,383 @@ kernel_init(void)
  * @param stack スタック
  * @param stack_size スタックサイズ。
  * @return 成功した場合、タスクIDが返る。失敗した場合、リソースがなくて登録に失敗した場合、-1が返る。
+ *         priorityが KERNEL_NUM_PRIORITIES 以上の場合も-1が返る。
  */
 int
 kernel_register_task(uint16_t priority,
 		task_func_t func, void *arg,
 		stack_type_t *stack, uint32_t stack_size)
 {
-    if ((func == NULL) || (stack == NULL) || (stack_size == 0)) {
+	return kernel_register_task_ex(priority, func, arg, stack, stack_size,
+			KERNEL_DEFAULT_TASK_OPTIONS);
+}
+
+/**
+ * タスクオプションを指定してタスクを登録する。
+ * TASK_OPTION_FPUを指定しないタスクはFPSWを、TASK_OPTION_DSPを指定しないタスクは
+ * アキュームレータを退避/復元しない。
+ * 浮動小数点演算やDSP命令を使用するタスクには、必ず対応するオプションを指定すること。
+ * スケジューラの動作中にタスクから呼び出すこともできる。
+ *
+ * @param priority プライオリティ
+ * @param func 関数
+ * @param arg funcに渡す引数
+ * @param stack スタック
+ * @param stack_size スタックサイズ。
+ * @param options タスクオプション (TASK_OPTION_FPU, TASK_OPTION_DSP の論理和)
+ * @return 成功した場合、タスクIDが返る。失敗した場合、リソースがなくて登録に失敗した場合、-1が返る。
+ *         priorityが KERNEL_NUM_PRIORITIES 以上の場合も-1が返る。
+ */
+int
+kernel_register_task_ex(uint16_t priority,
+		task_func_t func, void *arg,
+		stack_type_t *stack, uint32_t stack_size, uint8_t options)
+{
+    if ((stack == NULL) || (stack_size == 0)) {
+        return -1;
+    }
+
+    return register_task(priority, func, arg, stack, stack_size, options);
+}
+
+/**
+ * スタックプールからスタックを割り当ててタスクを生成する。
+ * スタックのサイズは KERNEL_STACK_POOL_STACK_SIZE になり、
+ * タスクが終了するとスタックはプールに戻される。
+ * スケジューラの動作中にタスクから呼び出すこともできる。
+ *
+ * @param priority プライオリティ
+ * @param func 関数
+ * @param arg funcに渡す引数
+ * @param options タスクオプション (TASK_OPTION_FPU, TASK_OPTION_DSP の論理和)
+ * @return 成功した場合、タスクIDが返る。タスクエントリかスタックに空きが無い場合、-1が返る。
+ *         priorityが KERNEL_NUM_PRIORITIES 以上の場合も-1が返る。
+ */
+int
+kernel_create_task(uint16_t priority,
+		task_func_t func, void *arg, uint8_t options)
+{
+	return register_task(priority, func, arg, NULL, KERNEL_STACK_POOL_STACK_SIZE, options);
+}
+
+/**
+ * タスクを登録する。
+ *
+ * @param priority プライオリティ
+ * @param func 関数
+ * @param arg funcに渡す引数
+ * @param stack スタック。NULLの場合はスタックプールから割り当てる。
+ * @param stack_size スタックサイズ。
+ * @param options タスクオプション (TASK_OPTION_FPU, TASK_OPTION_DSP の論理和)
+ * @return 成功した場合、タスクIDが返る。失敗した場合、-1が返る。
+ */
+static int
+register_task(uint16_t priority, task_func_t func, void *arg,
+		stack_type_t *stack, uint32_t stack_size, uint8_t options)
+{
+    if ((func == NULL) || (priority >= KERNEL_NUM_PRIORITIES)
+    		|| ((options & ~(TASK_OPTION_FPU | TASK_OPTION_DSP)) != 0)) {
         return -1;
     }
 
+    /* 動作中のスケジューラもタスクエントリとレディキューを操作する */
+    kernel_disable_context_switch();
     struct task_entry *entry = task_list_pop(&BlankEntries);
     if (entry == NULL) {
     	/* 空きなし */
+    	kernel_enable_context_switch();
         return -1;
     }
+    uint8_t stack_pooled = 0;
+    if (stack == NULL) {
+    	stack = alloc_stack();
+    	if (stack == NULL) {
+    		/* スタックの空きなし */
+    		task_list_add(&BlankEntries, entry);
+    		kernel_enable_context_switch();
+    		return -1;
+    	}
+    	stack_pooled = 1;
+    }
+
+    /* 以前このエントリを使っていたタスクのIDと一致しないように、世代番号を進める */
+    entry->generation++;
+    if (entry->generation > TASK_ID_MAX_GENERATION) {
+    	entry->generation = 1;
+    }
+    task_id_t id = (task_id_t)((entry->generation << KERNEL_TASK_ID_INDEX_BITS)
+    		| (uint16_t)(entry - TaskEntries));
+    void* usp = init_task_stack(entry, stack, stack_size, options);
+    task_setup(entry, id, priority, func, arg, usp, options);
+    entry->stack = stack;
+    entry->stack_size = stack_size;
+    entry->stack_overflow = 0;
+    entry->stack_pooled = stack_pooled;
+
+    ready_queue_add(&ReadyQueue, entry);
+    AliveTaskCount++;
+    KERNEL_TRACE_EVENT(KERNEL_TRACE_TASK_CREATE, id, func);
+
+    int is_preempt = (CurrentTask != NULL) && (priority > CurrentTask->param.priority);
+    kernel_enable_context_switch();
+    if (is_preempt) {
+    	/* 生成したタスクの方がプライオリティが高い */
+    	kernel_request_swtich();
+    }
+
+    return (int)(id);
+}
 
-    task_id_t id = TaskIdGen;
-    TaskIdGen++;
-    if (TaskIdGen > 9999) {
-    	TaskIdGen = 1;
+/**
+ * タスクのスタックに初期コンテキストを作成する。
+ *
+ * @param entry タスクエントリ
+ * @param stack スタック領域の先頭
+ * @param stack_size スタックサイズ[バイト]
+ * @param options タスクオプション (TASK_OPTION_FPU, TASK_OPTION_DSP の論理和)
+ * @return 初期スタックポインタ値
+ */
+static void *
+init_task_stack(struct task_entry *entry, stack_type_t *stack,
+		uint32_t stack_size, uint8_t options)
+{
+#if KERNEL_STACK_CHECK
+    /* 最大使用量を計測できるように、初期フレームを書き込む前に全体を塗りつぶす */
+    for (uint32_t i = 0; i < stack_size / sizeof(stack_type_t); i++) {
+    	stack[i] = KERNEL_STACK_PAINT_PATTERN;
     }
-    void* usp = init_stack(stack + stack_size / sizeof(stack_type_t),
-            task_entry_proc, &(entry->param));
-    task_setup(entry, id, priority, func, arg, usp);
+#endif
+    return kernel_port_init_stack(stack + stack_size / sizeof(stack_type_t),
+            task_entry_proc, &(entry->param), options);
+}
+
+/**
+ * タスクを削除する。
+ * 待機中のタスクは待機オブジェクトやスリープキューから外して終了させ、
+ * 終了を待っているタスクを待機解除する。
+ * 自タスクを指定した場合には、kernel_exit_task()と同じく制御は返らない。
+ * ミューテックスをロックしているタスクは、所有権を残したまま終了させないために削除できない。
+ *
+ * @param taskid タスクID
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+kernel_delete_task(int taskid)
+{
+	if ((CurrentTask != NULL) && (taskid == CurrentTask->param.id)) {
+		kernel_exit_task();
+	}
+
+	kernel_disable_context_switch();
+	struct task_entry *entry = find_task(taskid);
+	if ((entry == NULL) || (entry->param.state == TASK_STATE_DEAD)) {
+		kernel_enable_context_switch();
+		return ERR_INVAL;
+	}
+	if (entry->held_mutexes != NULL) {
+		kernel_enable_context_switch();
+		return ERR_OPERATION_STATE;
+	}
+
+	if (entry->param.state == TASK_STATE_PENDING) {
+		ready_queue_remove(&ReadyQueue, entry);
+	} else if (entry->param.state == TASK_STATE_WAITING) {
+		if ((entry->param.syscall_type == SYSCALL_WAIT_MSEC)
+				|| (entry->param.syscall_type == SYSCALL_WAIT_OBJECT_TIMEOUT)) {
+			sleep_queue_remove(&SleepQueue, entry);
+		}
+		if (((entry->param.syscall_type == SYSCALL_WAIT_OBJECT)
+				|| (entry->param.syscall_type == SYSCALL_WAIT_OBJECT_TIMEOUT))
+				&& (entry->param.sysc.wait_object != NULL)) {
+			wait_object_remove(entry->param.sysc.wait_object, entry);
+			entry->param.sysc.wait_object = NULL;
+		}
+		if (entry->wait_mutex != NULL) {
+			/* 所有者に継承させたプライオリティを戻す */
+			mutex_cancel_wait(entry);
+		}
+	}
+	struct task_entry *joined = terminate_task(entry);
+	release_task(entry);
+	kernel_enable_context_switch();
+	if (joined != NULL) {
+		kernel_request_swtich();
+	}
+
+	return 0;
+}
+
+/**
+ * 自タスクを終了する。
+ * タスクの関数から戻った場合と同じく、終了を待っているタスクを待機解除する。
+ * ロックしているミューテックスは全て解放し、待っているタスクに所有権を渡す。
+ * 制御は返らない。
+ */
+void
+kernel_exit_task(void)
+{
+	struct task_entry *entry = CurrentTask;
+	if (entry == NULL) {
+		return ;
+	}
+
+	kernel_disable_context_switch();
+	terminate_task(entry);
 
-    task_list_add(&ActiveEntries, entry);
+	/* 終了したタスクには戻らない。エントリとスタックはスケジューラが回収する */
+	sysc_trap();
+}
 
-    return (int)(entry->param.id);
+/**
+ * タスクの終了を待つ。
+ * 終了済みのタスクを指定した場合には、待機せずに返る。
+ *
+ * @param taskid タスクID
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+kernel_join_task(int taskid)
+{
+	return join_task(taskid, 0, 0);
 }
 
+/**
+ * タスクの終了を待つ。
+ * 終了済みのタスクを指定した場合には、待機せずに返る。
+ *
+ * @param taskid タスクID
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+int
+kernel_timedjoin_task(int taskid, uint32_t timeout_millis)
+{
+	return join_task(taskid, 1, timeout_millis);
+}
 
 /**
- * タスクのスタックを初期化する。
+ * タスクの終了を待つ。
  *
- * @param stack タスク
- * @param func タスクエントリ関数
- * @param arg タスクエントリ関数に渡す引数。
- * @return TCBポインタ。
+ * @param taskid タスクID
+ * @param is_timed タイムアウトするかどうか
+ * @param timeout_millis タイムアウト時間[ミリ秒]
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
  */
-static void*
-init_stack(void *stack, void *func, void *arg)
+static int
+join_task(int taskid, uint8_t is_timed, uint32_t timeout_millis)
 {
-    uint32_t *p = (uint32_t*)(stack);
+	struct task_entry *self = CurrentTask;
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
+	}
+	if ((taskid <= 0) || (taskid == self->param.id)) {
+		return ERR_INVAL;
+	}
+
+	kernel_disable_context_switch();
+	struct task_entry *entry = find_task(taskid);
+	if ((entry == NULL) || (entry->param.state == TASK_STATE_DEAD)) {
+		/* 既に終了している */
+		kernel_enable_context_switch();
+		return 0;
+	}
+
+	/* 終了時にterminate_task()で待機解除される */
+	if (!is_timed) {
+		return kernel_sysc_wait_object(&(entry->join_obj));
+	} else {
+		return kernel_sysc_wait_object_timeout(&(entry->join_obj), timeout_millis);
+	}
+}
 
-    /* CC for RX でのINT割り込みが発生した時、退避されるレジスタをエミュレートする */
-    *(--p) = 0x0;
+/**
+ * タスクを終了状態にし、終了を待っているタスクを全て待機解除する。
+ * ロックしているミューテックスは、終了したタスクのIDで所有されたままにならないように
+ * 全て解放し、待っているタスクに所有権を渡す。
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param entry タスク
+ * @return 最後に待機解除したタスク。待っているタスクがいない場合にはNULLが返る。
+ */
+static struct task_entry *
+terminate_task(struct task_entry *entry)
+{
+	struct task_entry *joined;
+	struct task_entry *waiter;
+
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_TASK_EXIT, entry->param.id, 0);
+	joined = mutex_release_all(entry);
+	entry->param.state = TASK_STATE_DEAD;
+	while ((waiter = kernel_signal_object(&(entry->join_obj))) != NULL) {
+		joined = waiter;
+	}
 
-    *(--p) = INITIAL_PSW; /* PSW */
+	return joined;
+}
 
-    *(--p) = (uint32_t)(func); /* PC */
+/**
+ * 終了したタスクのエントリを空きタスクに戻す。
+ * スタックプールから割り当てたスタックはプールに戻す。
+ * スケジューラ、またはコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param entry タスク
+ */
+static void
+release_task(struct task_entry *entry)
+{
+	if (entry->stack_pooled) {
+		free_stack(entry->stack);
+	}
+	for (uint8_t i = 0; i < TlsSlotCount; i++) {
+		if ((entry->tls[i] != NULL) && (TlsDestructors[i] != NULL)) {
+			TlsDestructors[i](entry->tls[i]);
+		}
+		entry->tls[i] = NULL;
+	}
+	task_destroy(entry);
+	task_list_add(&BlankEntries, entry);
+	AliveTaskCount--;
+}
 
-    *(--p) = 15; /* R15 */
-    *(--p) = 14; /* R14 */
-    *(--p) = 13; /* R13 */
-    *(--p) = 12; /* R12 */
-    *(--p) = 11; /* R11 */
-    *(--p) = 10; /* R10 */
-    *(--p) = 9; /* R9 */
-    *(--p) = 8; /* R8 */
-    *(--p) = 7; /* R7 */
-    *(--p) = 6; /* R6 */
-    *(--p) = 5; /* R5 */
-    *(--p) = 4; /* R4 */
-    *(--p) = 3; /* R3 */
-    *(--p) = 2; /* R2 */
-    *(--p) = (uint32_t)(arg); /* R1 */
+/**
+ * スタックプールからスタックを割り当てる。
+ * スケジューラ、またはコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @return スタック領域の先頭。空きが無い場合にはNULLが返る。
+ */
+static stack_type_t *
+alloc_stack(void)
+{
+#if KERNEL_STACK_POOL_COUNT > 0
+	stack_type_t *stack = FreeStacks;
+	if (stack != NULL) {
+		FreeStacks = *(stack_type_t **)(stack);
+	}
 
-    *(--p) = INITIAL_FPSW; /* INITIAL_FPSW */
+	return stack;
+#else
+	return NULL;
+#endif
+}
 
-    return p;
+/**
+ * スタックをスタックプールに戻す。
+ * スケジューラ、またはコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param stack スタック領域の先頭
+ */
+static void
+free_stack(stack_type_t *stack)
+{
+#if KERNEL_STACK_POOL_COUNT > 0
+	*(stack_type_t **)(stack) = FreeStacks;
+	FreeStacks = stack;
+#endif
 }
 
+
 /**
  * スケジューラを開始する。
  * 既にスケジューラが動作中の場合には何もしない。
@@ -200,8 +649,7 @@ kernel_start_scheduler(void)
 {
     IsSchedulerRuning = 1;
 
-    task_list_init(&WaitingEntries);
-    wait_object_list_init(&WaitObjectList);
+    sleep_queue_init(&SleepQueue);
 
     /* 戻ってこれるように、現在のTCBを保存するようにする。 */
     CurrentTcb = &ReturnTcb;
@@ -209,225 +657,777 @@ kernel_start_scheduler(void)
     /* 現在のタスクをなしとする */
     CurrentTask = NULL;
 
+#if KERNEL_RUNTIME_STATS
+    kernel_reset_stats();
+#endif
+
+	/* 時間待ちの解除を1ミリ秒毎にチェックする */
+	drv_cmt_set_msec_handler(tick_proc);
+
 	/* ソフトウェア割り込み発行してコンテキストスイッチする */
     ContextSwitchEnable = 1;
-	ICU.SWINTR.BIT.SWINT = 1;
+	KERNEL_PORT_REQUEST_SWITCH();
 
 	while (IsSchedulerRuning) {
 		rx_util_wait();
 	}
 
+	drv_cmt_set_msec_handler(NULL);
+
     /* ここに制御が返るのは、全てのスレッドが完了している場合のみ */
 }
 
 /**
  * コンテキストスイッチを無効にする。
+ * ネストして呼び出すことができ、同じ回数kernel_enable_context_switch()を
+ * 呼び出すまで無効のままになる。
+ * 割り込みはマスクしない。
  */
 void
 kernel_disable_context_switch(void)
 {
+	/* 先にネスト数を増やしておけば、フラグを落とす前に切り替えられても
+	 * ディスパッチ時に無効のまま復元される */
+	ContextSwitchLockCount++;
 	ContextSwitchEnable = 0;
 }
 
 /**
  * コンテキストスイッチを有効にする。
+ * ネストしている場合には、最も外側の呼び出しで有効になる。
  */
 void
 kernel_enable_context_switch(void)
 {
-	/* IsSchedulerRuningが有効なときだけ設定可能 */
-	ContextSwitchEnable = IsSchedulerRuning;
-}
-
-/**
- * タスクが存在しているかどうかを取得する。
- *
- * @param taskid タスクID
- * @return 生存している場合には非ゼロの値、生存していない場合には0が返る。
- */
-int
-kernel_task_is_alive(int taskid)
-{
-	for (int i = 0; i < MAX_TASKS; i++) {
-		const struct task_entry *entry = &(TaskEntries[i]);
-		if (entry->param.id == taskid) {
-			return (entry->param.state != TASK_STATE_DEAD);
+	if (ContextSwitchLockCount > 0) {
+		ContextSwitchLockCount--;
+	}
+	if (ContextSwitchLockCount == 0) {
+		/* IsSchedulerRuningが有効なときだけ設定可能 */
+		ContextSwitchEnable = IsSchedulerRuning;
+		if (IsrRequestCount > 0) {
+			/* 無効にしている間に割り込みハンドラから要求された */
+			kernel_request_swtich();
 		}
 	}
-
-	return 0;
 }
 
 /**
- * 現在のタスクのIDを得る。
+ * クリティカルセクションに入る。
+ * 割り込みレベルをKERNEL_PRIORITYまで上げ、KERNEL_PRIORITY以下の割り込みと
+ * コンテキストスイッチ(ソフトウェア割り込み)を止める。
+ * KERNEL_PRIORITYより高い割り込みはマスクしない。
+ * ユーザーモード(タスク)では割り込みレベルを直接変更できないため、
+ * トラップ(kernel_port_enter_critical())で上げる。
+ * ネストして呼び出すことができる。
  *
- * @return タスクID
+ * @return kernel_exit_critical()に渡す値
  */
-int
-kernel_get_self_id(void)
+uint32_t
+kernel_enter_critical(void)
 {
-	const struct task_entry *entry = CurrentTask;
-	if (entry != NULL) {
-		return entry->param.id;
+	if (rx_util_is_user_mode()) {
+		return kernel_port_enter_critical();
 	} else {
-		return 0;
+		return rx_util_enter_critical(KERNEL_PRIORITY);
 	}
 }
 
-
 /**
- * スケジューラを更新する。
+ * クリティカルセクションから出る。
+ *
+ * @param state kernel_enter_critical()が返した値
  */
 void
-kernel_update_scheduler(void)
+kernel_exit_critical(uint32_t state)
 {
-	if (CurrentTask != NULL) {
-		if (CurrentTask->param.state == TASK_STATE_DEAD) {
-			task_list_add(&BlankEntries, CurrentTask);
-		} else if (CurrentTask->param.state == TASK_STATE_WAITING) {
-			if (CurrentTask->param.syscall_type == SYSCALL_WAIT_OBJECT) {
-				/* ウォッチするため、待機オブジェクトリストに追加する。 */
-				struct wait_object *wait_obj = CurrentTask->param.sysc.wait_object;
-				wait_object_list_add(&WaitObjectList, wait_obj);
-			}
-			task_list_add(&WaitingEntries, CurrentTask);
-		} else {
-			CurrentTask->param.state = TASK_STATE_PENDING;
-			task_list_add(&ActiveEntries, CurrentTask);
-		}
-		CurrentTask = NULL;
-	}
-
-	/* 待機オブジェクトを更新する */
-	update_waiting_objects();
-
-	/* Waitingステートのタスクを更新し、待機完了したタスクをスケジューラに回す */
-	update_waiting_tasks();
-
-	while (1) {
-	    /* 次に実行するタスクを取得する */
-	    CurrentTask = next_task();
-	    if (CurrentTask != NULL) {
-	    	break;
-	    } else if (task_list_is_empty(&WaitingEntries)) {
-	    	/* タスクが全てなくなった */
-	    	break;
-	    } else {
-	    	/* WaitingEntriesの待機解除され無い場合には、待機状態を更新する。 */
-	    	ContextSwitchEnable = 0;
-	    	rx_util_enable_interrupt();
-	    	rx_util_set_ipl(0);
-	    	/* update_waiting_objectは、他のタスクが実行されているわけではないので更新不要 */
-	    	update_waiting_tasks();
-	    	rx_util_set_ipl(KERNEL_PRIORITY);
-	    	rx_util_disable_interrupt();
-	    	ContextSwitchEnable = 1;
-	    }
+	if (rx_util_is_user_mode_psw(state)) {
+		kernel_port_exit_critical(state);
+	} else {
+		rx_util_exit_critical(state);
 	}
-    if (CurrentTask != NULL) {
-    	CurrentTask->param.state = TASK_STATE_ACTIVE;
-        CurrentTcb = &(CurrentTask->param.tcb);
-    } else {
-    	IsSchedulerRuning = 0;
-        CurrentTcb = &(ReturnTcb);
-    }
 }
 
 /**
- * 次に実行するべきタスクを得る。
+ * 割り込みハンドラから、スケジューラで実行する処理を依頼する。
+ * タスクがコンテキストスイッチを無効にしてカーネルオブジェクトを操作している最中でも
+ * 割り込みハンドラは実行されるため、割り込みハンドラからは直接操作せず、
+ * スケジューラで実行させる。
+ * 処理はソフトウェア割り込みで実行され、待機解除されたタスクは割り込みからの復帰時に
+ * ディスパッチされる。
+ * タスクがコンテキストスイッチを無効にしている場合には、有効にした時点で実行される。
+ *
+ * 割り込みハンドラ（スーパーバイザモード）から呼び出すこと。
  *
- * @return 次に実行するべきタスク。
+ * @param proc 実行する処理
+ * @param obj procに渡すオブジェクト
+ * @param value procに渡す値
+ * @return 成功した場合には0、要求キューが一杯の場合にはERR_NOMEMを返す。
  */
-static struct task_entry *
-next_task(void)
+int
+kernel_request_from_isr(kernel_isr_proc_t proc, void *obj, uintptr_t value)
 {
-	/* ActiveTasksから、最もプライオリティが高いやつを引っ張り出して返す */
-	struct task_entry* entry = task_list_head(&ActiveEntries);
-	if (entry == NULL) {
-		return NULL;
-	} else {
-		struct task_entry *ret_entry = entry;
-		while (entry != NULL) {
-			if (entry->param.priority > ret_entry->param.priority) {
-				ret_entry = entry;
-			}
-			entry = entry->next;
+	int is_interrupt_enable = rx_util_is_interrupt_enable();
+	int retval;
+
+	/* 多重割り込みで同時に追加されないように、割り込みを禁止する */
+	rx_util_disable_interrupt();
+	if (IsrRequestCount < KERNEL_ISR_QUEUE_SIZE) {
+		uint16_t tail = IsrRequestHead + IsrRequestCount;
+		if (tail >= KERNEL_ISR_QUEUE_SIZE) {
+			tail -= KERNEL_ISR_QUEUE_SIZE;
 		}
+		IsrRequests[tail].proc = proc;
+		IsrRequests[tail].obj = obj;
+		IsrRequests[tail].value = value;
+		IsrRequestCount++;
+		retval = 0;
+		KERNEL_TRACE_SELF(KERNEL_TRACE_ISR_REQUEST, obj);
+	} else {
+		retval = ERR_NOMEM;
+	}
+	if (is_interrupt_enable) {
+		rx_util_enable_interrupt();
+	}
 
-		task_list_remove(&ActiveEntries, ret_entry);
-
-		return ret_entry;
+	if (retval == 0) {
+		/* ソフトウェア割り込みは、より高い割り込みレベルのハンドラから復帰した後に受け付けられる */
+		kernel_request_swtich();
 	}
+
+	return retval;
 }
 
 /**
- * 待機オブジェクトの状態を更新する。
+ * 割り込みハンドラから依頼された処理を実行する。
+ * スケジューラから、割り込み禁止状態で呼び出される。
  */
 static void
-update_waiting_objects(void)
-{
-	struct wait_object *wait_obj = wait_object_list_head(&WaitObjectList);
-	while (wait_obj != NULL) {
-		struct wait_object *next_obj = wait_obj;
-		/* wait_object 更新 */
-		wait_object_update(next_obj);
-		if (!wait_object_has_wait_entries(next_obj)) {
-			wait_object_list_remove(&WaitObjectList, wait_obj);
+process_isr_requests(void)
+{
+	while (IsrRequestCount > 0) {
+		struct isr_request *req = &(IsrRequests[IsrRequestHead]);
+		req->proc(req->obj, req->value);
+		IsrRequestHead++;
+		if (IsrRequestHead >= KERNEL_ISR_QUEUE_SIZE) {
+			IsrRequestHead = 0;
 		}
-		wait_obj = wait_obj->next;
+		IsrRequestCount--;
 	}
 }
 
+/**
+ * タスクが存在しているかどうかを取得する。
+ * 終了したタスクのIDは、エントリが別のタスクに再利用された後も生存していないと判定される。
+ *
+ * @param taskid タスクID
+ * @return 生存している場合には非ゼロの値、生存していない場合には0が返る。
+ */
+int
+kernel_task_is_alive(int taskid)
+{
+	const struct task_entry *entry = find_task(taskid);
+	if (entry != NULL) {
+		return (entry->param.state != TASK_STATE_DEAD);
+	}
+
+	return 0;
+}
+
+/**
+ * タスクのタイムスライスを設定する。
+ * 新しい値は、次にタイムスライスを割り当てる時から有効になる。
+ *
+ * @param taskid タスクID
+ * @param slice_millis タイムスライス[ミリ秒]。0を指定するとラウンドロビンしない。
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+kernel_set_time_slice(int taskid, uint16_t slice_millis)
+{
+	/* 探してから書き込むまでの間に、削除されたエントリが再利用されないようにする */
+	kernel_disable_context_switch();
+	struct task_entry *entry = find_task(taskid);
+	if ((entry == NULL) || (entry->param.state == TASK_STATE_DEAD)) {
+		kernel_enable_context_switch();
+		return ERR_INVAL;
+	}
+	entry->param.time_slice = slice_millis;
+	kernel_enable_context_switch();
+
+	return 0;
+}
+
+/**
+ * タスクのスタックの使用状況を得る。
+ * 最大使用量は、登録時に塗りつぶした値が書き換えられている範囲から求める。
+ * 割り込みハンドラはタスクのスタックを使用しないため、含まれない。
+ *
+ * @param taskid タスクID
+ * @param info 使用状況を格納する変数
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ *         KERNEL_STACK_CHECK が無効の場合にはERR_OPERATION_STATEが返る。
+ */
+int
+kernel_get_stack_info(int taskid, struct kernel_stack_info *info)
+{
+#if KERNEL_STACK_CHECK
+	kernel_disable_context_switch();
+	const struct task_entry *entry = find_task(taskid);
+	if ((entry == NULL) || (entry->param.state == TASK_STATE_DEAD)) {
+		kernel_enable_context_switch();
+		return ERR_INVAL;
+	}
+	info->size = entry->stack_size;
+	info->max_used = get_stack_max_used(entry);
+	info->overflow = entry->stack_overflow || (info->max_used >= entry->stack_size);
+	kernel_enable_context_switch();
+
+	return 0;
+#else
+	return ERR_OPERATION_STATE;
+#endif
+}
+
+/**
+ * スタックオーバーフローを検出した時に呼び出される処理を設定する。
+ * 処理はスケジューラから、オーバーフローしたタスクを切り替える時に呼び出される。
+ * 検出できるのは最下位ワードが書き換えられた場合だけなので、
+ * 既に隣接する領域が破壊されている可能性がある。
+ *
+ * @param handler 処理。NULLの場合は検出結果を記録するだけになる。
+ */
+void
+kernel_set_stack_overflow_handler(kernel_stack_overflow_handler_t handler)
+{
+	StackOverflowHandler = handler;
+}
+
+/**
+ * 生存している全てのタスクのスタックの使用状況をデバッグ出力する。
+ * スタックを計測したサイズまで縮める時の目安にする。
+ */
+void
+kernel_report_stacks(void)
+{
+	for (int i = 0; i < MAX_TASKS; i++) {
+		int taskid = TaskEntries[i].param.id;
+		struct kernel_stack_info info;
+		if ((taskid != 0) && (kernel_get_stack_info(taskid, &info) == 0)) {
+			rx_debug("task %u: stack %u/%u bytes%s\n", (uint32_t)(taskid),
+					info.max_used, info.size, info.overflow ? " OVERFLOW" : "");
+		}
+	}
+}
+
+/**
+ * タスクの実行統計を得る。
+ * 自タスクを指定した場合、実行時間には今回ディスパッチされてからの時間を含む。
+ *
+ * @param taskid タスクID
+ * @param stats 実行統計を格納する変数
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ *         KERNEL_RUNTIME_STATS が無効の場合にはERR_OPERATION_STATEが返る。
+ */
+int
+kernel_get_task_stats(int taskid, struct kernel_task_stats *stats)
+{
+#if KERNEL_RUNTIME_STATS
+	kernel_disable_context_switch();
+	const struct task_entry *entry = find_task(taskid);
+	if ((entry == NULL) || (entry->param.state == TASK_STATE_DEAD)) {
+		kernel_enable_context_switch();
+		return ERR_INVAL;
+	}
+	stats->run_time = entry->run_time;
+	if (entry == CurrentTask) {
+		stats->run_time += drv_cmt_get_usec_counter() - DispatchTime;
+	}
+	stats->switch_count = entry->switch_count;
+	stats->voluntary_count = entry->voluntary_count;
+	stats->preempted_count = entry->preempted_count;
+	kernel_enable_context_switch();
+
+	return 0;
+#else
+	return ERR_OPERATION_STATE;
+#endif
+}
+
+/**
+ * CPU全体の実行統計を得る。
+ * KERNEL_RUNTIME_STATS が無効の場合には全て0になる。
+ *
+ * @param stats 実行統計を格納する変数
+ */
+void
+kernel_get_cpu_stats(struct kernel_cpu_stats *stats)
+{
+	rx_memset(stats, 0x0, sizeof(struct kernel_cpu_stats));
+#if KERNEL_RUNTIME_STATS
+	kernel_disable_context_switch();
+	stats->elapsed_millis = drv_cmt_get_counter() - StatsStartTick;
+	stats->idle_time = IdleTime;
+	stats->switch_count = SwitchCount;
+	kernel_enable_context_switch();
+
+	if (stats->elapsed_millis > 0) {
+		/* idle_time[マイクロ秒] / elapsed_millis[ミリ秒] がそのまま‰になる */
+		uint64_t permille = stats->idle_time / stats->elapsed_millis;
+		stats->idle_permille = (permille < 1000) ? (uint16_t)(permille) : 1000;
+	}
+#endif
+}
+
+/**
+ * 実行統計をクリアし、計測をやり直す。
+ * kernel_start_scheduler()でもクリアされる。
+ */
+void
+kernel_reset_stats(void)
+{
+#if KERNEL_RUNTIME_STATS
+	kernel_disable_context_switch();
+	for (int i = 0; i < MAX_TASKS; i++) {
+		struct task_entry *entry = &(TaskEntries[i]);
+		entry->run_time = 0;
+		entry->switch_count = 0;
+		entry->voluntary_count = 0;
+		entry->preempted_count = 0;
+	}
+	IdleTime = 0;
+	SwitchCount = 0;
+	StatsStartTick = drv_cmt_get_counter();
+	DispatchTime = drv_cmt_get_usec_counter();
+	kernel_enable_context_switch();
+#endif
+}
+
+/**
+ * CPU全体と、生存している全てのタスクの実行統計をデバッグ出力する。
+ */
+void
+kernel_report_stats(void)
+{
+	struct kernel_cpu_stats cpu;
+	kernel_get_cpu_stats(&cpu);
+	rx_debug("cpu: elapsed %u ms, idle %u.%u%%, switch %u\n", cpu.elapsed_millis,
+			(uint32_t)(cpu.idle_permille / 10), (uint32_t)(cpu.idle_permille % 10),
+			cpu.switch_count);
+
+	for (int i = 0; i < MAX_TASKS; i++) {
+		int taskid = TaskEntries[i].param.id;
+		struct kernel_task_stats stats;
+		if ((taskid != 0) && (kernel_get_task_stats(taskid, &stats) == 0)) {
+			uint32_t permille = 0;
+			if (cpu.elapsed_millis > 0) {
+				permille = (uint32_t)(stats.run_time / cpu.elapsed_millis);
+			}
+			rx_debug("task %u: run %u ms (%u.%u%%), switch %u, voluntary %u, preempted %u\n",
+					(uint32_t)(taskid), (uint32_t)(stats.run_time / 1000),
+					permille / 10, permille % 10, stats.switch_count,
+					stats.voluntary_count, stats.preempted_count);
+		}
+	}
+}
+
+#if KERNEL_STACK_CHECK
+/**
+ * スタックの最大使用量を求める。
+ * スタックは上位アドレスから使用されるため、下位アドレスから塗りつぶした値が
+ * 残っている範囲を数える。
+ *
+ * @param entry タスク
+ * @return 最大使用量[バイト]
+ */
+static uint32_t
+get_stack_max_used(const struct task_entry *entry)
+{
+	uint32_t words = entry->stack_size / sizeof(stack_type_t);
+	uint32_t unused = 0;
+	while ((unused < words) && (entry->stack[unused] == KERNEL_STACK_PAINT_PATTERN)) {
+		unused++;
+	}
+
+	return (words - unused) * sizeof(stack_type_t);
+}
+
+/**
+ * スタックのガードワードを確認する。
+ * 最下位ワードが塗りつぶした値から書き換えられていればオーバーフローとして記録し、
+ * 設定されていれば処理を呼び出す。
+ * タスクを切り替える度に呼び出すため、1ワードの比較だけにしている。
+ *
+ * @param entry タスク
+ */
+static void
+check_stack(struct task_entry *entry)
+{
+	if (!entry->stack_overflow && (entry->stack[0] != KERNEL_STACK_PAINT_PATTERN)) {
+		entry->stack_overflow = 1;
+		if (StackOverflowHandler != NULL) {
+			StackOverflowHandler(entry->param.id);
+		}
+	}
+}
+#endif
+
+/**
+ * タスクIDに対応するタスクエントリを得る。
+ * タスクIDの下位ビットがエントリの位置を表すため、走査せずに求まる。
+ * エントリが再利用された後の古いタスクIDは、世代番号が一致しないため見つからない。
+ *
+ * @param taskid タスクID
+ * @return タスクエントリ。見つからない場合にはNULLが返る。
+ */
+static struct task_entry *
+find_task(int taskid)
+{
+	if (taskid <= 0) {
+		return NULL;
+	}
+	int index = taskid & TASK_ID_INDEX_MASK;
+	if (index >= MAX_TASKS) {
+		return NULL;
+	}
+	struct task_entry *entry = &(TaskEntries[index]);
+	if (entry->param.id != taskid) {
+		return NULL;
+	}
+
+	return entry;
+}
+
+/**
+ * 現在のタスクのIDを得る。
+ *
+ * @return タスクID
+ */
+int
+kernel_get_self_id(void)
+{
+	const struct task_entry *entry = CurrentTask;
+	if (entry != NULL) {
+		return entry->param.id;
+	} else {
+		return 0;
+	}
+}
+
+/**
+ * タスク毎のローカルストレージ(TLS)のスロットを割り当てる。
+ * スロットは全てのタスクで共通で、各タスクの値はNULLから始まる。
+ * 割り当てたスロットは解放できない。
+ *
+ * @param destructor タスクが終了した時に、NULLでない値に対して呼び出される処理。不要ならNULL。
+ * @return 成功した場合、スロット番号が返る。空きが無い場合、-1が返る。
+ */
+int
+kernel_tls_alloc(kernel_tls_destructor_t destructor)
+{
+	int slot = -1;
+
+	/* タスクの終了処理(release_task)と排他する */
+	uint32_t state = kernel_enter_critical();
+	if (TlsSlotCount < KERNEL_TLS_SLOTS) {
+		slot = TlsSlotCount;
+		TlsDestructors[slot] = destructor;
+		TlsSlotCount++;
+	}
+	kernel_exit_critical(state);
+
+	return slot;
+}
+
+/**
+ * 実行中のタスクのTLSの値を得る。
+ *
+ * @param slot kernel_tls_alloc()で割り当てたスロット番号
+ * @return 値。タスク以外(スケジューラ開始前や割り込みハンドラ)から呼び出した場合や、
+ *         スロット番号が不正な場合はNULLが返る。
+ */
+void *
+kernel_tls_get(int slot)
+{
+	struct task_entry *entry = CurrentTask;
+	if ((entry == NULL) || !rx_util_is_user_mode()
+			|| (slot < 0) || (slot >= TlsSlotCount)) {
+		return NULL;
+	}
+	return entry->tls[slot];
+}
+
+/**
+ * 実行中のタスクのTLSに値を設定する。
+ * 以前の値に対してデストラクタは呼び出さない。
+ *
+ * @param slot kernel_tls_alloc()で割り当てたスロット番号
+ * @param value 値
+ * @return 成功した場合、0が返る。
+ *         スロット番号が不正な場合は ERR_INVAL、
+ *         タスク以外(スケジューラ開始前や割り込みハンドラ)から呼び出した場合は ERR_OPERATION_STATE が返る。
+ */
+int
+kernel_tls_set(int slot, void *value)
+{
+	struct task_entry *entry = CurrentTask;
+	if ((slot < 0) || (slot >= TlsSlotCount)) {
+		return ERR_INVAL;
+	}
+	if ((entry == NULL) || !rx_util_is_user_mode()) {
+		return ERR_OPERATION_STATE;
+	}
+	entry->tls[slot] = value;
+	return 0;
+}
+
+
+/**
+ * スケジューラを更新する。
+ * ソフトウェア割り込みまたはシステムコールトラップから呼び出される。
+ */
+void
+kernel_update_scheduler(void)
+{
+	/* このパスで全ての切り替え要因を処理するため、保留中の切り替え要求は破棄する */
+	KERNEL_PORT_CLEAR_SWITCH();
+
+#if KERNEL_RUNTIME_STATS
+	struct task_entry *prev_task = CurrentTask;
+	uint8_t is_voluntary = IsSyscall;
+	if (CurrentTask != NULL) {
+		/* 1回の実行が約71分を超えると、カウンタが一周して正しく計測できない */
+		CurrentTask->run_time += drv_cmt_get_usec_counter() - DispatchTime;
+	}
+#endif
+
+	if (CurrentTask != NULL) {
+		/* システムコールで無効にした分は、ディスパッチされた時に解除されている */
+		uint16_t lock_count = ContextSwitchLockCount;
+		if (IsSyscall && (lock_count > 0)) {
+			lock_count--;
+		}
+		CurrentTask->param.lock_count = lock_count;
+#if KERNEL_STACK_CHECK
+		check_stack(CurrentTask);
+#endif
+
+		if (CurrentTask->param.state == TASK_STATE_DEAD) {
+			/* 終了したタスクのスタック上ではもう動作していないので、ここで回収する */
+			release_task(CurrentTask);
+		} else if (CurrentTask->param.state == TASK_STATE_WAITING) {
+			/* 待機オブジェクトを待つタスクは待機オブジェクトが保持しており、
+			 * 待機解除時にwakeup_task()でレディキューに戻される。
+			 * タイムアウトがある場合は、スリープキューにも登録する。 */
+			if ((CurrentTask->param.syscall_type == SYSCALL_WAIT_MSEC)
+					|| (CurrentTask->param.syscall_type == SYSCALL_WAIT_OBJECT_TIMEOUT)) {
+				sleep_queue_add(&SleepQueue, CurrentTask);
+			}
+			/* 待機解除後は新しいタイムスライスを割り当てる */
+			CurrentTask->param.slice_left = 0;
+		} else if (CurrentTask->param.state == TASK_STATE_PENDING) {
+			/* 切り替え前に待機解除され、既にレディキューに登録されている */
+			CurrentTask->param.slice_left = 0;
+		} else if (SliceExpired) {
+			/* タイムスライスを使い切ったので、同じプライオリティの末尾に回す */
+			CurrentTask->param.state = TASK_STATE_PENDING;
+			CurrentTask->param.slice_left = 0;
+			ready_queue_add(&ReadyQueue, CurrentTask);
+		} else {
+			/* 割り込まれただけなので、残りのタイムスライスを持って先頭に戻す */
+			CurrentTask->param.state = TASK_STATE_PENDING;
+			ready_queue_add_head(&ReadyQueue, CurrentTask);
+		}
+		CurrentTask = NULL;
+	}
+	SliceExpired = 0;
+	IsSyscall = 0;
+
+	/* 割り込みハンドラから待機解除されたタスクをスケジューラに回す */
+	process_isr_requests();
+	/* 待機解除時刻に到達したタスクをスケジューラに回す */
+	wakeup_sleeping_tasks();
+
+	while (1) {
+	    /* 次に実行するタスクを取得する */
+	    CurrentTask = ready_queue_pop(&ReadyQueue);
+	    if (CurrentTask != NULL) {
+	    	break;
+	    } else if (AliveTaskCount == 0) {
+	    	/* タスクが全てなくなった */
+	    	break;
+	    } else {
+	    	/* 実行可能なタスクが無い場合には、割り込みが発生するまで待機する。 */
+	    	KERNEL_TRACE_EVENT(KERNEL_TRACE_IDLE_ENTER, 0, 0);
+#if KERNEL_RUNTIME_STATS
+	    	uint32_t idle_start = drv_cmt_get_usec_counter();
+	    	idle_proc();
+	    	IdleTime += drv_cmt_get_usec_counter() - idle_start;
+#else
+	    	idle_proc();
+#endif
+	    	KERNEL_TRACE_EVENT(KERNEL_TRACE_IDLE_EXIT, 0, 0);
+	    }
+	}
+#if KERNEL_RUNTIME_STATS
+	if (CurrentTask != prev_task) {
+		/* 同じタスクに戻る場合は切り替えとして数えない */
+		if ((prev_task != NULL) && (prev_task->param.state != TASK_STATE_DEAD)) {
+			if (is_voluntary) {
+				prev_task->voluntary_count++;
+			} else {
+				prev_task->preempted_count++;
+			}
+		}
+		if (CurrentTask != NULL) {
+			CurrentTask->switch_count++;
+		}
+		SwitchCount++;
+	}
+	DispatchTime = drv_cmt_get_usec_counter();
+#endif
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_DISPATCH, (CurrentTask != NULL) ? CurrentTask->param.id : 0, 0);
+    if (CurrentTask != NULL) {
+    	CurrentTask->param.state = TASK_STATE_ACTIVE;
+    	if (CurrentTask->param.slice_left == 0) {
+    		CurrentTask->param.slice_left = CurrentTask->param.time_slice;
+    	}
+        CurrentTcb = &(CurrentTask->param.tcb);
+        /* システムコールはコンテキストスイッチ無効のままトラップするため、
+         * ディスパッチするタスクが無効にしていた状態に戻す。 */
+        ContextSwitchLockCount = CurrentTask->param.lock_count;
+        ContextSwitchEnable = (ContextSwitchLockCount == 0);
+    } else {
+    	ContextSwitchLockCount = 0;
+    	IsSchedulerRuning = 0;
+        CurrentTcb = &(ReturnTcb);
+    }
+}
 
 /**
- * 待機タスクの状態を更新する。
+ * 待機解除時刻に到達したタスクをレディキューに戻す。
+ * スリープキューは待機解除時刻順に並んでいるため、
+ * 待機解除されないタスクは走査しない。
+ * 待機オブジェクトを待っているタスクは、待機オブジェクトから外してタイムアウトさせる。
  */
 static void
-update_waiting_tasks(void)
+wakeup_sleeping_tasks(void)
 {
-	/* 待機条件を更新してアクティブ列に渡す */
-	struct task_entry *entry = task_list_head(&WaitingEntries);
+	uint32_t now = drv_cmt_get_counter();
+	struct task_entry *entry = sleep_queue_pop_expired(&SleepQueue, now);
 	while (entry != NULL) {
-		struct task_entry *next_entry = entry->next;
-		if (update_waiting_condition(entry)) {
-			/* 待機完了したので、アクティブ列に戻す */
-			task_list_remove(&WaitingEntries, entry);
-			entry->param.state = TASK_STATE_PENDING;
-			task_list_add(&ActiveEntries, entry);
+		if (entry->param.syscall_type == SYSCALL_WAIT_OBJECT_TIMEOUT) {
+			struct wait_object *wait_obj = entry->param.sysc.wait_object;
+			if (wait_obj != NULL) {
+				wait_object_remove(wait_obj, entry);
+				entry->param.sysc.wait_object = NULL;
+			}
+			entry->param.wait_result = ERR_TIMEOUT;
+			KERNEL_TRACE_EVENT(KERNEL_TRACE_TIMEOUT, entry->param.id, wait_obj);
 		}
-		entry = next_entry;
+		wakeup_task(entry);
+		entry = sleep_queue_pop_expired(&SleepQueue, now);
 	}
 }
 
 /**
- * 待機条件を更新する。
+ * 実行可能なタスクが無い時の待機処理をする。
+ * 割り込み禁止状態で呼び出され、割り込み禁止状態で返る。
  *
- * @param entry タスク
- * @return 待機完了した場合には非ゼロの値を返す。それ以外は0を返す。
+ * WAIT命令で割り込みが発生するまで待機し、割り込みハンドラから依頼された処理を実行して、
+ * 待機解除時刻に到達したタスクをレディキューに戻す。
+ * KERNEL_TICKLESS_IDLE が有効な場合、待機中は次の待機解除時刻まで
+ * タイマー割り込みを止める。
  */
-static int
-update_waiting_condition(struct task_entry *entry)
+static void
+idle_proc(void)
 {
-	/* ここでウェイト条件を調べて返す */
-	union system_call_param *sysc = &(entry->param.sysc);
+	/* 待機中の割り込みからはタスクの切り替え要求を出させない */
+	ContextSwitchEnable = 0;
 
-	switch (entry->param.syscall_type) {
-	case SYSCALL_WAIT_MSEC:
-	{
+#if KERNEL_TICKLESS_IDLE
+	uint32_t idle_millis = 0xffffffff; /* 時間待ちのタスクが無い場合は最大まで止める */
+	const struct task_entry *entry = sleep_queue_head(&SleepQueue);
+	if (entry != NULL) {
 		uint32_t now = drv_cmt_get_counter();
-		return ((now - sysc->wait.begin) >= sysc->wait.wait_millis);
+		idle_millis = sleep_queue_is_expired(entry, now) ? 0 : (entry->param.wakeup_tick - now);
+	}
+	if (IsrRequestCount > 0) {
+		/* 割り込みハンドラからの要求があるので待機しない */
+		idle_millis = 0;
 	}
-	case SYSCALL_WAIT_OBJECT:
-	{
-		struct wait_object *wait_obj = sysc->wait_object;
-		return (wait_obj == NULL) || !wait_object_is_waiting_entry(wait_obj, entry);
+	if (idle_millis > 0) {
+		drv_cmt_enter_tickless(idle_millis);
+		/* WAIT命令は割り込みを許可してから待機するため、割り込みの取りこぼしは無い */
+		rx_util_set_ipl(0);
+		rx_util_wait();
+		rx_util_disable_interrupt();
+		rx_util_set_ipl(KERNEL_PRIORITY);
+		drv_cmt_exit_tickless();
+	}
+#else
+	if (IsrRequestCount == 0) {
+		rx_util_set_ipl(0);
+		rx_util_wait();
+		rx_util_disable_interrupt();
+		rx_util_set_ipl(KERNEL_PRIORITY);
+	}
+#endif
+
+	process_isr_requests();
+	wakeup_sleeping_tasks();
+
+	ContextSwitchEnable = 1;
+}
+
+/**
+ * 1ミリ秒毎にタイマー割り込みから呼び出される。
+ *
+ * 実行中のタスクのタイムスライスを減らし、使い切った時に同じプライオリティの
+ * 実行可能なタスクがある場合だけタスクの切り替え要求を出す。
+ * 同じプライオリティのタスクが無ければ切り替えず、そのまま実行させる。
+ *
+ * また、待機解除時刻に到達したタスクがある場合にはタスクの切り替え要求を出し、
+ * スケジューラでレディキューに戻させる。
+ * 割り込みハンドラからはレディキューを操作しないため、参照だけ行う。
+ */
+static void
+tick_proc(void)
+{
+	struct task_entry *current = CurrentTask;
+	if ((current != NULL) && (current->param.time_slice > 0)) {
+		if (current->param.slice_left > 0) {
+			current->param.slice_left--;
+		}
+		if ((current->param.slice_left == 0)
+				&& ready_queue_has_priority(&ReadyQueue, current->param.priority)) {
+			SliceExpired = 1;
+			kernel_request_swtich();
+		}
 	}
-	default:
-		return 1;
+
+	const struct task_entry *entry = sleep_queue_head(&SleepQueue);
+	if ((entry != NULL) && sleep_queue_is_expired(entry, drv_cmt_get_counter())) {
+		kernel_request_swtich();
 	}
-	return 1;
 }
 
+/**
+ * 待機状態のタスクを実行可能状態にし、レディキューに戻す。
+ *
+ * @param entry タスク
+ */
+static void
+wakeup_task(struct task_entry *entry)
+{
+	if (entry->param.syscall_type == SYSCALL_WAIT_OBJECT_TIMEOUT) {
+		/* タイムアウト前に待機解除された場合は、スリープキューから外す */
+		sleep_queue_remove(&SleepQueue, entry);
+	}
+	entry->param.state = TASK_STATE_PENDING;
+	ready_queue_add(&ReadyQueue, entry);
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_WAKEUP, entry->param.id, 0);
+}
 
 /**
  * タスクエントリ関数。
@@ -441,9 +1441,21 @@ task_entry_proc(struct task_param *param)
     if (param->func != NULL) {
         param->func(param->arg);
     }
-    param->state = TASK_STATE_DEAD;
 
-    kernel_request_swtich();
+    /* 終了したタスクには戻らない */
+    kernel_exit_task();
+}
+
+/**
+ * システムコールトラップを発行する。
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ * 無効にした分はディスパッチ時に解除されるため、戻った後に有効にする必要は無い。
+ */
+static void
+sysc_trap(void)
+{
+	IsSyscall = 1;
+	kernel_sysc_trap();
 }
 
 /**
@@ -457,58 +1469,224 @@ kernel_request_swtich(void)
 		/* アクティブなタスクが存在する時だけ割り込みを入れて切り替える。
 		 * これをやらないと、待機タスク解除待ちをしている時に通知され、
 		 * スタックオーバーフローする。 */
-        ICU.SWINTR.BIT.SWINT = 1;
+        KERNEL_PORT_REQUEST_SWITCH();
 	}
 }
 
 /**
  * 現在実行中のタスクに待機要求を出すする。
+ * システムコールトラップで同期的に切り替えるため、待機解除されるまで
+ * このタスクにはCPU時間が割り当てられない。
+ * タスク以外(スケジューラ開始前や割り込みハンドラ)から呼び出した場合は何もしない。
  *
  * @param wait_millis 待機時間[ミリ秒]
  */
 void
 kernel_sysc_wait(uint32_t wait_millis)
 {
-	kernel_disable_context_switch();
 	struct task_entry *entry = CurrentTask;
+	if (entry == NULL) {
+		return ;
+	}
+
+	kernel_disable_context_switch();
 	entry->param.syscall_type = SYSCALL_WAIT_MSEC;
-	entry->param.sysc.wait.begin = drv_cmt_get_counter();
-	entry->param.sysc.wait.wait_millis = wait_millis;
+	entry->param.wakeup_tick = drv_cmt_get_counter() + wait_millis;
 	entry->param.state = TASK_STATE_WAITING;
-	kernel_enable_context_switch();
-	kernel_request_swtich();
-	while (entry->param.state == TASK_STATE_WAITING) {
-		rx_util_nop();
-	}
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_SLEEP, entry->param.id, wait_millis);
+	/* コンテキストスイッチ無効のままトラップし、割り込みで切り替えられる隙間を作らない。
+	 * 切り替え後のタスクに対してはスケジューラが有効に戻す。 */
+	sysc_trap();
 }
 
 /**
  * 他のタスクにCPUの使用権を譲る。
+ * 同じプライオリティのタスクの末尾に回される。
+ * タスク以外(スケジューラ開始前や割り込みハンドラ)から呼び出した場合は何もしない。
  */
 void
 kernel_sysc_yield(void)
 {
-	kernel_sysc_wait(1);
+	if (CurrentTask == NULL) {
+		return ;
+	}
+
+	kernel_disable_context_switch();
+	SliceExpired = 1;
+	sysc_trap();
 }
 
 /**
  * 待機オブジェクトに対する待機処理を要求する
+ * 待機解除されるまで返らない。
+ *
+ * 呼び出し元は、待機条件を判定する前にコンテキストスイッチを無効にしておくこと。
+ * 無効にした分はこの関数で解除されるため、戻った後に有効にする必要は無い。
  *
  * @param wait_obj 待機オブジェクト
+ * @return 待機解除された場合には0、タスク以外(スケジューラ開始前や割り込みハンドラ)から
+ *         呼び出した場合にはERR_OPERATION_STATEが返る。
  */
-void
+int
 kernel_sysc_wait_object(struct wait_object *wait_obj)
 {
-	kernel_disable_context_switch();
 	struct task_entry *entry = CurrentTask;
+	if (entry == NULL) {
+		kernel_enable_context_switch();
+		return ERR_OPERATION_STATE;
+	}
 	entry->param.syscall_type = SYSCALL_WAIT_OBJECT;
 	entry->param.sysc.wait_object = wait_obj;
+	entry->param.wait_result = 0;
 	wait_object_add(wait_obj, entry);
 	entry->param.state = TASK_STATE_WAITING;
-	kernel_enable_context_switch();
-	kernel_request_swtich();
-	while (entry->param.state == TASK_STATE_WAITING) {
-		rx_util_nop();
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_WAIT, entry->param.id, wait_obj);
+	sysc_trap();
+
+	return entry->param.wait_result;
+}
+
+/**
+ * タイムアウト付きで待機オブジェクトに対する待機処理を要求する
+ * 待機解除されるか、タイムアウトするまで返らない。
+ * タイムアウトした場合、タスクは待機オブジェクトから外されている。
+ *
+ * 呼び出し元は、待機条件を判定する前にコンテキストスイッチを無効にしておくこと。
+ * 無効にした分はこの関数で解除されるため、戻った後に有効にする必要は無い。
+ *
+ * @param wait_obj 待機オブジェクト
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機せずにタイムアウトする。
+ * @return 待機解除された場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         タスク以外(スケジューラ開始前や割り込みハンドラ)から呼び出した場合には
+ *         ERR_OPERATION_STATEが返る。
+ */
+int
+kernel_sysc_wait_object_timeout(struct wait_object *wait_obj, uint32_t timeout_millis)
+{
+	struct task_entry *entry = CurrentTask;
+	if (entry == NULL) {
+		kernel_enable_context_switch();
+		return ERR_OPERATION_STATE;
+	}
+	if (timeout_millis == 0) {
+		kernel_enable_context_switch();
+		return ERR_TIMEOUT;
 	}
+	entry->param.syscall_type = SYSCALL_WAIT_OBJECT_TIMEOUT;
+	entry->param.sysc.wait_object = wait_obj;
+	entry->param.wakeup_tick = drv_cmt_get_counter() + timeout_millis;
+	entry->param.wait_result = 0;
+	wait_object_add(wait_obj, entry);
+	entry->param.state = TASK_STATE_WAITING;
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_WAIT, entry->param.id, wait_obj);
+	sysc_trap();
+
+	return entry->param.wait_result;
 }
 
+/**
+ * 待機オブジェクトを待っているタスクを1つ待機解除する。
+ * 待機解除したタスクは直ちにレディキューに戻されるため、
+ * スケジューラが待機中のタスクを走査する必要はない。
+ *
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ * 待機解除したタスクを実行させるには、コンテキストスイッチを有効にした後に
+ * kernel_request_swtich()を呼び出すこと。
+ *
+ * @param wait_obj 待機オブジェクト
+ * @return 待機解除したタスク。待っているタスクがいない場合にはNULLが返る。
+ */
+struct task_entry *
+kernel_signal_object(struct wait_object *wait_obj)
+{
+	struct task_entry *entry = wait_object_release_one(wait_obj);
+	if (entry != NULL) {
+		wakeup_task(entry);
+	}
+
+	return entry;
+}
+
+/**
+ * 待機オブジェクトを待っている特定のタスクを待機解除する。
+ * 解放順序に関係なく、条件が成立したタスクだけを待機解除する場合に使用する。
+ *
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ * 待機解除したタスクを実行させるには、コンテキストスイッチを有効にした後に
+ * kernel_request_swtich()を呼び出すこと。
+ *
+ * @param wait_obj 待機オブジェクト
+ * @param entry タスク。wait_objを待っているタスクであること。
+ */
+void
+kernel_signal_task(struct wait_object *wait_obj, struct task_entry *entry)
+{
+	wait_object_remove(wait_obj, entry);
+	if (entry->param.sysc.wait_object == wait_obj) {
+		entry->param.sysc.wait_object = NULL;
+	}
+	wakeup_task(entry);
+
+	return ;
+}
+
+/**
+ * 現在のタスクを得る。
+ *
+ * @return タスク。スケジューラが動作していない場合にはNULLが返る。
+ */
+struct task_entry *
+kernel_get_current_task(void)
+{
+	return CurrentTask;
+}
+
+/**
+ * タスクIDに対応するタスクを得る。
+ *
+ * @param taskid タスクID
+ * @return タスク。存在しない場合にはNULLが返る。
+ */
+struct task_entry *
+kernel_get_task(int taskid)
+{
+	struct task_entry *entry = find_task(taskid);
+	if ((entry == NULL) || (entry->param.state == TASK_STATE_DEAD)) {
+		return NULL;
+	}
+
+	return entry;
+}
+
+/**
+ * タスクのプライオリティを変更する。
+ * 優先度継承のために使用する。本来のプライオリティ(base_priority)は変更しない。
+ * レディキューにあるタスクは、新しいプライオリティの末尾に移動する。
+ * 待機オブジェクトを待っているタスクは、待機オブジェクトの解放順序を更新する。
+ *
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ * 実行中のタスクのプライオリティを下げた場合、コンテキストスイッチを有効にした後に
+ * kernel_request_swtich()を呼び出すこと。
+ *
+ * @param entry タスク
+ * @param priority プライオリティ
+ */
+void
+kernel_change_task_priority(struct task_entry *entry, uint8_t priority)
+{
+	if (entry->param.state == TASK_STATE_PENDING) {
+		ready_queue_remove(&ReadyQueue, entry);
+		entry->param.priority = priority;
+		ready_queue_add(&ReadyQueue, entry);
+	} else if ((entry->param.state == TASK_STATE_WAITING)
+			&& ((entry->param.syscall_type == SYSCALL_WAIT_OBJECT)
+					|| (entry->param.syscall_type == SYSCALL_WAIT_OBJECT_TIMEOUT))
+			&& (entry->param.sysc.wait_object != NULL)) {
+		entry->param.priority = priority;
+		wait_object_update_priority(entry->param.sysc.wait_object, entry);
+	} else {
+		entry->param.priority = priority;
+	}
+
+	return ;
+}
@@ -9,6 +9,8 @@
 #include "kernel_defs.h"
 #include "kernel_config.h"
 
+struct task_entry;
+struct wait_object;
 
 
 #ifdef __cplusplus
@@ -20,18 +22,50 @@ void kernel_init(void);
 int kernel_register_task(uint16_t priority,
 		task_func_t func, void *arg,
 		stack_type_t *stack, uint32_t stack_size);
+int kernel_register_task_ex(uint16_t priority,
+		task_func_t func, void *arg,
+		stack_type_t *stack, uint32_t stack_size, uint8_t options);
+int kernel_create_task(uint16_t priority,
+		task_func_t func, void *arg, uint8_t options);
+int kernel_delete_task(int taskid);
+void kernel_exit_task(void);
+int kernel_join_task(int taskid);
+int kernel_timedjoin_task(int taskid, uint32_t timeout_millis);
 
 void kernel_start_scheduler(void);
 void kernel_request_swtich(void);
 void kernel_disable_context_switch(void);
 void kernel_enable_context_switch(void);
+/* タスクと割り込みハンドラのどちらでも、IPLをKERNEL_PRIORITYまで上げる */
+uint32_t kernel_enter_critical(void);
+void kernel_exit_critical(uint32_t state);
 int kernel_task_is_alive(int taskid);
 int kernel_get_self_id(void);
+int kernel_tls_alloc(kernel_tls_destructor_t destructor);
+void *kernel_tls_get(int slot);
+int kernel_tls_set(int slot, void *value);
+int kernel_set_time_slice(int taskid, uint16_t slice_millis);
+int kernel_request_from_isr(kernel_isr_proc_t proc, void *obj, uintptr_t value);
+int kernel_get_stack_info(int taskid, struct kernel_stack_info *info);
+void kernel_set_stack_overflow_handler(kernel_stack_overflow_handler_t handler);
+void kernel_report_stacks(void);
+int kernel_get_task_stats(int taskid, struct kernel_task_stats *stats);
+void kernel_get_cpu_stats(struct kernel_cpu_stats *stats);
+void kernel_reset_stats(void);
+void kernel_report_stats(void);
 
 /* task APIs */
 void kernel_sysc_wait(uint32_t wait_millis);
 void kernel_sysc_yield(void);
-void kernel_sysc_wait_object(struct wait_object *wait_obj);
+int kernel_sysc_wait_object(struct wait_object *wait_obj);
+int kernel_sysc_wait_object_timeout(struct wait_object *wait_obj, uint32_t timeout_millis);
+
+/* wait object APIs */
+struct task_entry *kernel_signal_object(struct wait_object *wait_obj);
+void kernel_signal_task(struct wait_object *wait_obj, struct task_entry *entry);
+struct task_entry *kernel_get_current_task(void);
+struct task_entry *kernel_get_task(int taskid);
+void kernel_change_task_priority(struct task_entry *entry, uint8_t priority);
 
 
 
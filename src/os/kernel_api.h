@@ -9,6 +9,9 @@
 
 #include "semaphore.h"
 #include "mutex.h"
+#include "message_queue.h"
+#include "event_flags.h"
+#include "mempool.h"
 
 void sleep(uint32_t wait_millis);
 void yield(void);
@@ -6,8 +6,167 @@
 #ifndef KERNEL_CONFIG_H_
 #define KERNEL_CONFIG_H_
 
+/**
+ * 静的コンフィギュレーションを使用するかどうか
+ * 1にすると、tools/gen_kernel_static.py が設定ファイルから生成した kernel_static.h と
+ * kernel_static_data.h を使用し、設定ファイルに書いたタスク(タスクエントリ、スタック、レディキュー)と
+ * カーネルオブジェクトを初期化済みデータとして配置する。
+ * kernel_init()はタスクエントリやレディキューを初期化せず、静的タスクのスタックの初期コンテキストだけを作る。
+ * 生成したファイルを置いたディレクトリをインクルードパスに追加すること。
+ */
+#ifndef KERNEL_STATIC_CONFIG
+#define KERNEL_STATIC_CONFIG 0
+#endif
+
+#if KERNEL_STATIC_CONFIG
+#include <kernel_static.h>
+#endif
+
+/**
+ * 同時に存在できるタスクの最大数
+ * 終了したタスクのエントリは再利用される。
+ * 静的コンフィギュレーションでは、設定ファイルのタスク数(とmax_tasks)から kernel_static.h で定義する。
+ */
+#ifndef MAX_TASKS
 #define MAX_TASKS 8
+#endif
+
+/**
+ * タスクIDのうち、タスクエントリの位置を表すビット数
+ * MAX_TASKS が 2^KERNEL_TASK_ID_INDEX_BITS 以下になるようにすること。
+ * 残りの上位ビットは、エントリを再利用する毎に更新する世代番号になる。
+ * 指定しない場合は、MAX_TASKS が収まる最小のビット数(3以上)にする。
+ */
+#ifndef KERNEL_TASK_ID_INDEX_BITS
+#if MAX_TASKS <= 8
+#define KERNEL_TASK_ID_INDEX_BITS 3
+#elif MAX_TASKS <= 16
+#define KERNEL_TASK_ID_INDEX_BITS 4
+#elif MAX_TASKS <= 32
+#define KERNEL_TASK_ID_INDEX_BITS 5
+#elif MAX_TASKS <= 64
+#define KERNEL_TASK_ID_INDEX_BITS 6
+#elif MAX_TASKS <= 128
+#define KERNEL_TASK_ID_INDEX_BITS 7
+#else
+#define KERNEL_TASK_ID_INDEX_BITS 8
+#endif
+#endif
 
 #define KERNEL_PRIORITY 4
 
+/**
+ * システムコールトラップに使用するINT命令のベクタ番号
+ * kernel_asm.srcと一致させること。
+ */
+#define KERNEL_SYSCALL_VECTOR 1
+
+/**
+ * タスクからクリティカルセクションに入る/出るトラップに使用するINT命令のベクタ番号
+ * ユーザーモードではIPLを変更できないため、トラップハンドラで退避したPSWのIPLを書き換える。
+ * kernel_asm.srcと一致させること。
+ */
+#define KERNEL_CRITICAL_ENTER_VECTOR 2
+#define KERNEL_CRITICAL_EXIT_VECTOR 3
+
+/**
+ * タスクプライオリティの段階数
+ * タスクのプライオリティは 0～(KERNEL_NUM_PRIORITIES - 1) で、値が大きいほど優先される。
+ * レディキューのビットマップで表現するため、32以下とすること。
+ */
+#define KERNEL_NUM_PRIORITIES 32
+
+/**
+ * ティックレスアイドルを使用するかどうか
+ * 1にすると、実行可能なタスクが無い間は次の待機解除時刻までタイマー割り込みを止めて
+ * WAIT命令で待機する。0にすると、1ミリ秒毎のタイマー割り込みでWAIT命令から復帰する。
+ */
+#define KERNEL_TICKLESS_IDLE 1
+
+/**
+ * タスクのタイムスライス初期値[ミリ秒]
+ * 同じプライオリティの実行可能なタスクが他にある場合、
+ * タイムスライスを使い切ったタスクは同じプライオリティの末尾に回される。
+ * 0にすると、ラウンドロビンしない。（待機するか、明示的に譲るまで実行し続ける）
+ * タスク毎の値は kernel_set_time_slice() で変更できる。
+ */
+#define KERNEL_DEFAULT_TIME_SLICE 10
+
+/**
+ * kernel_register_task()で登録するタスクのオプション
+ * 整数演算だけのタスクは、kernel_register_task_ex()でオプションを0にすると
+ * コンテキストスイッチが短くなる。
+ */
+#define KERNEL_DEFAULT_TASK_OPTIONS TASK_OPTION_FPU
+
+/**
+ * 割り込みハンドラからの要求を保持する数
+ * 割り込みハンドラから *_from_isr() で依頼した処理は、スケジューラで実行されるまで保持される。
+ * 次にスケジューラが動作するまでに、割り込みハンドラから依頼する最大数以上にすること。
+ */
+#define KERNEL_ISR_QUEUE_SIZE 16
+
+/**
+ * タスク毎のローカルストレージ(TLS)のスロット数
+ * kernel_tls_alloc()で割り当てたスロットに、タスク毎に1つのポインタを保持できる。
+ * rx_debug()が1つ使用する。
+ */
+#define KERNEL_TLS_SLOTS 4
+
+/**
+ * スタックプールのスタック数
+ * kernel_create_task()で生成するタスクには、このプールからスタックを割り当てる。
+ * タスクが終了するとスタックはプールに戻される。
+ * 0にすると、スタックプールを使用しない。
+ * 静的コンフィギュレーションでは、設定ファイルのstack_poolで指定する。
+ */
+#ifndef KERNEL_STACK_POOL_COUNT
+#define KERNEL_STACK_POOL_COUNT 4
+#endif
+
+/**
+ * スタックプールのスタック1つ当たりのサイズ[バイト]
+ * stack_type_tのサイズの倍数にすること。
+ */
+#define KERNEL_STACK_POOL_STACK_SIZE 512
+
+/**
+ * スタックの使用量を計測するかどうか
+ * 1にすると、タスク登録時にスタック全体を KERNEL_STACK_PAINT_PATTERN で塗りつぶし、
+ * kernel_get_stack_info()で最大使用量を得られるようにする。
+ * また、タスクを切り替える度にスタックの最下位ワード（ガードワード）を確認し、
+ * 書き換えられていればスタックオーバーフローとして扱う。
+ */
+#define KERNEL_STACK_CHECK 1
+
+/**
+ * スタックを塗りつぶす値
+ */
+#define KERNEL_STACK_PAINT_PATTERN 0xA5A5A5A5
+
+/**
+ * タスク毎の実行時間とコンテキストスイッチ回数を計測するかどうか
+ * 1にすると、タスクを切り替える度にマイクロ秒単位の時刻を読み出して実行時間を累計し、
+ * kernel_get_task_stats(), kernel_get_cpu_stats()で得られるようにする。
+ * 割り込みハンドラの実行時間は、割り込まれたタスクの実行時間に含まれる。
+ * ホストのカーネルベンチマーク(host/Makefile の kbench)は、時刻の読み出し(模擬レジスタへのアクセス)が
+ * 計測値の大半を占めないように、コンパイラオプションで0にしてビルドする。
+ */
+#ifndef KERNEL_RUNTIME_STATS
+#define KERNEL_RUNTIME_STATS 1
+#endif
+
+/**
+ * カーネルトレースを使用するかどうか
+ * 1にすると、スケジューラやカーネルオブジェクトの操作、ドライバの割り込みハンドラを
+ * kernel_trace.hのリングバッファに記録する。0にすると記録処理はコンパイルされない。
+ */
+#define KERNEL_TRACE 0
+
+/**
+ * トレースのリングバッファ1つ当たりのレコード数
+ * タスク用と割り込みハンドラ用の2つを確保する。
+ */
+#define KERNEL_TRACE_BUFFER_SIZE 128
+
 #endif /* OS_KERNEL_CONFIG_H_ */
@@ -13,5 +13,66 @@ typedef void (*task_func_t)(void *arg);
 
 typedef uint32_t stack_type_t;
 
+/**
+ * 静的コンフィギュレーションのタスクのID
+ * 設定ファイルに書いた順に、タスクエントリの先頭から世代番号1で配置する。
+ */
+#define KERNEL_STATIC_TASK_ID(index) ((task_id_t)((1 << KERNEL_TASK_ID_INDEX_BITS) | (index)))
+
+/**
+ * タスクオプション
+ * タスクが使用する演算器を指定する。指定した演算器のレジスタだけが
+ * コンテキストスイッチ時に退避/復元される。
+ * 値はkernel_asm.srcで参照するため、変更する場合は一致させること。
+ */
+#define TASK_OPTION_FPU 0x01 /* FPUを使用する（FPSWを退避/復元する） */
+#define TASK_OPTION_DSP 0x02 /* DSP命令を使用する（ACC0, ACC1を退避/復元する） */
+
+/**
+ * 割り込みハンドラから依頼され、スケジューラで実行される処理
+ */
+typedef void (*kernel_isr_proc_t)(void *obj, uintptr_t value);
+
+/**
+ * スタックオーバーフローを検出した時に呼び出される処理
+ * スケジューラから、割り込み禁止状態で呼び出される。
+ */
+typedef void (*kernel_stack_overflow_handler_t)(int taskid);
+
+/**
+ * タスクが終了した時に、TLSの値を解放する処理
+ * スケジューラ、またはコンテキストスイッチを無効にした状態で、NULLでない値に対して呼び出される。
+ */
+typedef void (*kernel_tls_destructor_t)(void *value);
+
+/**
+ * タスクの実行統計
+ */
+struct kernel_task_stats {
+	uint64_t run_time; /* 実行時間の累計[マイクロ秒] */
+	uint32_t switch_count; /* ディスパッチされた回数 */
+	uint32_t voluntary_count; /* 待機などで自ら切り替えた回数 */
+	uint32_t preempted_count; /* 割り込みや他のタスクの待機解除で切り替えられた回数 */
+};
+
+/**
+ * CPU全体の実行統計
+ */
+struct kernel_cpu_stats {
+	uint32_t elapsed_millis; /* 計測を開始してからの経過時間[ミリ秒] */
+	uint64_t idle_time; /* 実行可能なタスクが無かった時間の累計[マイクロ秒] */
+	uint16_t idle_permille; /* アイドル率[‰] */
+	uint32_t switch_count; /* コンテキストスイッチ回数 */
+};
+
+/**
+ * スタックの使用状況
+ */
+struct kernel_stack_info {
+	uint32_t size; /* スタックサイズ[バイト] */
+	uint32_t max_used; /* 最大使用量[バイト] */
+	uint8_t overflow; /* オーバーフローを検出したかどうか */
+};
+
 
 #endif /* OS_KERNEL_DEFS_H_ */
@@ -0,0 +1,70 @@
+/**
+ * @file カーネルのCPU依存部
+ *       コンテキストスイッチ用のソフトウェア割り込みの操作と、タスクの初期コンテキストの作成を定義する。
+ *       RX用の実装は kernel_port_rx.c と kernel_asm.src にある。
+ *       KERNEL_PORT_HOSTを定義した場合には、host/port 以下のホスト(Linux)用の実装を使用する。
+ * @author
+ */
+
+#ifndef KERNEL_PORT_H_
+#define KERNEL_PORT_H_
+
+#include "../rx_utils/rx_types.h"
+
+#ifdef KERNEL_PORT_HOST
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void kernel_port_init(void);
+void kernel_port_request_switch(void);
+void kernel_port_clear_switch(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * ソフトウェア割り込みを初期化する。
+ */
+#define KERNEL_PORT_INIT() kernel_port_init()
+/**
+ * ソフトウェア割り込みを発行し、コンテキストスイッチを要求する。
+ */
+#define KERNEL_PORT_REQUEST_SWITCH() kernel_port_request_switch()
+/**
+ * 保留中のソフトウェア割り込みを取り消す。
+ */
+#define KERNEL_PORT_CLEAR_SWITCH() kernel_port_clear_switch()
+
+#else /* KERNEL_PORT_HOST */
+
+#include <iodefine.h>
+#include "kernel_config.h"
+
+/* RXではレジスタを直接操作する */
+#define KERNEL_PORT_INIT() \
+	do { \
+		IPR(ICU, SWINT) = KERNEL_PRIORITY; \
+		IEN(ICU, SWINT) = 1; \
+	} while (0)
+#define KERNEL_PORT_REQUEST_SWITCH() (ICU.SWINTR.BIT.SWINT = 1)
+#define KERNEL_PORT_CLEAR_SWITCH() (IR(ICU, SWINT) = 0)
+
+#endif /* KERNEL_PORT_HOST */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *kernel_port_init_stack(void *stack, void *func, void *arg, uint8_t options);
+void kernel_sysc_trap(void);
+uint32_t kernel_port_enter_critical(void);
+void kernel_port_exit_critical(uint32_t psw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KERNEL_PORT_H_ */
@@ -0,0 +1,74 @@
+/**
+ * @file カーネルのCPU依存部 (RX用)
+ *       コンテキストの退避/復元は kernel_asm.src で行う。
+ * @author
+ */
+
+#ifndef KERNEL_PORT_HOST
+
+#include "kernel_defs.h"
+#include "kernel_port.h"
+
+/**
+ * タスク開始時のPSWレジスタ初期値
+ * b20: 1 ユーザーモードで実行
+ * b17: 1 USP
+ * b16: 1 割り込み許可
+ */
+#define INITIAL_PSW 0x00130000
+/**
+ * タスク開始時のFPSWレジスタ初期値
+ */
+#define INITIAL_FPSW 0x00000100
+
+
+/**
+ * タスクのスタックを初期化する。
+ *
+ * @param stack タスク
+ * @param func タスクエントリ関数
+ * @param arg タスクエントリ関数に渡す引数。
+ * @param options タスクオプション。退避されるレジスタを合わせる。
+ * @return TCBポインタ。
+ */
+void*
+kernel_port_init_stack(void *stack, void *func, void *arg, uint8_t options)
+{
+    uint32_t *p = (uint32_t*)(stack);
+
+    /* CC for RX でのINT割り込みが発生した時、退避されるレジスタをエミュレートする */
+    *(--p) = 0x0;
+
+    *(--p) = INITIAL_PSW; /* PSW */
+
+    *(--p) = (uint32_t)(func); /* PC */
+
+    *(--p) = 15; /* R15 */
+    *(--p) = 14; /* R14 */
+    *(--p) = 13; /* R13 */
+    *(--p) = 12; /* R12 */
+    *(--p) = 11; /* R11 */
+    *(--p) = 10; /* R10 */
+    *(--p) = 9; /* R9 */
+    *(--p) = 8; /* R8 */
+    *(--p) = 7; /* R7 */
+    *(--p) = 6; /* R6 */
+    *(--p) = 5; /* R5 */
+    *(--p) = 4; /* R4 */
+    *(--p) = 3; /* R3 */
+    *(--p) = 2; /* R2 */
+    *(--p) = (uint32_t)(arg); /* R1 */
+
+    if (options & TASK_OPTION_FPU) {
+        *(--p) = INITIAL_FPSW; /* INITIAL_FPSW */
+    }
+    if (options & TASK_OPTION_DSP) {
+        for (int i = 0; i < 6; i++) {
+            *(--p) = 0; /* ACC0, ACC1 (ガードビット, 上位, 下位) */
+        }
+    }
+
+    return p;
+}
+
+#endif /* KERNEL_PORT_HOST */
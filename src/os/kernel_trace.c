@@ -0,0 +1,199 @@
+/**
+ * @file カーネルトレース実装
+ *       タスクからの書き込みと、割り込みハンドラ/スケジューラからの書き込みは
+ *       別々のリングバッファに記録し、ホスト側で時刻順に並べ直す。
+ *       書き込み先を分けることで、どちらも割り込み禁止かコンテキストスイッチ無効の
+ *       短い区間だけで書き込める。
+ * @author
+ */
+
+#include "../rx_utils/rx_utils.h"
+#include "../drv/cmt/cmt.h"
+#include "kernel.h"
+#include "kernel_trace.h"
+
+#if KERNEL_TRACE
+/**
+ * トレースバッファ
+ * デバッガでメモリダンプする場合は、このシンボルのアドレスから
+ * sizeof(struct kernel_trace)バイトを保存する。
+ */
+struct kernel_trace KernelTrace;
+
+static void write_record(struct kernel_trace_ring *ring,
+		uint8_t event, int task_id, uint32_t obj);
+static void dump_ring(uint8_t ring_no);
+static void trace_isr_enter(uint8_t vect);
+static void trace_isr_exit(uint8_t vect);
+#endif
+
+/**
+ * トレースの記録を開始する。
+ * 以前の記録は残したまま追記する。
+ * ドライバの割り込みハンドラの開始/終了も記録するように、rx_utilsに通知処理を登録する。
+ */
+void
+kernel_trace_start(void)
+{
+#if KERNEL_TRACE
+	if (KernelTrace.magic != KERNEL_TRACE_MAGIC) {
+		kernel_trace_clear();
+	}
+	rx_util_set_isr_hooks(trace_isr_enter, trace_isr_exit);
+	KernelTrace.enable = 1;
+#endif
+}
+
+/**
+ * トレースの記録を停止する。
+ * 記録した内容は、kernel_trace_clear()を呼び出すまで保持される。
+ */
+void
+kernel_trace_stop(void)
+{
+#if KERNEL_TRACE
+	KernelTrace.enable = 0;
+	rx_util_set_isr_hooks(NULL, NULL);
+#endif
+}
+
+/**
+ * 記録した内容を破棄する。
+ * 記録を停止した状態で呼び出すこと。
+ */
+void
+kernel_trace_clear(void)
+{
+#if KERNEL_TRACE
+	rx_memset(&KernelTrace, 0x0, sizeof(KernelTrace));
+	KernelTrace.magic = KERNEL_TRACE_MAGIC;
+	KernelTrace.record_size = sizeof(struct kernel_trace_record);
+	KernelTrace.buffer_size = KERNEL_TRACE_BUFFER_SIZE;
+#endif
+}
+
+/**
+ * イベントを記録する。
+ * 通常はKERNEL_TRACE_EVENT()、KERNEL_TRACE_SELF()マクロを経由して呼び出す。
+ * タスクと割り込みハンドラのどちらからでも呼び出すことができる。
+ *
+ * @param event イベント (KERNEL_TRACE_xxx)
+ * @param task_id タスクID
+ * @param obj 対象オブジェクト
+ */
+void
+kernel_trace_write(uint8_t event, int task_id, uint32_t obj)
+{
+#if KERNEL_TRACE
+	if (!KernelTrace.enable) {
+		return ;
+	}
+
+	if (rx_util_is_user_mode()) {
+		/* 他のタスクに切り替わらなければ、タスク用のバッファに書き込むのは自タスクだけ */
+		kernel_disable_context_switch();
+		write_record(&(KernelTrace.rings[KERNEL_TRACE_RING_TASK]), event, task_id, obj);
+		kernel_enable_context_switch();
+	} else {
+		/* 多重割り込みで同時に書き込まれないように、割り込みを禁止する */
+		int is_interrupt_enable = rx_util_is_interrupt_enable();
+		rx_util_disable_interrupt();
+		write_record(&(KernelTrace.rings[KERNEL_TRACE_RING_ISR]), event, task_id, obj);
+		if (is_interrupt_enable) {
+			rx_util_enable_interrupt();
+		}
+	}
+#endif
+}
+
+/**
+ * 記録した内容をデバッグ出力する。
+ * 出力中の割り込みを記録しないように、記録は停止される。
+ * 1レコードを1行として、バッファ毎に古い順に出力する。
+ *
+ *   KTRACE BEGIN <レコードサイズ> <バッファサイズ>
+ *   KTRACE <バッファ番号> <時刻> <イベント> <タスクID> <対象オブジェクト>
+ *   KTRACE END
+ *
+ * 数値は全て16進数で出力する。
+ */
+void
+kernel_trace_dump(void)
+{
+#if KERNEL_TRACE
+	kernel_trace_stop();
+	rx_debug("KTRACE BEGIN %x %x\n", (uint32_t)(KernelTrace.record_size),
+			(uint32_t)(KernelTrace.buffer_size));
+	for (uint8_t i = 0; i < KERNEL_TRACE_NUM_RINGS; i++) {
+		dump_ring(i);
+	}
+	rx_debug("KTRACE END\n");
+#endif
+}
+
+#if KERNEL_TRACE
+/**
+ * リングバッファにレコードを書き込む。
+ * バッファが一杯の場合には、最も古いレコードを上書きする。
+ *
+ * @param ring リングバッファ
+ * @param event イベント
+ * @param task_id タスクID
+ * @param obj 対象オブジェクト
+ */
+static void
+write_record(struct kernel_trace_ring *ring,
+		uint8_t event, int task_id, uint32_t obj)
+{
+	struct kernel_trace_record *rec = &(ring->records[ring->written % KERNEL_TRACE_BUFFER_SIZE]);
+	rec->timestamp = drv_cmt_get_usec_counter();
+	rec->event = event;
+	rec->reserved = 0;
+	rec->task_id = (uint16_t)(task_id);
+	rec->obj = obj;
+	ring->written++;
+}
+
+/**
+ * リングバッファの内容を古い順にデバッグ出力する。
+ *
+ * @param ring_no リングバッファの番号
+ */
+static void
+dump_ring(uint8_t ring_no)
+{
+	const struct kernel_trace_ring *ring = &(KernelTrace.rings[ring_no]);
+	uint32_t count = ring->written;
+	uint32_t start = 0;
+	if (count > KERNEL_TRACE_BUFFER_SIZE) {
+		start = count - KERNEL_TRACE_BUFFER_SIZE;
+	}
+	for (uint32_t n = start; n < count; n++) {
+		const struct kernel_trace_record *rec = &(ring->records[n % KERNEL_TRACE_BUFFER_SIZE]);
+		rx_debug("KTRACE %x %x %x %x %x\n", (uint32_t)(ring_no), rec->timestamp,
+				(uint32_t)(rec->event), (uint32_t)(rec->task_id), rec->obj);
+	}
+}
+
+/**
+ * ドライバの割り込みハンドラの開始を記録する。
+ *
+ * @param vect ベクタ番号
+ */
+static void
+trace_isr_enter(uint8_t vect)
+{
+	KERNEL_TRACE_SELF(KERNEL_TRACE_ISR_ENTER, vect);
+}
+
+/**
+ * ドライバの割り込みハンドラの終了を記録する。
+ *
+ * @param vect ベクタ番号
+ */
+static void
+trace_isr_exit(uint8_t vect)
+{
+	KERNEL_TRACE_SELF(KERNEL_TRACE_ISR_EXIT, vect);
+}
+#endif
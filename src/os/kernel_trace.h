@@ -0,0 +1,115 @@
+/**
+ * @file カーネルトレース
+ *       スケジューラやカーネルオブジェクトの操作を、固定長のレコードとして
+ *       RAM上のリングバッファに記録する。
+ *       rx_debug()で出力するとタイミングが大きく変わるため、記録はレコードの書き込みだけにし、
+ *       kernel_trace_dump()で出力するか、デバッガでKernelTraceをメモリダンプして
+ *       ホスト側の tools/ktrace_decode.py でタイムラインに変換する。
+ * @author
+ */
+
+#ifndef KERNEL_TRACE_H_
+#define KERNEL_TRACE_H_
+
+#include "../rx_utils/rx_types.h"
+#include "kernel_config.h"
+
+/**
+ * トレースイベント
+ * tools/ktrace_decode.py と一致させること。
+ */
+#define KERNEL_TRACE_DISPATCH     0x01 /* タスクをディスパッチした (task_id=0はスケジューラの終了) */
+#define KERNEL_TRACE_IDLE_ENTER   0x02 /* 実行可能なタスクが無く、待機を開始した */
+#define KERNEL_TRACE_IDLE_EXIT    0x03 /* 待機を終了した */
+#define KERNEL_TRACE_TASK_CREATE  0x04 /* タスクを登録した */
+#define KERNEL_TRACE_TASK_EXIT    0x05 /* タスクが終了した */
+#define KERNEL_TRACE_SLEEP        0x06 /* 時間待ちを開始した (obj=待機時間[ミリ秒]) */
+#define KERNEL_TRACE_WAIT         0x07 /* 待機オブジェクトの待ちを開始した (obj=待機オブジェクト) */
+#define KERNEL_TRACE_WAKEUP       0x08 /* タスクを待機解除した */
+#define KERNEL_TRACE_TIMEOUT      0x09 /* 待機がタイムアウトした (obj=待機オブジェクト) */
+#define KERNEL_TRACE_SEM_WAIT     0x10 /* セマフォを待った (obj=セマフォ) */
+#define KERNEL_TRACE_SEM_POST     0x11 /* セマフォをポストした (obj=セマフォ) */
+#define KERNEL_TRACE_MUTEX_LOCK   0x12 /* ミューテックスをロックした (obj=ミューテックス) */
+#define KERNEL_TRACE_MUTEX_UNLOCK 0x13 /* ミューテックスをアンロックした (obj=ミューテックス) */
+#define KERNEL_TRACE_ISR_ENTER    0x20 /* 割り込みハンドラに入った (obj=ベクタ番号) */
+#define KERNEL_TRACE_ISR_EXIT     0x21 /* 割り込みハンドラから出た (obj=ベクタ番号) */
+#define KERNEL_TRACE_ISR_REQUEST  0x22 /* 割り込みハンドラから処理を依頼した (obj=対象オブジェクト) */
+#define KERNEL_TRACE_USER         0x80 /* アプリケーション定義のイベント */
+
+/**
+ * リングバッファの番号
+ * タスク（ユーザーモード）はコンテキストスイッチを無効にして書き込み、
+ * 割り込みハンドラとスケジューラ（スーパーバイザモード）は割り込みを禁止して書き込む。
+ * ユーザーモードでは割り込みを禁止できないため、書き込む側毎にバッファを分けている。
+ */
+#define KERNEL_TRACE_RING_TASK 0
+#define KERNEL_TRACE_RING_ISR  1
+#define KERNEL_TRACE_NUM_RINGS 2
+
+/**
+ * トレースバッファの識別値 ('KTRC')
+ */
+#define KERNEL_TRACE_MAGIC 0x4354524B
+
+/**
+ * トレースレコード
+ */
+struct kernel_trace_record {
+	uint32_t timestamp; /* 時刻[マイクロ秒] */
+	uint8_t event; /* イベント */
+	uint8_t reserved;
+	uint16_t task_id; /* タスクID */
+	uint32_t obj; /* 対象オブジェクト */
+};
+
+/**
+ * トレースのリングバッファ
+ */
+struct kernel_trace_ring {
+	uint32_t written; /* 書き込んだレコード数の累計 */
+	struct kernel_trace_record records[KERNEL_TRACE_BUFFER_SIZE];
+};
+
+/**
+ * トレースバッファ
+ * デバッガでメモリダンプしたものをそのままデコードできるように、レイアウトを記録しておく。
+ */
+struct kernel_trace {
+	uint32_t magic; /* KERNEL_TRACE_MAGIC */
+	uint16_t record_size; /* レコードのサイズ[バイト] */
+	uint16_t buffer_size; /* リングバッファ1つ当たりのレコード数 */
+	uint32_t enable; /* 記録中かどうか */
+	struct kernel_trace_ring rings[KERNEL_TRACE_NUM_RINGS];
+};
+
+#if KERNEL_TRACE
+/**
+ * イベントを記録する。
+ */
+#define KERNEL_TRACE_EVENT(__event__, __task_id__, __obj__) \
+		kernel_trace_write((__event__), (int)(__task_id__), (uint32_t)(uintptr_t)(__obj__))
+/**
+ * 実行中のタスクのイベントを記録する。
+ */
+#define KERNEL_TRACE_SELF(__event__, __obj__) \
+		kernel_trace_write((__event__), kernel_get_self_id(), (uint32_t)(uintptr_t)(__obj__))
+#else
+#define KERNEL_TRACE_EVENT(__event__, __task_id__, __obj__)
+#define KERNEL_TRACE_SELF(__event__, __obj__)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void kernel_trace_start(void);
+void kernel_trace_stop(void);
+void kernel_trace_clear(void);
+void kernel_trace_write(uint8_t event, int task_id, uint32_t obj);
+void kernel_trace_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KERNEL_TRACE_H_ */
@@ -0,0 +1,358 @@
+/**
+ * @file 固定長メモリプール実装
+ *       空きブロックは、ブロックの先頭に次の空きブロックへのポインタを格納した
+ *       単方向リストで保持するため、確保と解放はブロック数によらず一定時間で終わる。
+ *       二重解放でリストが壊れないように、ブロックごとの確保状態をビットマップで持つ。
+ *       空きブロックが無い時に確保を待っているタスクがいる場合、
+ *       解放されたブロックはリストに戻さずに直接そのタスクに渡す。
+ * @author 
+ */
+
+#include "kernel.h"
+#include "task.h"
+#include "mempool.h"
+#include "../rx_utils/error_code.h"
+
+static int alloc(struct mempool *pool, void **block,
+		uint8_t is_timed, uint32_t timeout_millis);
+static void *take(struct mempool *pool);
+static int give(struct mempool *pool, void *block, struct task_entry **entry);
+static int is_valid_block(const struct mempool *pool, const void *block);
+static uint32_t get_block_index(const struct mempool *pool, const void *block);
+static int is_allocated(const struct mempool *pool, uint32_t index);
+static void free_from_isr_proc(void *obj, uintptr_t value);
+
+/**
+ * メモリプールを初期化する。
+ *
+ * @param pool メモリプール
+ * @param buffer ブロックを切り出すバッファ。
+ *               MEMPOOL_BUFFER_SIZE(block_size, block_count)バイト以上で、
+ *               MEMPOOL_ALIGNバイト境界に配置されていること。
+ * @param block_size ブロックサイズ[バイト]。MEMPOOL_ALIGNの倍数に切り上げられる。
+ * @param block_count ブロック数
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+mempool_init(struct mempool *pool, void *buffer,
+		uint32_t block_size, uint16_t block_count)
+{
+	if ((buffer == NULL) || (block_size == 0) || (block_count == 0)
+			|| (((uintptr_t)(buffer) % MEMPOOL_ALIGN) != 0)) {
+		return ERR_INVAL;
+	}
+
+	wait_object_init(&(pool->wait_obj));
+	pool->buffer = (uint8_t *)(buffer);
+	pool->block_size = MEMPOOL_BLOCK_SIZE(block_size);
+	pool->block_count = block_count;
+	pool->free_count = block_count;
+	pool->allocated = (uint32_t *)(pool->buffer + pool->block_size * block_count);
+	for (uint32_t i = 0; i < MEMPOOL_BITMAP_SIZE(block_count) / sizeof(uint32_t); i++) {
+		pool->allocated[i] = 0;
+	}
+
+	/* 先頭のブロックから順に確保されるように、末尾のブロックからリストに積む */
+	pool->free_list = NULL;
+	for (int i = block_count - 1; i >= 0; i--) {
+		void **p = (void **)(pool->buffer + pool->block_size * i);
+		*p = pool->free_list;
+		pool->free_list = p;
+	}
+
+	return 0;
+}
+
+/**
+ * メモリプールを破棄する。
+ *
+ * @param pool メモリプール
+ */
+void
+mempool_destroy(struct mempool *pool)
+{
+	wait_object_destroy(&(pool->wait_obj));
+	pool->free_list = NULL;
+	pool->buffer = NULL;
+	pool->allocated = NULL;
+	pool->block_size = 0;
+	pool->block_count = 0;
+	pool->free_count = 0;
+
+	return ;
+}
+
+/**
+ * ブロックを確保する。
+ * 空きブロックが無い場合、解放されるまで待機する。
+ *
+ * @param pool メモリプール
+ * @param block 確保したブロックを格納する変数
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+mempool_alloc(struct mempool *pool, void **block)
+{
+	return alloc(pool, block, 0, 0);
+}
+
+/**
+ * ブロックを確保する。
+ * 空きブロックが無い場合には待機せずにエラーを返す。
+ *
+ * @param pool メモリプール
+ * @param block 確保したブロックを格納する変数
+ * @return 成功した場合には0、空きブロックが無い場合にはERR_NOMEMを返す。
+ */
+int
+mempool_tryalloc(struct mempool *pool, void **block)
+{
+	int retval;
+
+	kernel_disable_context_switch();
+	*block = take(pool);
+	retval = (*block != NULL) ? 0 : ERR_NOMEM;
+	kernel_enable_context_switch();
+
+	return retval;
+}
+
+/**
+ * ブロックを確保する。
+ * 空きブロックが無い場合、解放されるかタイムアウトするまで待機する。
+ *
+ * @param pool メモリプール
+ * @param block 確保したブロックを格納する変数
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+int
+mempool_timedalloc(struct mempool *pool, void **block, uint32_t timeout_millis)
+{
+	return alloc(pool, block, 1, timeout_millis);
+}
+
+/**
+ * ブロックを解放する。
+ * 確保を待っているタスクがいる場合、ブロックはそのタスクに直接渡される。
+ *
+ * @param pool メモリプール
+ * @param block mempool_alloc()などで確保したブロック
+ * @return 成功した場合には0、poolのバッファ外やブロック境界でない場合にはERR_INVAL、
+ *         確保中でないブロック(二重解放)の場合にはERR_OPERATION_STATEを返す。
+ */
+int
+mempool_free(struct mempool *pool, void *block)
+{
+	struct task_entry *entry;
+	int retval;
+
+	if (!is_valid_block(pool, block)) {
+		return ERR_INVAL;
+	}
+
+	kernel_disable_context_switch();
+	retval = give(pool, block, &entry);
+	kernel_enable_context_switch();
+	if (entry != NULL) {
+		kernel_request_swtich();
+	}
+
+	return retval;
+}
+
+/**
+ * 割り込みハンドラからブロックを解放する。
+ * 解放はスケジューラで行われ、確保を待っているタスクは割り込みからの復帰時に
+ * ディスパッチされる。
+ *
+ * @param pool メモリプール
+ * @param block mempool_alloc()などで確保したブロック
+ * @return 成功した場合には0、poolのバッファ外やブロック境界でない場合にはERR_INVAL、
+ *         確保中でないブロック(二重解放)の場合にはERR_OPERATION_STATE、
+ *         失敗した場合にはエラー番号。
+ *         スケジューラで実行するまでの間に同じブロックの解放が重なった場合、
+ *         後から実行した解放は何もしない。
+ */
+int
+mempool_free_from_isr(struct mempool *pool, void *block)
+{
+	if (!is_valid_block(pool, block)) {
+		return ERR_INVAL;
+	}
+	if (!is_allocated(pool, get_block_index(pool, block))) {
+		return ERR_OPERATION_STATE;
+	}
+
+	return kernel_request_from_isr(free_from_isr_proc, pool, (uintptr_t)(block));
+}
+
+/**
+ * 空きブロック数を得る。
+ *
+ * @param pool メモリプール
+ * @return 空きブロック数
+ */
+uint16_t
+mempool_get_free_count(struct mempool *pool)
+{
+	return pool->free_count;
+}
+
+/**
+ * ブロックを確保する。
+ *
+ * @param pool メモリプール
+ * @param block 確保したブロックを格納する変数
+ * @param is_timed タイムアウトするかどうか
+ * @param timeout_millis タイムアウト時間[ミリ秒]
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+static int
+alloc(struct mempool *pool, void **block,
+		uint8_t is_timed, uint32_t timeout_millis)
+{
+	struct task_entry *self = kernel_get_current_task();
+	int retval;
+
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
+	}
+
+	kernel_disable_context_switch();
+	*block = take(pool);
+	if (*block != NULL) {
+		kernel_enable_context_switch();
+		return 0;
+	}
+
+	/* 解放したタスクがwait_dataにブロックを設定してから待機解除する */
+	if (!is_timed) {
+		retval = kernel_sysc_wait_object(&(pool->wait_obj));
+	} else {
+		retval = kernel_sysc_wait_object_timeout(&(pool->wait_obj), timeout_millis);
+	}
+	if (retval == 0) {
+		*block = self->param.wait_data;
+	}
+
+	return retval;
+}
+
+/**
+ * 空きブロックを取り出す。
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param pool メモリプール
+ * @return ブロック。空きブロックが無い場合にはNULLが返る。
+ */
+static void *
+take(struct mempool *pool)
+{
+	void **p = (void **)(pool->free_list);
+	if (p != NULL) {
+		uint32_t index = get_block_index(pool, p);
+		pool->free_list = *p;
+		pool->free_count--;
+		pool->allocated[index / 32] |= (uint32_t)(1) << (index % 32);
+	}
+
+	return p;
+}
+
+/**
+ * ブロックを返却する。
+ * 確保を待っているタスクがいる場合には、そのタスクに渡して待機解除する。
+ * 確保中でないブロックの場合は、二重解放として何もしない。
+ * 待っているタスクに渡したブロックは、確保中のままになる。
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param pool メモリプール
+ * @param block ブロック
+ * @param entry 待機解除したタスクを格納する変数。待っているタスクがいない場合にはNULLが入る。
+ * @return 成功した場合には0、二重解放の場合にはERR_OPERATION_STATEを返す。
+ */
+static int
+give(struct mempool *pool, void *block, struct task_entry **entry)
+{
+	uint32_t index = get_block_index(pool, block);
+
+	*entry = NULL;
+	if (!is_allocated(pool, index)) {
+		return ERR_OPERATION_STATE;
+	}
+
+	*entry = kernel_signal_object(&(pool->wait_obj));
+	if (*entry != NULL) {
+		(*entry)->param.wait_data = block;
+	} else {
+		void **p = (void **)(block);
+		*p = pool->free_list;
+		pool->free_list = p;
+		pool->free_count++;
+		pool->allocated[index / 32] &= ~((uint32_t)(1) << (index % 32));
+	}
+
+	return 0;
+}
+
+/**
+ * メモリプールのブロックかどうかを判定する。
+ *
+ * @param pool メモリプール
+ * @param block ブロック
+ * @return メモリプールのブロックの場合には非0、そうでない場合には0
+ */
+static int
+is_valid_block(const struct mempool *pool, const void *block)
+{
+	const uint8_t *p = (const uint8_t *)(block);
+	if ((p < pool->buffer)
+			|| (p >= (pool->buffer + pool->block_size * pool->block_count))) {
+		return 0;
+	}
+
+	return (((uint32_t)(p - pool->buffer) % pool->block_size) == 0);
+}
+
+/**
+ * ブロックの番号を得る。
+ *
+ * @param pool メモリプール
+ * @param block メモリプールのブロック
+ * @return ブロックの番号
+ */
+static uint32_t
+get_block_index(const struct mempool *pool, const void *block)
+{
+	return (uint32_t)((const uint8_t *)(block) - pool->buffer) / pool->block_size;
+}
+
+/**
+ * ブロックが確保中かどうかを判定する。
+ *
+ * @param pool メモリプール
+ * @param index ブロックの番号
+ * @return 確保中の場合には非0、空きの場合には0
+ */
+static int
+is_allocated(const struct mempool *pool, uint32_t index)
+{
+	return (pool->allocated[index / 32] & ((uint32_t)(1) << (index % 32))) != 0;
+}
+
+/**
+ * mempool_free_from_isr()で依頼された処理をスケジューラで実行する。
+ *
+ * @param obj メモリプール
+ * @param value ブロック
+ */
+static void
+free_from_isr_proc(void *obj, uintptr_t value)
+{
+	struct task_entry *entry;
+
+	(void)give((struct mempool *)(obj), (void *)(value), &entry);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file 固定長メモリプール
+ * @author 
+ */
+
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+#include "../rx_utils/rx_types.h"
+#include "wait_object.h"
+
+/**
+ * ブロックサイズの単位[バイト]
+ * ブロックサイズはこの値の倍数に切り上げられる。
+ * 空きブロックの先頭に次の空きブロックへのポインタを格納するため、ポインタのサイズにする。
+ */
+#define MEMPOOL_ALIGN sizeof(void *)
+
+/**
+ * ブロックサイズを切り上げたサイズを得る。
+ */
+#define MEMPOOL_BLOCK_SIZE(__block_size__) \
+		((((__block_size__) + (MEMPOOL_ALIGN - 1)) / MEMPOOL_ALIGN) * MEMPOOL_ALIGN)
+
+/**
+ * ブロックの確保状態のビットマップのサイズ[バイト]を得る。
+ * ビットマップはバッファの末尾(ブロック領域の後ろ)に置く。
+ */
+#define MEMPOOL_BITMAP_SIZE(__block_count__) \
+		((((__block_count__) + 31) / 32) * sizeof(uint32_t))
+
+/**
+ * メモリプールのバッファに必要なサイズ[バイト]を得る。
+ * ブロック領域と、確保状態のビットマップを合わせたサイズになる。
+ */
+#define MEMPOOL_BUFFER_SIZE(__block_size__, __block_count__) \
+		(MEMPOOL_BLOCK_SIZE(__block_size__) * (__block_count__) \
+				+ MEMPOOL_BITMAP_SIZE(__block_count__))
+
+struct mempool {
+	struct wait_object wait_obj; /* ブロックの解放を待っているタスク */
+	void *free_list; /* 空きブロックのリスト。空きブロックの先頭に次の空きブロックを格納する */
+	uint8_t *buffer; /* ブロックを切り出すバッファ */
+	uint32_t *allocated; /* ブロックの確保状態のビットマップ。確保中のブロックのビットが1 */
+	uint32_t block_size; /* ブロックサイズ[バイト] */
+	uint16_t block_count; /* ブロック数 */
+	uint16_t free_count; /* 空きブロック数 */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int mempool_init(struct mempool *pool, void *buffer,
+		uint32_t block_size, uint16_t block_count);
+void mempool_destroy(struct mempool *pool);
+int mempool_alloc(struct mempool *pool, void **block);
+int mempool_tryalloc(struct mempool *pool, void **block);
+int mempool_timedalloc(struct mempool *pool, void **block, uint32_t timeout_millis);
+int mempool_free(struct mempool *pool, void *block);
+int mempool_free_from_isr(struct mempool *pool, void *block);
+uint16_t mempool_get_free_count(struct mempool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMPOOL_H_ */
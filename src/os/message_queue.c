@@ -0,0 +1,395 @@
+/**
+ * @file メッセージキュー実装
+ *       メッセージはポインタで受け渡し、内容はコピーしない。
+ *       受信を待っているタスクがいる場合、送信したメッセージはバッファを経由せずに
+ *       直接そのタスクに渡される。
+ *       バッファが一杯の時に送信を待っているタスクのメッセージは、
+ *       受信によって空いた位置に格納され、送信したタスクは待機解除される。
+ *       容量0のキューは、送信と受信が揃った時に受け渡すランデブーとして動作する。
+ * @author 
+ */
+
+#include "kernel.h"
+#include "task.h"
+#include "message_queue.h"
+#include "../rx_utils/error_code.h"
+
+static int send(struct message_queue *mq, void *msg,
+		uint8_t is_timed, uint32_t timeout_millis);
+static int receive(struct message_queue *mq, void **msg,
+		uint8_t is_timed, uint32_t timeout_millis);
+static int put(struct message_queue *mq, void *msg, struct task_entry **wakeup_entry);
+static int get(struct message_queue *mq, void **msg, struct task_entry **wakeup_entry);
+static void push_tail(struct message_queue *mq, void *msg);
+static void send_from_isr_proc(void *obj, uintptr_t value);
+
+/**
+ * メッセージキューを初期化する。
+ *
+ * @param mq メッセージキュー
+ * @param buffer メッセージを格納するバッファ。capacity個のポインタを格納できること。
+ * @param capacity バッファに格納できるメッセージ数
+ */
+void
+mq_init(struct message_queue *mq, void **buffer, uint16_t capacity)
+{
+	wait_object_init(&(mq->recv_wait));
+	wait_object_init(&(mq->send_wait));
+	mq->buffer = buffer;
+	mq->capacity = capacity;
+	mq->head = 0;
+	mq->count = 0;
+	mq->isr_dropped = 0;
+
+	return ;
+}
+
+/**
+ * メッセージキューを破棄する。
+ *
+ * @param mq メッセージキュー
+ */
+void
+mq_destroy(struct message_queue *mq)
+{
+	wait_object_destroy(&(mq->recv_wait));
+	wait_object_destroy(&(mq->send_wait));
+	mq->buffer = NULL;
+	mq->capacity = 0;
+	mq->head = 0;
+	mq->count = 0;
+
+	return ;
+}
+
+/**
+ * メッセージを送信する。
+ * バッファが一杯の場合、受信されて空きができるまで待機する。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+mq_send(struct message_queue *mq, void *msg)
+{
+	return send(mq, msg, 0, 0);
+}
+
+/**
+ * メッセージを送信する。
+ * バッファが一杯の場合には待機せずにエラーを返す。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ * @return 成功した場合には0、送信できなかった場合にはERR_OPERATION_STATEを返す。
+ */
+int
+mq_trysend(struct message_queue *mq, void *msg)
+{
+	struct task_entry *wakeup_entry = NULL;
+	int retval;
+
+	kernel_disable_context_switch();
+	retval = put(mq, msg, &wakeup_entry);
+	kernel_enable_context_switch();
+	if (wakeup_entry != NULL) {
+		kernel_request_swtich();
+	}
+
+	return retval;
+}
+
+/**
+ * メッセージを送信する。
+ * バッファが一杯の場合、空きができるかタイムアウトするまで待機する。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+int
+mq_timedsend(struct message_queue *mq, void *msg, uint32_t timeout_millis)
+{
+	return send(mq, msg, 1, timeout_millis);
+}
+
+/**
+ * 割り込みハンドラからメッセージを送信する。
+ * 送信はスケジューラで行われ、受信を待っているタスクは割り込みからの復帰時に
+ * ディスパッチされる。
+ * スケジューラで送信する時点でバッファが一杯の場合、メッセージは破棄され、
+ * isr_droppedがインクリメントされる。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+mq_send_from_isr(struct message_queue *mq, void *msg)
+{
+	return kernel_request_from_isr(send_from_isr_proc, mq, (uintptr_t)(msg));
+}
+
+/**
+ * メッセージを受信する。
+ * メッセージが無い場合、送信されるまで待機する。
+ *
+ * @param mq メッセージキュー
+ * @param msg 受信したメッセージを格納する変数
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+mq_receive(struct message_queue *mq, void **msg)
+{
+	return receive(mq, msg, 0, 0);
+}
+
+/**
+ * メッセージを受信する。
+ * メッセージが無い場合には待機せずにエラーを返す。
+ *
+ * @param mq メッセージキュー
+ * @param msg 受信したメッセージを格納する変数
+ * @return 成功した場合には0、メッセージが無い場合にはERR_OPERATION_STATEを返す。
+ */
+int
+mq_tryreceive(struct message_queue *mq, void **msg)
+{
+	struct task_entry *wakeup_entry = NULL;
+	int retval;
+
+	kernel_disable_context_switch();
+	retval = get(mq, msg, &wakeup_entry);
+	kernel_enable_context_switch();
+	if (wakeup_entry != NULL) {
+		kernel_request_swtich();
+	}
+
+	return retval;
+}
+
+/**
+ * メッセージを受信する。
+ * メッセージが無い場合、送信されるかタイムアウトするまで待機する。
+ *
+ * @param mq メッセージキュー
+ * @param msg 受信したメッセージを格納する変数
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+int
+mq_timedreceive(struct message_queue *mq, void **msg, uint32_t timeout_millis)
+{
+	return receive(mq, msg, 1, timeout_millis);
+}
+
+/**
+ * バッファに格納されているメッセージ数を得る。
+ *
+ * @param mq メッセージキュー
+ * @return メッセージ数
+ */
+uint16_t
+mq_get_count(struct message_queue *mq)
+{
+	return mq->count;
+}
+
+/**
+ * メッセージを送信する。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ * @param is_timed タイムアウトするかどうか
+ * @param timeout_millis タイムアウト時間[ミリ秒]
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+static int
+send(struct message_queue *mq, void *msg,
+		uint8_t is_timed, uint32_t timeout_millis)
+{
+	struct task_entry *self = kernel_get_current_task();
+	struct task_entry *wakeup_entry = NULL;
+
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
+	}
+
+	kernel_disable_context_switch();
+	if (put(mq, msg, &wakeup_entry) == 0) {
+		kernel_enable_context_switch();
+		if (wakeup_entry != NULL) {
+			kernel_request_swtich();
+		}
+		return 0;
+	}
+
+	/* 受信したタスクがバッファに格納してから待機解除する */
+	self->param.wait_data = msg;
+	if (!is_timed) {
+		return kernel_sysc_wait_object(&(mq->send_wait));
+	} else {
+		return kernel_sysc_wait_object_timeout(&(mq->send_wait), timeout_millis);
+	}
+}
+
+/**
+ * メッセージを受信する。
+ *
+ * @param mq メッセージキュー
+ * @param msg 受信したメッセージを格納する変数
+ * @param is_timed タイムアウトするかどうか
+ * @param timeout_millis タイムアウト時間[ミリ秒]
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+static int
+receive(struct message_queue *mq, void **msg,
+		uint8_t is_timed, uint32_t timeout_millis)
+{
+	struct task_entry *self = kernel_get_current_task();
+	struct task_entry *wakeup_entry = NULL;
+	int retval;
+
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
+	}
+
+	kernel_disable_context_switch();
+	if (get(mq, msg, &wakeup_entry) == 0) {
+		kernel_enable_context_switch();
+		if (wakeup_entry != NULL) {
+			kernel_request_swtich();
+		}
+		return 0;
+	}
+
+	/* 送信したタスクがwait_dataにメッセージを設定してから待機解除する */
+	if (!is_timed) {
+		retval = kernel_sysc_wait_object(&(mq->recv_wait));
+	} else {
+		retval = kernel_sysc_wait_object_timeout(&(mq->recv_wait), timeout_millis);
+	}
+	if (retval == 0) {
+		*msg = self->param.wait_data;
+	}
+
+	return retval;
+}
+
+/**
+ * 待機せずにメッセージを送信する。
+ * 受信を待っているタスクがいる場合、メッセージはそのタスクに直接渡す。
+ *
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ * @param wakeup_entry 待機解除したタスクを格納する変数
+ * @return 成功した場合には0、バッファが一杯の場合にはERR_OPERATION_STATEを返す。
+ */
+static int
+put(struct message_queue *mq, void *msg, struct task_entry **wakeup_entry)
+{
+	/* 受信を待っているタスクがいるのは、バッファが空の時だけ */
+	struct task_entry *entry = kernel_signal_object(&(mq->recv_wait));
+	if (entry != NULL) {
+		entry->param.wait_data = msg;
+		*wakeup_entry = entry;
+		return 0;
+	}
+	if (mq->count < mq->capacity) {
+		push_tail(mq, msg);
+		return 0;
+	}
+
+	return ERR_OPERATION_STATE;
+}
+
+/**
+ * 待機せずにメッセージを受信する。
+ * 送信を待っているタスクがいる場合、そのタスクのメッセージを受け取って待機解除する。
+ *
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param mq メッセージキュー
+ * @param msg 受信したメッセージを格納する変数
+ * @param wakeup_entry 待機解除したタスクを格納する変数
+ * @return 成功した場合には0、メッセージが無い場合にはERR_OPERATION_STATEを返す。
+ */
+static int
+get(struct message_queue *mq, void **msg, struct task_entry **wakeup_entry)
+{
+	struct task_entry *entry;
+
+	if (mq->count > 0) {
+		*msg = mq->buffer[mq->head];
+		mq->head++;
+		if (mq->head >= mq->capacity) {
+			mq->head = 0;
+		}
+		mq->count--;
+
+		/* 空いた位置に、送信を待っているタスクのメッセージを格納する */
+		entry = kernel_signal_object(&(mq->send_wait));
+		if (entry != NULL) {
+			push_tail(mq, entry->param.wait_data);
+			*wakeup_entry = entry;
+		}
+		return 0;
+	}
+
+	/* 容量0のキューでは、送信を待っているタスクから直接受け取る */
+	entry = kernel_signal_object(&(mq->send_wait));
+	if (entry != NULL) {
+		*msg = entry->param.wait_data;
+		*wakeup_entry = entry;
+		return 0;
+	}
+
+	return ERR_OPERATION_STATE;
+}
+
+/**
+ * バッファの末尾にメッセージを格納する。
+ * 呼び出し元で空きがあることを確認すること。
+ *
+ * @param mq メッセージキュー
+ * @param msg メッセージ
+ */
+static void
+push_tail(struct message_queue *mq, void *msg)
+{
+	uint16_t tail = mq->head + mq->count;
+	if (tail >= mq->capacity) {
+		tail -= mq->capacity;
+	}
+	mq->buffer[tail] = msg;
+	mq->count++;
+
+	return ;
+}
+
+/**
+ * mq_send_from_isr()で依頼された処理をスケジューラで実行する。
+ *
+ * @param obj メッセージキュー
+ * @param value メッセージ
+ */
+static void
+send_from_isr_proc(void *obj, uintptr_t value)
+{
+	struct message_queue *mq = (struct message_queue *)(obj);
+	struct task_entry *wakeup_entry = NULL;
+
+	if (put(mq, (void *)(value), &wakeup_entry) != 0) {
+		mq->isr_dropped++;
+	}
+
+	return ;
+}
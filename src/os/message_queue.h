@@ -0,0 +1,51 @@
+/**
+ * @file メッセージキュー
+ * @author 
+ */
+
+#ifndef MESSAGE_QUEUE_H_
+#define MESSAGE_QUEUE_H_
+
+#include "../rx_utils/rx_types.h"
+#include "wait_object.h"
+
+struct message_queue {
+	struct wait_object recv_wait; /* 受信を待っているタスク */
+	struct wait_object send_wait; /* 送信を待っているタスク */
+	void **buffer; /* メッセージを格納するバッファ */
+	uint16_t capacity; /* バッファに格納できるメッセージ数 */
+	uint16_t head; /* 次に受信するメッセージの位置 */
+	uint16_t count; /* 格納しているメッセージ数 */
+	uint16_t isr_dropped; /* 割り込みハンドラから送信し、バッファが一杯で破棄したメッセージ数 */
+};
+
+/**
+ * メッセージキューの初期化子
+ * 静的に配置するメッセージキューを、mq_init()を呼ばずに初期化する。
+ *
+ * @param buf メッセージを格納するバッファ (void *の配列)
+ * @param cap バッファに格納できるメッセージ数
+ */
+#define MESSAGE_QUEUE_INITIALIZER(buf, cap) \
+	{ WAIT_OBJECT_INITIALIZER, WAIT_OBJECT_INITIALIZER, (buf), (cap), 0, 0, 0 }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void mq_init(struct message_queue *mq, void **buffer, uint16_t capacity);
+void mq_destroy(struct message_queue *mq);
+int mq_send(struct message_queue *mq, void *msg);
+int mq_trysend(struct message_queue *mq, void *msg);
+int mq_timedsend(struct message_queue *mq, void *msg, uint32_t timeout_millis);
+int mq_send_from_isr(struct message_queue *mq, void *msg);
+int mq_receive(struct message_queue *mq, void **msg);
+int mq_tryreceive(struct message_queue *mq, void **msg);
+int mq_timedreceive(struct message_queue *mq, void **msg, uint32_t timeout_millis);
+uint16_t mq_get_count(struct message_queue *mq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESSAGE_QUEUE_H_ */
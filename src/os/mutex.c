@@ -1,24 +1,57 @@
 /**
  * @file ミューテックス
+ *       優先度の逆転を防ぐため、優先度継承またはプライオリティシーリングを行う。
+ *       所有者のプライオリティは、ロックしている全てのミューテックスのうち
+ *       最も高いもの（継承値またはシーリング値）と、本来のプライオリティとの最大値になる。
+ *       同じタスクによる多重ロックは、同じ回数アンロックした時に解放される。
  * @author 
  */
 #include "../rx_utils/error_code.h"
 #include "task.h"
 #include "kernel.h"
 #include "mutex.h"
+#include "kernel_trace.h"
 
-static void mutex_update(void *arg);
+static int lock(struct mutex *m, uint8_t is_timed, uint32_t timeout_millis);
+static int is_above_ceiling(const struct mutex *m, const struct task_entry *entry);
+static void acquire(struct mutex *m, struct task_entry *entry);
+static void release(struct mutex *m, struct task_entry *entry);
+static void inherit_priority(struct mutex *m, uint8_t priority);
+static void update_priority(struct task_entry *entry);
 
 /**
  * ミューテックスを初期化する。
+ * 優先度継承を行うミューテックスとして初期化する。
  *
  * @param m ミューテックス
  */
 void
 mutex_init(struct mutex *m)
 {
-	wait_object_init(&(m->wait_object), mutex_update, m);
+	wait_object_init(&(m->wait_object));
 	m->owner_task_id = 0;
+	m->next_held = NULL;
+	m->lock_count = 0;
+	m->protocol = MUTEX_PROTOCOL_INHERIT;
+	m->ceiling = 0;
+
+	return;
+}
+
+/**
+ * ミューテックスを初期化する。
+ * プライオリティシーリングを行うミューテックスとして初期化する。
+ *
+ * @param m ミューテックス
+ * @param ceiling シーリング値。ロックするタスクの最も高いプライオリティを指定する。
+ *                本来のプライオリティがシーリング値より高いタスクはロックできない。
+ */
+void
+mutex_init_ceiling(struct mutex *m, uint8_t ceiling)
+{
+	mutex_init(m);
+	m->protocol = MUTEX_PROTOCOL_CEILING;
+	m->ceiling = (ceiling < KERNEL_NUM_PRIORITIES) ? ceiling : (KERNEL_NUM_PRIORITIES - 1);
 
 	return;
 }
@@ -35,44 +68,171 @@ mutex_destroy(struct mutex *m)
 
 	return ;
 }
+/**
+ * ミューテックスを待っているタスクに所有権を渡す順序を設定する。
+ * 待っているタスクがいる場合には変更できない。
+ *
+ * @param m ミューテックス
+ * @param order WAIT_OBJECT_ORDER_FIFO または WAIT_OBJECT_ORDER_PRIORITY
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+mutex_set_wait_order(struct mutex *m, uint8_t order)
+{
+	int retval;
+
+	kernel_disable_context_switch();
+	retval = wait_object_set_order(&(m->wait_object), order);
+	kernel_enable_context_switch();
+
+	return retval;
+}
+
 /**
  * ミューテックスをロックする。
  * すぐに所有権が取得できない場合、待機せずに制御を返す。
  *
  * @param m ミューテックス
- * @return 成功した場合には0、失敗した場合にはエラー番号。
+ * @return 成功した場合には0、プライオリティシーリングのミューテックスで、
+ *         本来のプライオリティがシーリング値より高い場合にはERR_INVAL、
+ *         失敗した場合にはエラー番号。
  */
 int
 mutex_trylock(struct mutex *m)
 {
-	int self_task_id = kernel_get_self_id();
+	struct task_entry *self = kernel_get_current_task();
+	int retval;
+
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
+	}
+	if (is_above_ceiling(m, self)) {
+		return ERR_INVAL;
+	}
+
+	kernel_disable_context_switch();
 	if (m->owner_task_id == 0) {
-		mutex_lock(m);
-		return (m->owner_task_id == self_task_id);
+		acquire(m, self);
+		retval = 0;
+	} else if (m->owner_task_id == self->param.id) {
+		m->lock_count++;
+		retval = 0;
 	} else {
-		return ERR_OPERATION_STATE;
+		retval = ERR_OPERATION_STATE;
 	}
+	kernel_enable_context_switch();
+
+	return retval;
 }
 
 /**
  * ミューテックスをロックする。
  * 所有権が取得できない場合、取得できるまで待機する。
+ * 優先度継承を行うミューテックスの場合、待機している間、
+ * 所有者（所有者が他のミューテックスを待っている場合にはその所有者も）に
+ * 自タスクのプライオリティを継承させる。
  *
  * @param m ミューテックス
- * @return 成功した場合には0、失敗した場合にはエラー番号。
+ * @return 成功した場合には0、プライオリティシーリングのミューテックスで、
+ *         本来のプライオリティがシーリング値より高い場合にはERR_INVAL、
+ *         失敗した場合にはエラー番号。
  */
 int
 mutex_lock(struct mutex *m)
 {
-	int self_task_id = kernel_get_self_id();
-	while (m->owner_task_id != self_task_id) {
-	    kernel_sysc_wait_object(&(m->wait_object));
+	return lock(m, 0, 0);
+}
+
+/**
+ * ミューテックスをロックする。
+ * 所有権が取得できない場合、取得できるかタイムアウトするまで待機する。
+ *
+ * @param m ミューテックス
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         プライオリティシーリングのミューテックスで、
+ *         本来のプライオリティがシーリング値より高い場合にはERR_INVAL、
+ *         失敗した場合にはエラー番号。
+ */
+int
+mutex_timedlock(struct mutex *m, uint32_t timeout_millis)
+{
+	return lock(m, 1, timeout_millis);
+}
+
+/**
+ * ミューテックスをロックする。
+ *
+ * @param m ミューテックス
+ * @param is_timed タイムアウトするかどうか
+ * @param timeout_millis タイムアウト時間[ミリ秒]
+ * @return 成功した場合には0、タイムアウトした場合にはERR_TIMEOUT、
+ *         失敗した場合にはエラー番号。
+ */
+static int
+lock(struct mutex *m, uint8_t is_timed, uint32_t timeout_millis)
+{
+	struct task_entry *self = kernel_get_current_task();
+	int retval = 0;
+
+	if (self == NULL) {
+		return ERR_OPERATION_STATE;
 	}
-	return 0;
+	if (is_above_ceiling(m, self)) {
+		/* シーリング値まで上げても、ロック中に割り込まれないことを保証できない */
+		return ERR_INVAL;
+	}
+
+	kernel_disable_context_switch();
+	if (m->owner_task_id == 0) {
+		acquire(m, self);
+		kernel_enable_context_switch();
+	} else if (m->owner_task_id == self->param.id) {
+		m->lock_count++;
+		kernel_enable_context_switch();
+	} else if (is_timed && (timeout_millis == 0)) {
+		kernel_enable_context_switch();
+		retval = ERR_TIMEOUT;
+	} else {
+		if (m->protocol == MUTEX_PROTOCOL_INHERIT) {
+			inherit_priority(m, self->param.priority);
+		}
+		/* mutex_unlock()で所有権を渡されてから待機解除される */
+		self->wait_mutex = m;
+		if (!is_timed) {
+		    retval = kernel_sysc_wait_object(&(m->wait_object));
+		} else {
+			retval = kernel_sysc_wait_object_timeout(&(m->wait_object), timeout_millis);
+			if (retval != 0) {
+				/* タイムアウトした。待ちから外れたので、所有者に継承させたプライオリティを戻す */
+				kernel_disable_context_switch();
+				mutex_cancel_wait(self);
+				kernel_enable_context_switch();
+			}
+		}
+	}
+	return retval;
+}
+
+/**
+ * タスクの本来のプライオリティが、プライオリティシーリングのミューテックスの
+ * シーリング値より高いかどうかを判定する。
+ *
+ * @param m ミューテックス
+ * @param entry ロックするタスク
+ * @return シーリング値より高い場合には非0、そうでない場合や優先度継承の場合には0
+ */
+static int
+is_above_ceiling(const struct mutex *m, const struct task_entry *entry)
+{
+	return (m->protocol == MUTEX_PROTOCOL_CEILING)
+			&& (entry->param.base_priority > m->ceiling);
 }
 
 /**
  * ミューテックスをアンロックする。
+ * 待っているタスクがいる場合には、所有権を渡してから待機解除する。
+ * 継承していたプライオリティは、まだロックしているミューテックスの分を残して元に戻す。
  *
  * @param m ミューテックス
  * @return 成功した場合には0、失敗した場合にはエラー番号。
@@ -80,34 +240,195 @@ mutex_lock(struct mutex *m)
 int
 mutex_unlock(struct mutex *m)
 {
-	int self_task_id = kernel_get_self_id();
-	if (m->owner_task_id != self_task_id) {
+	struct task_entry *self = kernel_get_current_task();
+	if ((self == NULL) || (m->owner_task_id != self->param.id)) {
 		return ERR_NOT_OWNER;
 	}
 
 	kernel_disable_context_switch();
-	m->owner_task_id = 0;
+	if (m->lock_count > 1) {
+		m->lock_count--;
+		kernel_enable_context_switch();
+		return 0;
+	}
+
+	uint8_t priority = self->param.priority;
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_MUTEX_UNLOCK, self->param.id, m);
+	release(m, self);
+	struct task_entry *entry = kernel_signal_object(&(m->wait_object));
+	if (entry != NULL) {
+		entry->wait_mutex = NULL;
+		acquire(m, entry);
+	}
+	update_priority(self);
 	kernel_enable_context_switch();
+	if ((entry != NULL) || (self->param.priority < priority)) {
+		kernel_request_swtich();
+	}
 
 	return 0;
 }
 
+/**
+ * ミューテックスの待ちから外れたタスクについて、所有者に継承させたプライオリティを戻す。
+ * inherit_priority()と同じく、所有者が他のミューテックスを待っている場合には
+ * その所有者も順に、プライオリティが変わらなくなるまで求め直す。
+ * タスクはミューテックスの待機オブジェクトから外した後で渡すこと。
+ * コンテキストスイッチ無効状態で呼び出すこと。
+ *
+ * @param entry ミューテックスを待っていたタスク
+ */
+void
+mutex_cancel_wait(struct task_entry *entry)
+{
+	struct mutex *m = entry->wait_mutex;
+	if (m == NULL) {
+		return ;
+	}
+
+	entry->wait_mutex = NULL;
+	while ((m != NULL) && (m->protocol == MUTEX_PROTOCOL_INHERIT)) {
+		struct task_entry *owner = kernel_get_task(m->owner_task_id);
+		if (owner == NULL) {
+			break;
+		}
+		uint8_t priority = owner->param.priority;
+		update_priority(owner);
+		if (owner->param.priority == priority) {
+			break;
+		}
+		m = owner->wait_mutex;
+	}
+
+	return ;
+}
+
+/**
+ * タスクがロックしている全てのミューテックスを解放する。
+ * 多重ロックの回数によらず解放し、待っているタスクがいる場合には
+ * mutex_unlock()と同じく所有権を渡してから待機解除する。
+ * 終了するタスクが、所有権を残したままにならないようにするために使用する。
+ * コンテキストスイッチ無効状態で呼び出すこと。
+ *
+ * @param entry 所有者のタスク
+ * @return 最後に待機解除したタスク。待っているタスクがいない場合にはNULLが返る。
+ */
+struct task_entry *
+mutex_release_all(struct task_entry *entry)
+{
+	struct task_entry *woken = NULL;
+	struct mutex *m;
+
+	while ((m = entry->held_mutexes) != NULL) {
+		KERNEL_TRACE_EVENT(KERNEL_TRACE_MUTEX_UNLOCK, entry->param.id, m);
+		release(m, entry);
+		struct task_entry *waiter = kernel_signal_object(&(m->wait_object));
+		if (waiter != NULL) {
+			waiter->wait_mutex = NULL;
+			acquire(m, waiter);
+			woken = waiter;
+		}
+	}
+
+	return woken;
+}
+
+/**
+ * ミューテックスの所有権を取得させる。
+ * コンテキストスイッチ無効状態で呼び出すこと。
+ *
+ * @param m ミューテックス
+ * @param entry 所有者にするタスク
+ */
+static void
+acquire(struct mutex *m, struct task_entry *entry)
+{
+	m->owner_task_id = entry->param.id;
+	m->lock_count = 1;
+	KERNEL_TRACE_EVENT(KERNEL_TRACE_MUTEX_LOCK, entry->param.id, m);
+	m->next_held = entry->held_mutexes;
+	entry->held_mutexes = m;
+
+	/* シーリング値か、残っている待ちタスクのプライオリティを反映させる */
+	update_priority(entry);
+
+	return ;
+}
+
+/**
+ * ミューテックスの所有権を放棄させる。
+ * コンテキストスイッチ無効状態で呼び出すこと。
+ *
+ * @param m ミューテックス
+ * @param entry 所有者のタスク
+ */
+static void
+release(struct mutex *m, struct task_entry *entry)
+{
+	struct mutex **pheld = &(entry->held_mutexes);
+	while (*pheld != NULL) {
+		if (*pheld == m) {
+			*pheld = m->next_held;
+			break;
+		}
+		pheld = &((*pheld)->next_held);
+	}
+	m->next_held = NULL;
+	m->owner_task_id = 0;
+	m->lock_count = 0;
+
+	return ;
+}
 
 /**
- * ミューテックスを更新する。
+ * ミューテックスの所有者にプライオリティを継承させる。
+ * 所有者が他のミューテックスを待っている場合には、その所有者にも順に継承させる。
+ * コンテキストスイッチ無効状態で呼び出すこと。
  *
- * @param arg ミューテックス
+ * @param m ミューテックス
+ * @param priority 継承させるプライオリティ
  */
 static void
-mutex_update(void *arg)
+inherit_priority(struct mutex *m, uint8_t priority)
 {
-	struct mutex *m = (struct mutex*)(arg);
+	while ((m != NULL) && (m->protocol == MUTEX_PROTOCOL_INHERIT)) {
+		struct task_entry *owner = kernel_get_task(m->owner_task_id);
+		if ((owner == NULL) || (owner->param.priority >= priority)) {
+			break;
+		}
+		kernel_change_task_priority(owner, priority);
+		m = owner->wait_mutex;
+	}
+
+	return ;
+}
 
-	if ((m->owner_task_id == 0) && wait_object_has_wait_entries(&(m->wait_object))) {
-		const struct task_entry *entry = wait_object_release_one(&(m->wait_object));
-		if (entry != NULL) {
-			m->owner_task_id = entry->param.id;
+/**
+ * タスクのプライオリティを、本来のプライオリティとロックしているミューテックスから求め直す。
+ * コンテキストスイッチ無効状態で呼び出すこと。
+ *
+ * @param entry タスク
+ */
+static void
+update_priority(struct task_entry *entry)
+{
+	uint8_t priority = entry->param.base_priority;
+	const struct mutex *held = entry->held_mutexes;
+	while (held != NULL) {
+		uint8_t held_priority;
+		if (held->protocol == MUTEX_PROTOCOL_CEILING) {
+			held_priority = held->ceiling;
+		} else {
+			held_priority = wait_object_get_max_priority(&(held->wait_object));
+		}
+		if (held_priority > priority) {
+			priority = held_priority;
 		}
+		held = held->next_held;
+	}
+
+	if (priority != entry->param.priority) {
+		kernel_change_task_priority(entry, priority);
 	}
 
 	return ;
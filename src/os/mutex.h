@@ -6,26 +6,65 @@
 #ifndef MUTEX_H_
 #define MUTEX_H_
 
+#include "../rx_utils/rx_types.h"
 #include "wait_object.h"
 
+/**
+ * 優先度継承
+ * 待っているタスクのうち最も高いプライオリティを、所有者に継承させる。
+ */
+#define MUTEX_PROTOCOL_INHERIT 0
+/**
+ * プライオリティシーリング
+ * 所有者のプライオリティを、ロックしている間シーリング値まで上げる。
+ */
+#define MUTEX_PROTOCOL_CEILING 1
+
+struct task_entry;
+
 struct mutex {
 	struct wait_object wait_object;
 	int owner_task_id;
+	struct mutex *next_held; /* 所有者がロックしている次のミューテックス */
+	uint16_t lock_count; /* 所有者による多重ロック数 */
+	uint8_t protocol; /* MUTEX_PROTOCOL_INHERIT または MUTEX_PROTOCOL_CEILING */
+	uint8_t ceiling; /* シーリング値 (MUTEX_PROTOCOL_CEILINGの時のみ使用) */
 };
 
+/**
+ * ミューテックスの初期化子
+ * 静的に配置するミューテックスを、mutex_init()を呼ばずに初期化する。
+ */
+#define MUTEX_INITIALIZER { WAIT_OBJECT_INITIALIZER, 0, NULL, 0, MUTEX_PROTOCOL_INHERIT, 0 }
+/**
+ * プライオリティシーリングのミューテックスの初期化子
+ * mutex_init_ceiling()と異なり、ceilingを KERNEL_NUM_PRIORITIES - 1 に丸めないので、
+ * 範囲内の値を指定すること。
+ */
+#define MUTEX_CEILING_INITIALIZER(ceiling_priority) \
+	{ WAIT_OBJECT_INITIALIZER, 0, NULL, 0, MUTEX_PROTOCOL_CEILING, (ceiling_priority) }
+
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void mutex_init(struct mutex *m);
+void mutex_init_ceiling(struct mutex *m, uint8_t ceiling);
 void mutex_destroy(struct mutex *m);
 
 int mutex_lock(struct mutex *m);
+int mutex_timedlock(struct mutex *m, uint32_t timeout_millis);
 int mutex_unlock(struct mutex *m);
 
 int mutex_trylock(struct mutex *m);
 
+int mutex_set_wait_order(struct mutex *m, uint8_t order);
+
+/* kernel APIs */
+void mutex_cancel_wait(struct task_entry *entry);
+struct task_entry *mutex_release_all(struct task_entry *entry);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,186 @@
+/**
+ * @file レディキュー
+ *       実行可能なタスクをプライオリティ毎のFIFOリストで保持する。
+ *       bitmapのビットnは、プライオリティnのリストが空でないことを表す。
+ *       最上位のセットビットを求めることで、リスト数によらず一定時間で
+ *       最もプライオリティが高いタスクを得ることができる。
+ * @author 
+ */
+#include "ready_queue.h"
+
+#if (KERNEL_NUM_PRIORITIES > 32)
+#error "KERNEL_NUM_PRIORITIES must be less than or equal to 32."
+#endif
+
+static uint8_t find_highest_bit(uint32_t bits);
+
+/**
+ * レディキューを初期化する。
+ *
+ * @param queue レディキュー
+ */
+void
+ready_queue_init(struct ready_queue *queue)
+{
+	queue->bitmap = 0;
+	for (int i = 0; i < KERNEL_NUM_PRIORITIES; i++) {
+		task_list_init(&(queue->lists[i]));
+	}
+
+	return ;
+}
+
+/**
+ * レディキューを破棄する。
+ *
+ * @param queue レディキュー
+ */
+void
+ready_queue_destroy(struct ready_queue *queue)
+{
+	/* no action. */
+	return ;
+}
+
+/**
+ * タスクをレディキューに追加する。
+ * 同じプライオリティのタスクの中では末尾に追加される。
+ *
+ * @param queue レディキュー
+ * @param entry エントリ
+ */
+void
+ready_queue_add(struct ready_queue *queue, struct task_entry *entry)
+{
+	uint8_t priority = entry->param.priority;
+
+	task_list_add(&(queue->lists[priority]), entry);
+	queue->bitmap |= ((uint32_t)(1) << priority);
+
+	return ;
+}
+
+/**
+ * タスクをレディキューに追加する。
+ * 同じプライオリティのタスクの中では先頭に追加される。
+ * より高いプライオリティのタスクに割り込まれたタスクを、元の順番に戻すために使用する。
+ *
+ * @param queue レディキュー
+ * @param entry エントリ
+ */
+void
+ready_queue_add_head(struct ready_queue *queue, struct task_entry *entry)
+{
+	uint8_t priority = entry->param.priority;
+
+	task_list_add_head(&(queue->lists[priority]), entry);
+	queue->bitmap |= ((uint32_t)(1) << priority);
+
+	return ;
+}
+
+/**
+ * 最もプライオリティが高いタスクを取り出す。
+ * 同じプライオリティのタスクが複数ある場合には、先に追加されたタスクが返る。
+ *
+ * @param queue レディキュー
+ * @return タスク。レディキューが空の場合にはNULLが返る。
+ */
+struct task_entry *
+ready_queue_pop(struct ready_queue *queue)
+{
+	if (queue->bitmap == 0) {
+		return NULL;
+	}
+
+	uint8_t priority = find_highest_bit(queue->bitmap);
+	struct task_list *list = &(queue->lists[priority]);
+	struct task_entry *entry = task_list_pop(list);
+	if (task_list_is_empty(list)) {
+		queue->bitmap &= ~((uint32_t)(1) << priority);
+	}
+
+	return entry;
+}
+
+/**
+ * レディキューからentryを削除する。
+ * entryはレディキューに登録されていること。
+ *
+ * @param queue レディキュー
+ * @param entry エントリ
+ */
+void
+ready_queue_remove(struct ready_queue *queue, struct task_entry *entry)
+{
+	uint8_t priority = entry->param.priority;
+	struct task_list *list = &(queue->lists[priority]);
+
+	task_list_remove(list, entry);
+	if (task_list_is_empty(list)) {
+		queue->bitmap &= ~((uint32_t)(1) << priority);
+	}
+
+	return ;
+}
+
+/**
+ * レディキューが空かどうかを得る。
+ *
+ * @param queue レディキュー
+ * @return 空の場合には非ゼロの値、それ以外は0が返る。
+ */
+int
+ready_queue_is_empty(const struct ready_queue *queue)
+{
+	return (queue->bitmap == 0);
+}
+
+/**
+ * 指定したプライオリティのタスクが存在するかどうかを得る。
+ *
+ * @param queue レディキュー
+ * @param priority プライオリティ
+ * @return 存在する場合には非ゼロの値、それ以外は0が返る。
+ */
+int
+ready_queue_has_priority(const struct ready_queue *queue, uint8_t priority)
+{
+	return ((queue->bitmap & ((uint32_t)(1) << priority)) != 0);
+}
+
+/**
+ * セットされている最上位ビットの位置を得る。
+ * RXにはビットサーチ命令が無いため、二分探索で求める。
+ * 分岐回数は bits の値によらず5回で一定となる。
+ *
+ * @param bits ビット列。0以外であること。
+ * @return 最上位ビットの位置(0～31)
+ */
+static uint8_t
+find_highest_bit(uint32_t bits)
+{
+	uint8_t pos = 0;
+
+	if ((bits & 0xffff0000) != 0) {
+		pos += 16;
+		bits >>= 16;
+	}
+	if ((bits & 0xff00) != 0) {
+		pos += 8;
+		bits >>= 8;
+	}
+	if ((bits & 0xf0) != 0) {
+		pos += 4;
+		bits >>= 4;
+	}
+	if ((bits & 0xc) != 0) {
+		pos += 2;
+		bits >>= 2;
+	}
+	if ((bits & 0x2) != 0) {
+		pos += 1;
+	}
+
+	return pos;
+}
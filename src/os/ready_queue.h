@@ -0,0 +1,39 @@
+/**
+ * @file レディキュー
+ *       プライオリティ毎のFIFOリストとプライオリティビットマップで構成し、
+ *       次に実行するべきタスクを一定時間で取り出せるようにする。
+ * @author 
+ */
+
+#ifndef READY_QUEUE_H_
+#define READY_QUEUE_H_
+
+#include "kernel_config.h"
+#include "task_list.h"
+
+struct ready_queue {
+	uint32_t bitmap; /* タスクが存在するプライオリティのビットマップ */
+	struct task_list lists[KERNEL_NUM_PRIORITIES]; /* プライオリティ毎のタスクリスト */
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ready_queue_init(struct ready_queue *queue);
+void ready_queue_destroy(struct ready_queue *queue);
+
+void ready_queue_add(struct ready_queue *queue, struct task_entry *entry);
+void ready_queue_add_head(struct ready_queue *queue, struct task_entry *entry);
+struct task_entry *ready_queue_pop(struct ready_queue *queue);
+void ready_queue_remove(struct ready_queue *queue, struct task_entry *entry);
+int ready_queue_is_empty(const struct ready_queue *queue);
+int ready_queue_has_priority(const struct ready_queue *queue, uint8_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* READY_QUEUE_H_ */
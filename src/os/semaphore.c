@@ -1,15 +1,18 @@
 /**
  * @file セマフォ実装
- *       待ちを解放する順番はFIFOで実装してある。
- *       プライオリティは考慮してない。
+ *       待ちを解放する順番はFIFOで、sem_set_wait_order()でプライオリティ順に変更できる。
+ *       待っているタスクがいる場合、sem_post()はカウントを増やさずに
+ *       直接そのタスクを待機解除する。
  * @author 
  */
 
 #include "kernel.h"
 #include "semaphore.h"
+#include "kernel_trace.h"
 #include "../rx_utils/error_code.h"
 
-static void sem_update(void *arg);
+static struct task_entry *post(struct semaphore *sem);
+static void post_from_isr_proc(void *obj, uintptr_t value);
 
 /**
  * セマフォを初期化する。
@@ -20,7 +23,7 @@ static void sem_update(void *arg);
 void
 sem_init(struct semaphore *sem, uint16_t initial_count)
 {
-	wait_object_init(&(sem->wait_obj), sem_update, sem);
+	wait_object_init(&(sem->wait_obj));
 	sem->count = initial_count;
 
 	return;
@@ -35,13 +38,31 @@ void
 sem_destroy(struct semaphore *sem)
 {
 	wait_object_destroy(&(sem->wait_obj));
-	sem->wait_obj.update = sem_update;
-	sem->wait_obj.arg = sem;
 	sem->count = 0;
 
 	return;
 }
 
+/**
+ * セマフォを待っているタスクを解放する順序を設定する。
+ * 待っているタスクがいる場合には変更できない。
+ *
+ * @param sem セマフォ
+ * @param order WAIT_OBJECT_ORDER_FIFO または WAIT_OBJECT_ORDER_PRIORITY
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+sem_set_wait_order(struct semaphore *sem, uint8_t order)
+{
+	int retval;
+
+	kernel_disable_context_switch();
+	retval = wait_object_set_order(&(sem->wait_obj), order);
+	kernel_enable_context_switch();
+
+	return retval;
+}
+
 /**
  * セマフォを待つ。もしセマフォが取得できない場合にはエラーを返す。
  *
@@ -51,11 +72,18 @@ sem_destroy(struct semaphore *sem)
 int
 sem_trywait(struct semaphore *sem)
 {
+	int retval;
+
+	kernel_disable_context_switch();
 	if ((sem->count > 0) && !wait_object_has_wait_entries(&(sem->wait_obj))) {
-		return sem_wait(sem);
+		sem->count--;
+		retval = 0;
 	} else {
-		return ERR_OPERATION_STATE;
+		retval = ERR_OPERATION_STATE;
 	}
+	kernel_enable_context_switch();
+
+	return retval;
 }
 
 /**
@@ -66,12 +94,45 @@ sem_trywait(struct semaphore *sem)
 int
 sem_wait(struct semaphore *sem)
 {
-	kernel_sysc_wait_object(&(sem->wait_obj));
+	KERNEL_TRACE_SELF(KERNEL_TRACE_SEM_WAIT, sem);
+	kernel_disable_context_switch();
+	if ((sem->count > 0) && !wait_object_has_wait_entries(&(sem->wait_obj))) {
+		sem->count--;
+		kernel_enable_context_switch();
+	} else {
+		/* sem_post()で直接待機解除されるため、カウントは減らさない */
+		kernel_sysc_wait_object(&(sem->wait_obj));
+	}
 	return 0;
 }
 
+/**
+ * セマフォを待つ。
+ * 指定時間内にセマフォが取得できない場合にはエラーを返す。
+ *
+ * @param sem セマフォ
+ * @param timeout_millis タイムアウト時間[ミリ秒]。0の場合は待機しない。
+ * @return セマフォが取得できた場合には0、タイムアウトした場合にはERR_TIMEOUTを返す。
+ */
+int
+sem_timedwait(struct semaphore *sem, uint32_t timeout_millis)
+{
+	KERNEL_TRACE_SELF(KERNEL_TRACE_SEM_WAIT, sem);
+	kernel_disable_context_switch();
+	if ((sem->count > 0) && !wait_object_has_wait_entries(&(sem->wait_obj))) {
+		sem->count--;
+		kernel_enable_context_switch();
+		return 0;
+	} else {
+		/* sem_post()で直接待機解除されるため、カウントは減らさない */
+		return kernel_sysc_wait_object_timeout(&(sem->wait_obj), timeout_millis);
+	}
+}
+
 /**
  * セマフォをインクリメントする。
+ * 待っているタスクがいる場合には、カウントをインクリメントする代わりに
+ * 先頭のタスクを待機解除する。
  *
  * @param sem セマフォ
  */
@@ -79,24 +140,54 @@ void
 sem_post(struct semaphore *sem)
 {
 	kernel_disable_context_switch();
-	sem->count++;
+	struct task_entry *entry = post(sem);
 	kernel_enable_context_switch();
-	kernel_request_swtich();
+	if (entry != NULL) {
+		kernel_request_swtich();
+	}
 }
 
 /**
- * セマフォを更新する。
+ * 割り込みハンドラからセマフォをインクリメントする。
+ * インクリメントはスケジューラで行われ、待っているタスクは割り込みからの復帰時に
+ * ディスパッチされる。
  *
- * @param arg セマフォ
+ * @param sem セマフォ
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
  */
-static void
-sem_update(void *arg)
+int
+sem_post_from_isr(struct semaphore *sem)
 {
-	struct semaphore *sem = (struct semaphore*)(arg);
+	return kernel_request_from_isr(post_from_isr_proc, sem, 0);
+}
 
-	while ((sem->count > 0) && wait_object_has_wait_entries(&(sem->wait_obj))) {
-		sem->count--;
-		wait_object_release_one(&(sem->wait_obj));
+/**
+ * セマフォをインクリメントする。
+ * 呼び出し元はコンテキストスイッチを無効にした状態で呼び出すこと。
+ *
+ * @param sem セマフォ
+ * @return 待機解除したタスク。待っているタスクがいない場合にはNULLが返る。
+ */
+static struct task_entry *
+post(struct semaphore *sem)
+{
+	KERNEL_TRACE_SELF(KERNEL_TRACE_SEM_POST, sem);
+	struct task_entry *entry = kernel_signal_object(&(sem->wait_obj));
+	if (entry == NULL) {
+		sem->count++;
 	}
+
+	return entry;
 }
 
+/**
+ * sem_post_from_isr()で依頼された処理をスケジューラで実行する。
+ *
+ * @param obj セマフォ
+ * @param value 未使用
+ */
+static void
+post_from_isr_proc(void *obj, uintptr_t value)
+{
+	post((struct semaphore *)(obj));
+}
@@ -13,10 +13,22 @@ struct semaphore {
 	uint16_t count;
 };
 
+/**
+ * セマフォの初期化子
+ * 静的に配置するセマフォを、sem_init()を呼ばずに初期化する。
+ *
+ *   static struct semaphore Sem = SEMAPHORE_INITIALIZER(0);
+ */
+#define SEMAPHORE_INITIALIZER(initial_count) { WAIT_OBJECT_INITIALIZER, (initial_count) }
+
 void sem_init(struct semaphore *sem, uint16_t initial_count);
 void sem_destroy(struct semaphore *sem);
 int sem_wait(struct semaphore *sem);
+int sem_trywait(struct semaphore *sem);
+int sem_timedwait(struct semaphore *sem, uint32_t timeout_millis);
+int sem_set_wait_order(struct semaphore *sem, uint8_t order);
 void sem_post(struct semaphore *sem);
+int sem_post_from_isr(struct semaphore *sem);
 
 
 #endif /* OS_SEMAPHORE_H_ */
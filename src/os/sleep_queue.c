@@ -0,0 +1,156 @@
+/**
+ * @file スリープキュー
+ *       タスクは param.wakeup_tick の昇順に並べて保持する。
+ *       先頭のタスクだけを見れば待機解除するべきタスクがあるかどうかが分かるため、
+ *       待機解除の処理は待機解除されるタスクの数だけで済む。
+ *       タスクの prev/next を使用するため、レディキューに登録されているタスクを
+ *       追加してはならない。
+ * @author 
+ */
+#include "sleep_queue.h"
+
+/**
+ * スリープキューを初期化する。
+ *
+ * @param queue スリープキュー
+ */
+void
+sleep_queue_init(struct sleep_queue *queue)
+{
+	queue->head = NULL;
+	return ;
+}
+
+/**
+ * スリープキューを破棄する。
+ *
+ * @param queue スリープキュー
+ */
+void
+sleep_queue_destroy(struct sleep_queue *queue)
+{
+	/* no action. */
+	return ;
+}
+
+/**
+ * タスクをスリープキューに追加する。
+ * 待機解除時刻が同じタスクの中では末尾に追加される。
+ *
+ * @param queue スリープキュー
+ * @param entry エントリ。param.wakeup_tickを設定しておくこと。
+ */
+void
+sleep_queue_add(struct sleep_queue *queue, struct task_entry *entry)
+{
+	uint32_t wakeup_tick = entry->param.wakeup_tick;
+	struct task_entry *prev = NULL;
+	struct task_entry *next = queue->head;
+
+	/* カウンタのオーバーフローを考慮し、差分の符号で前後を判定する。 */
+	while ((next != NULL) && ((int32_t)(next->param.wakeup_tick - wakeup_tick) <= 0)) {
+		prev = next;
+		next = next->next;
+	}
+
+	/* タイマー割り込みから先頭を参照するため、entryを設定してからリンクする。 */
+	entry->prev = prev;
+	entry->next = next;
+	if (next != NULL) {
+		next->prev = entry;
+	}
+	if (prev != NULL) {
+		prev->next = entry;
+	} else {
+		queue->head = entry;
+	}
+
+	return ;
+}
+
+/**
+ * 待機解除時刻に到達したタスクを1つ取り出す。
+ *
+ * @param queue スリープキュー
+ * @param now 現在のタイマーカウンタ値
+ * @return 待機解除時刻に到達したタスク。無い場合にはNULLが返る。
+ */
+struct task_entry *
+sleep_queue_pop_expired(struct sleep_queue *queue, uint32_t now)
+{
+	struct task_entry *entry = queue->head;
+	if ((entry == NULL) || !sleep_queue_is_expired(entry, now)) {
+		return NULL;
+	}
+
+	sleep_queue_remove(queue, entry);
+
+	return entry;
+}
+
+/**
+ * スリープキューの先頭を得る。
+ * 先頭は最も早く待機解除されるタスクとなる。
+ *
+ * @param queue スリープキュー
+ * @return 先頭のエントリ。空の場合にはNULLが返る。
+ */
+struct task_entry *
+sleep_queue_head(struct sleep_queue *queue)
+{
+	return queue->head;
+}
+
+/**
+ * スリープキューからentryを削除する。
+ * entryがスリープキューに無い場合には何もしない。
+ *
+ * @param queue スリープキュー
+ * @param entry エントリ
+ */
+void
+sleep_queue_remove(struct sleep_queue *queue, struct task_entry *entry)
+{
+	if ((entry->prev == NULL) && (queue->head != entry)) {
+		/* スリープキューに無い */
+		return ;
+	}
+
+	if (entry->prev != NULL) {
+		entry->prev->next = entry->next;
+	} else {
+		queue->head = entry->next;
+	}
+	if (entry->next != NULL) {
+		entry->next->prev = entry->prev;
+	}
+	entry->prev = NULL;
+	entry->next = NULL;
+
+	return ;
+}
+
+/**
+ * スリープキューが空かどうかを得る。
+ *
+ * @param queue スリープキュー
+ * @return 空の場合には非ゼロの値、それ以外は0が返る。
+ */
+int
+sleep_queue_is_empty(const struct sleep_queue *queue)
+{
+	return (queue->head == NULL);
+}
+
+/**
+ * タスクが待機解除時刻に到達しているかどうかを得る。
+ *
+ * @param entry エントリ
+ * @param now 現在のタイマーカウンタ値
+ * @return 到達している場合には非ゼロの値、それ以外は0が返る。
+ */
+int
+sleep_queue_is_expired(const struct task_entry *entry, uint32_t now)
+{
+	return ((int32_t)(now - entry->param.wakeup_tick) >= 0);
+}
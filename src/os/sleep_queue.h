@@ -0,0 +1,36 @@
+/**
+ * @file スリープキュー
+ *       時間待ちをしているタスクを、待機解除時刻の昇順で保持する。
+ * @author 
+ */
+
+#ifndef SLEEP_QUEUE_H_
+#define SLEEP_QUEUE_H_
+
+#include "task.h"
+
+struct sleep_queue {
+	struct task_entry *head;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sleep_queue_init(struct sleep_queue *queue);
+void sleep_queue_destroy(struct sleep_queue *queue);
+
+void sleep_queue_add(struct sleep_queue *queue, struct task_entry *entry);
+struct task_entry *sleep_queue_pop_expired(struct sleep_queue *queue, uint32_t now);
+struct task_entry *sleep_queue_head(struct sleep_queue *queue);
+void sleep_queue_remove(struct sleep_queue *queue, struct task_entry *entry);
+int sleep_queue_is_empty(const struct sleep_queue *queue);
+int sleep_queue_is_expired(const struct task_entry *entry, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* SLEEP_QUEUE_H_ */
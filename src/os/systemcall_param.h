@@ -11,6 +11,7 @@
 #define SYSCALL_NONE        0
 #define SYSCALL_WAIT_MSEC   1
 #define SYSCALL_WAIT_OBJECT 2
+#define SYSCALL_WAIT_OBJECT_TIMEOUT 3
 
 struct wait_object;
 
@@ -18,10 +19,6 @@ struct wait_object;
  * システムコールパラメータ
  */
 union system_call_param {
-	struct {
-		uint32_t begin;
-		uint32_t wait_millis;
-	} wait;
 	struct wait_object *wait_object;
 };
 
@@ -4,6 +4,7 @@
  * @author 
  */
 
+#include "kernel_config.h"
 #include "task.h"
 
 /**
@@ -16,20 +17,46 @@ task_init(struct task_entry *entry)
 {
 	entry->prev = NULL;
 	entry->next = NULL;
+	entry->wait_prev = NULL;
 	entry->wait_next = NULL;
     entry->param.id = 0;
     entry->param.state = TASK_STATE_DEAD;
     entry->param.priority = 0;
+    entry->param.base_priority = 0;
     entry->param.func = NULL;
     entry->param.arg = NULL;
     entry->param.tcb.usp = NULL;
+    entry->param.tcb.flags = 0;
+    entry->param.wakeup_tick = 0;
+    entry->param.wait_result = 0;
+    entry->param.wait_data = NULL;
+    entry->param.wait_flags = 0;
+    entry->param.wait_mode = 0;
+    entry->param.time_slice = 0;
+    entry->param.slice_left = 0;
+    entry->param.lock_count = 0;
+    entry->held_mutexes = NULL;
+    entry->wait_mutex = NULL;
+    wait_object_init(&(entry->join_obj));
     entry->stack = NULL;
+    entry->stack_size = 0;
+    entry->stack_overflow = 0;
+    entry->stack_pooled = 0;
+    entry->generation = 0;
+    entry->run_time = 0;
+    entry->switch_count = 0;
+    entry->voluntary_count = 0;
+    entry->preempted_count = 0;
+    for (int i = 0; i < KERNEL_TLS_SLOTS; i++) {
+    	entry->tls[i] = NULL;
+    }
 
     return ;
 }
 
 /**
  * タスクの破棄処理をする。
+ * 世代番号は、次にエントリを使用するタスクのIDを変えるために残しておく。
  *
  * @param entry データ
  */
@@ -38,6 +65,10 @@ task_destroy(struct task_entry *entry)
 {
     entry->param.id = 0;
     entry->param.state = TASK_STATE_DEAD;
+    entry->stack = NULL;
+    entry->stack_size = 0;
+    entry->stack_overflow = 0;
+    entry->stack_pooled = 0;
 
     return ;
 }
@@ -52,18 +83,33 @@ task_destroy(struct task_entry *entry)
  * @param task_func タスクのエントリ関数
  * @param task_arg タスクのエントリ関数に渡すポインタ
  * @param initial_stack 初期スタックポインタ値
+ * @param options タスクオプション (TASK_OPTION_FPU, TASK_OPTION_DSP)
  */
 void
 task_setup(struct task_entry *entry, task_id_t id,
-		uint8_t priority, task_func_t task_func, void *task_arg, void *initial_stack)
+		uint8_t priority, task_func_t task_func, void *task_arg, void *initial_stack,
+		uint8_t options)
 {
     entry->next = NULL;
     entry->param.id = id;
     entry->param.state = TASK_STATE_PENDING;
     entry->param.priority = priority;
+    entry->param.base_priority = priority;
     entry->param.func = task_func;
     entry->param.arg = task_arg;
     entry->param.tcb.usp = initial_stack;
+    entry->param.tcb.flags = options;
+    entry->param.time_slice = KERNEL_DEFAULT_TIME_SLICE;
+    entry->param.slice_left = 0;
+    entry->held_mutexes = NULL;
+    entry->wait_mutex = NULL;
+    entry->run_time = 0;
+    entry->switch_count = 0;
+    entry->voluntary_count = 0;
+    entry->preempted_count = 0;
+    for (int i = 0; i < KERNEL_TLS_SLOTS; i++) {
+    	entry->tls[i] = NULL;
+    }
 
     return ;
 }
@@ -8,15 +8,24 @@
 
 
 #include "kernel_defs.h"
+#include "kernel_config.h"
 #include "systemcall_param.h"
+#include "wait_object.h"
+
+struct mutex;
 
 #define TASK_STATE_DEAD    0
 #define TASK_STATE_ACTIVE  1
 #define TASK_STATE_PENDING 2
 #define TASK_STATE_WAITING 3
 
+/**
+ * タスクコンテキストブロック
+ * kernel_asm.srcからオフセットで参照するため、メンバの順番を変更しないこと。
+ */
 struct rxcc_tcb {
-    void *usp; /* ユーザースタックポインタ */
+    void *usp; /* ユーザースタックポインタ (ホストビルドではホスト用のコンテキスト) */
+    uint32_t flags; /* 退避/復元するレジスタ (TASK_OPTION_FPU, TASK_OPTION_DSP) */
 };
 
 /**
@@ -25,12 +34,20 @@ struct rxcc_tcb {
 struct task_param {
     uint16_t id; /* ID */
     uint8_t state; /* ステート */
-    uint8_t priority; /* プライオリティ */
+    uint8_t priority; /* プライオリティ（継承したプライオリティを含む） */
     struct rxcc_tcb tcb; /* タスクコンテキストブロック */
     task_func_t func; /* 実行する関数 */
     void *arg; /* 引数 */
     uint8_t syscall_type; /* システムコールタイプ */
-    uint8_t rsvd[3];
+    uint8_t base_priority; /* 本来のプライオリティ */
+    uint16_t time_slice; /* タイムスライス[ミリ秒] 0はラウンドロビンしない */
+    uint16_t slice_left; /* タイムスライスの残り[ミリ秒] */
+    uint16_t lock_count; /* コンテキストスイッチを無効にしたネスト数 */
+    uint32_t wakeup_tick; /* 時間待ちを解除するタイマーカウンタ値 */
+    int32_t wait_result; /* 待機結果 (0:待機解除された ERR_TIMEOUT:タイムアウトした) */
+    void *wait_data; /* 待機解除時に受け渡すデータ */
+    uint32_t wait_flags; /* 待っているイベントフラグ（待機解除時は成立したフラグ） */
+    uint8_t wait_mode; /* イベントフラグの待ち条件 */
     union system_call_param sysc; /* システムコール */
 };
 
@@ -40,11 +57,69 @@ struct task_param {
 struct task_entry {
 	struct task_entry *prev;
     struct task_entry *next;
+    struct task_entry *wait_prev;
     struct task_entry *wait_next;
     struct task_param param;
-    uint32_t *stack;
+    struct mutex *held_mutexes; /* ロックしているミューテックス */
+    struct mutex *wait_mutex; /* 待っているミューテックス */
+    struct wait_object join_obj; /* タスクの終了を待っているタスク */
+    stack_type_t *stack; /* スタック領域の先頭 */
+    uint32_t stack_size; /* スタックサイズ[バイト] */
+    uint8_t stack_overflow; /* スタックオーバーフローを検出したかどうか */
+    uint8_t stack_pooled; /* スタックをスタックプールから割り当てたかどうか */
+    uint16_t generation; /* タスクIDの世代番号。エントリを再利用する毎に更新する */
+    uint64_t run_time; /* 実行時間の累計[マイクロ秒] */
+    uint32_t switch_count; /* ディスパッチされた回数 */
+    uint32_t voluntary_count; /* 待機などで自ら切り替えた回数 */
+    uint32_t preempted_count; /* 割り込みなどで切り替えられた回数 */
+    void *tls[KERNEL_TLS_SLOTS]; /* タスク毎のローカルストレージ */
 };
 
+/**
+ * 静的コンフィギュレーションのタスクエントリの初期化子
+ * task_setup()でセットアップしたのと同じ実行待ち(TASK_STATE_PENDING)の状態になる。
+ * 指定しないメンバー(TLSなど)は0になる。
+ * 初期コンテキスト(tcb.usp)は kernel_init() でスタックに作成する。
+ *
+ * @param prev_entry レディキューの前のエントリ
+ * @param next_entry レディキューの次のエントリ
+ * @param task_id タスクID (KERNEL_STATIC_TASK_ID())
+ * @param task_priority プライオリティ
+ * @param task_func タスクのエントリ関数
+ * @param task_arg タスクのエントリ関数に渡すポインタ
+ * @param task_stack スタック (stack_type_tの配列)
+ * @param task_options タスクオプション (TASK_OPTION_FPU, TASK_OPTION_DSP)
+ */
+#define TASK_ENTRY_INITIALIZER(prev_entry, next_entry, task_id, task_priority, \
+		task_func, task_arg, task_stack, task_options) \
+	{ \
+		.prev = (prev_entry), \
+		.next = (next_entry), \
+		.param = { \
+			.id = (task_id), \
+			.state = TASK_STATE_PENDING, \
+			.priority = (task_priority), \
+			.tcb = { NULL, (task_options) }, \
+			.func = (task_func), \
+			.arg = (task_arg), \
+			.base_priority = (task_priority), \
+			.time_slice = KERNEL_DEFAULT_TIME_SLICE, \
+		}, \
+		.stack = (task_stack), \
+		.stack_size = sizeof(task_stack), \
+		.generation = 1, \
+	}
+
+/**
+ * 静的コンフィギュレーションの空きタスクエントリの初期化子
+ * task_init()で初期化したのと同じ状態になる。
+ *
+ * @param prev_entry 空きタスクリストの前のエントリ
+ * @param next_entry 空きタスクリストの次のエントリ
+ */
+#define TASK_ENTRY_BLANK_INITIALIZER(prev_entry, next_entry) \
+	{ .prev = (prev_entry), .next = (next_entry) }
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -53,7 +128,8 @@ void task_init(struct task_entry *entry);
 void task_destroy(struct task_entry *entry);
 
 void task_setup(struct task_entry *entry, task_id_t id,
-		uint8_t priority, task_func_t task_func, void *task_arg, void *initial_stack);
+		uint8_t priority, task_func_t task_func, void *task_arg, void *initial_stack,
+		uint8_t options);
 
 #ifdef __cplusplus
 }
@@ -56,6 +56,31 @@ task_list_add(struct task_list *list, struct task_entry *entry)
 	return ;
 }
 
+/**
+ * タスクリスト先頭に追加する。
+ *
+ * @param list タスクリスト
+ * @param entry エントリ
+ */
+void
+task_list_add_head(struct task_list *list, struct task_entry *entry)
+{
+	if (list->head == NULL) {
+		/* 1つもタスクが無い */
+		list->head = entry;
+		list->tail = entry;
+		entry->prev = NULL;
+		entry->next = NULL;
+	} else {
+		list->head->prev = entry;
+		entry->next = list->head;
+		list->head = entry;
+		entry->prev = NULL;
+	}
+
+	return ;
+}
+
 /**
  * タスクリストの先頭を取り出す。
  *
@@ -22,6 +22,7 @@ void task_list_init(struct task_list *list);
 void task_list_destroy(struct task_list *list);
 
 void task_list_add(struct task_list *list, struct task_entry *entry);
+void task_list_add_head(struct task_list *list, struct task_entry *entry);
 struct task_entry* task_list_pop(struct task_list *list);
 struct task_entry* task_list_head(struct task_list* list);
 void task_list_remove(struct task_list *list, struct task_entry *entry);
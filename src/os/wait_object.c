@@ -1,28 +1,30 @@
 /**
  * @file 待機オブジェクト
+ *       待っているタスクは wait_prev/wait_next の双方向リストで保持し、
+ *       先頭と末尾を持つことで、追加、解放、削除をリストを辿らずに行う。
+ *       プライオリティ順の場合も、末尾または先頭に追加できる場合にはリストを辿らない。
  * @author 
  */
 #include "../rx_utils/rx_types.h"
+#include "../rx_utils/error_code.h"
 #include "task.h"
 #include "wait_object.h"
 
-static struct task_entry* get_tail(struct task_entry *wait_entry);
-static void update_default(struct wait_object *obj);
+static void insert_before(struct wait_object *obj, struct task_entry *next,
+		struct task_entry *entry);
 
 /**
  * 待機オブジェクトを初期化する。
+ * 解放順序はFIFOになる。
  *
  * @param obj 待機オブジェクト
- * @param update 更新関数
- * @param arg 更新関数に渡すパラメータ
  */
 void
-wait_object_init(struct wait_object *obj, void (*update)(), void *arg)
+wait_object_init(struct wait_object *obj)
 {
-	obj->next = NULL;
 	obj->wait_entries = NULL;
-	obj->update = update;
-	obj->arg = arg;
+	obj->wait_tail = NULL;
+	obj->order = WAIT_OBJECT_ORDER_FIFO;
 	return ;
 }
 
@@ -37,13 +39,33 @@ wait_object_init(struct wait_object *obj, void (*update)(), void *arg)
 void
 wait_object_destroy(struct wait_object *obj)
 {
-	obj->next = NULL;
 	obj->wait_entries = NULL;
-	obj->update = NULL;
-	obj->arg = NULL;
+	obj->wait_tail = NULL;
 	return ;
 }
 
+/**
+ * 待っているタスクの解放順序を設定する。
+ * 待っているタスクがいる場合には変更できない。
+ *
+ * @param obj 待機オブジェクト
+ * @param order WAIT_OBJECT_ORDER_FIFO または WAIT_OBJECT_ORDER_PRIORITY
+ * @return 成功した場合には0、失敗した場合にはエラー番号。
+ */
+int
+wait_object_set_order(struct wait_object *obj, uint8_t order)
+{
+	if ((order != WAIT_OBJECT_ORDER_FIFO) && (order != WAIT_OBJECT_ORDER_PRIORITY)) {
+		return ERR_INVAL;
+	}
+	if (obj->wait_entries != NULL) {
+		return ERR_OPERATION_STATE;
+	}
+	obj->order = order;
+
+	return 0;
+}
+
 /**
  * 待機中のタスクを1つリリースする。
  *
@@ -55,8 +77,7 @@ wait_object_release_one(struct wait_object *obj)
 {
 	struct task_entry *entry = obj->wait_entries;
 	if (entry != NULL) {
-		obj->wait_entries = entry->wait_next;
-		entry->wait_next = NULL;
+		wait_object_remove(obj, entry);
 		if (entry->param.sysc.wait_object == obj) {
 			entry->param.sysc.wait_object = NULL;
 		}
@@ -66,7 +87,9 @@ wait_object_release_one(struct wait_object *obj)
 }
 
 /**
- * プライオリティは考慮されない。FIFOで順番に取り出すことを想定する。
+ * 待機オブジェクトにタスクを追加する。
+ * FIFOの場合は末尾に追加する。
+ * プライオリティ順の場合は、同じプライオリティのタスクの末尾に追加する。
  *
  * @param obj 待機オブジェクト
  * @param entry エントリ
@@ -74,94 +97,129 @@ wait_object_release_one(struct wait_object *obj)
 void
 wait_object_add(struct wait_object *obj, struct task_entry *entry)
 {
-	if (obj->wait_entries != NULL) {
-		struct task_entry *tail = get_tail(obj->wait_entries);
-		tail->wait_next = entry;
-	} else {
-		obj->wait_entries = entry;
+	struct task_entry *tail = obj->wait_tail;
+	struct task_entry *next = NULL;
+
+	if ((obj->order == WAIT_OBJECT_ORDER_PRIORITY) && (tail != NULL)
+			&& (tail->param.priority < entry->param.priority)) {
+		/* 末尾に追加できない場合だけ、挿入位置を探す */
+		next = obj->wait_entries;
+		while (next->param.priority >= entry->param.priority) {
+			next = next->wait_next;
+		}
 	}
-	entry->wait_next = NULL;
+	insert_before(obj, next, entry);
 
 	return ;
 }
 
 /**
- * 末尾を得る。
+ * 待機オブジェクトからタスクを削除する。
  *
- * @param entry 先頭エントリ
- * @return 末尾エントリ
+ * @param obj 待機オブジェクト
+ * @param entry エントリ。objを待っているタスクであること。
  */
-static struct task_entry*
-get_tail(struct task_entry *wait_entry)
+void
+wait_object_remove(struct wait_object *obj, struct task_entry *entry)
 {
-	while (wait_entry->wait_next != NULL) {
-		wait_entry = wait_entry->wait_next;
+	if (entry->wait_prev != NULL) {
+		entry->wait_prev->wait_next = entry->wait_next;
+	} else {
+		obj->wait_entries = entry->wait_next;
 	}
+	if (entry->wait_next != NULL) {
+		entry->wait_next->wait_prev = entry->wait_prev;
+	} else {
+		obj->wait_tail = entry->wait_prev;
+	}
+	entry->wait_prev = NULL;
+	entry->wait_next = NULL;
 
-	return wait_entry;
+	return ;
 }
 
 /**
- * 待機オブジェクトに対して、待機しているタスクが存在するかどうかを得る。
+ * 待っているタスクのプライオリティが変わった時に、解放順序を更新する。
+ * FIFOの場合は何もしない。
  *
- * @param obj オブジェクト
- * @return 待機タスクが存在する場合には非ゼロの値、それ以外は0が返る。
+ * @param obj 待機オブジェクト
+ * @param entry エントリ。objを待っているタスクであること。
  */
-int
-wait_object_has_wait_entries(struct wait_object *obj)
+void
+wait_object_update_priority(struct wait_object *obj, struct task_entry *entry)
 {
-	return (obj->wait_entries != NULL);
+	if (obj->order == WAIT_OBJECT_ORDER_PRIORITY) {
+		wait_object_remove(obj, entry);
+		wait_object_add(obj, entry);
+	}
+
+	return ;
 }
 
 /**
- * デフォルトの更新処理をする。
- * デフォルトの実装では、この待機オブジェクトに対して待っている全てのタスクをペンディング状態に戻す。
+ * nextの前にentryを挿入する。
  *
- * @param wait_obj 待機オブジェクト
+ * @param obj 待機オブジェクト
+ * @param next 挿入位置のエントリ。NULLの場合は末尾に追加する。
+ * @param entry エントリ
  */
 static void
-update_default(struct wait_object *obj)
+insert_before(struct wait_object *obj, struct task_entry *next,
+		struct task_entry *entry)
 {
-	while (obj->wait_entries != NULL) {
-		struct task_entry *wait_entry = obj->wait_entries;
-		obj->wait_entries = wait_entry->wait_next;
-		wait_entry->wait_next = NULL;
+	struct task_entry *prev = (next != NULL) ? next->wait_prev : obj->wait_tail;
+
+	entry->wait_prev = prev;
+	entry->wait_next = next;
+	if (prev != NULL) {
+		prev->wait_next = entry;
+	} else {
+		obj->wait_entries = entry;
+	}
+	if (next != NULL) {
+		next->wait_prev = entry;
+	} else {
+		obj->wait_tail = entry;
 	}
 
 	return ;
 }
 
 /**
- * 待機オブジェクトを更新する。
+ * 待機オブジェクトに対して、待機しているタスクが存在するかどうかを得る。
  *
- * @param obj 待機オブジェクト
+ * @param obj オブジェクト
+ * @return 待機タスクが存在する場合には非ゼロの値、それ以外は0が返る。
  */
-void
-wait_object_update(struct wait_object *obj)
+int
+wait_object_has_wait_entries(struct wait_object *obj)
 {
-	if (obj->update != NULL) {
-		obj->update(obj->arg);
-	} else {
-		update_default(obj);
-	}
+	return (obj->wait_entries != NULL);
 }
 
 /**
- * entryで指定されるタスクが、objを待っているかどうかを得る。
+ * 待機オブジェクトを待っているタスクのうち、最も高いプライオリティを得る。
+ * プライオリティ順の場合は先頭のタスクのプライオリティになる。
  *
  * @param obj 待機オブジェクト
- * @param entry タスク
- * @return 待っている場合には非ゼロの値を返す。それ以外は0を返す。
+ * @return プライオリティ。待っているタスクがいない場合には0が返る。
  */
-int
-wait_object_is_waiting_entry(const struct wait_object *obj, const struct task_entry *entry)
+uint8_t
+wait_object_get_max_priority(const struct wait_object *obj)
 {
-	const struct task_entry *wait_entry = obj->wait_entries;
-	while (wait_entry != NULL) {
-		if (wait_entry == entry) {
-			return 1;
+	uint8_t priority = 0;
+	const struct task_entry *entry = obj->wait_entries;
+
+	if (obj->order == WAIT_OBJECT_ORDER_PRIORITY) {
+		return (entry != NULL) ? entry->param.priority : 0;
+	}
+
+	while (entry != NULL) {
+		if (entry->param.priority > priority) {
+			priority = entry->param.priority;
 		}
-		wait_entry = wait_entry->wait_next;
+		entry = entry->wait_next;
 	}
-	return 0;
+
+	return priority;
 }
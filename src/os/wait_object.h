@@ -8,27 +8,46 @@
 #ifndef WAIT_OBJECT_H_
 #define WAIT_OBJECT_H_
 
+#include "../rx_utils/rx_types.h"
+
+/**
+ * 待っているタスクを、待ち始めた順に解放する。
+ */
+#define WAIT_OBJECT_ORDER_FIFO     0
+/**
+ * 待っているタスクを、プライオリティが高い順に解放する。
+ * 同じプライオリティのタスクは待ち始めた順に解放する。
+ */
+#define WAIT_OBJECT_ORDER_PRIORITY 1
+
 struct task_entry;
 
 struct wait_object {
-	struct wait_object *next;
-	struct task_entry *wait_entries;
-	void (*update)(void *arg);
-	void *arg;
+	struct task_entry *wait_entries; /* 待っているタスクの先頭（次に解放するタスク） */
+	struct task_entry *wait_tail; /* 待っているタスクの末尾 */
+	uint8_t order; /* 解放順序 WAIT_OBJECT_ORDER_FIFO / WAIT_OBJECT_ORDER_PRIORITY */
 };
 
+/**
+ * 待機オブジェクトの初期化子
+ * wait_object_init()で初期化したのと同じ状態になる。
+ */
+#define WAIT_OBJECT_INITIALIZER { NULL, NULL, WAIT_OBJECT_ORDER_FIFO }
+
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void wait_object_init(struct wait_object *obj, void (*update)(), void *arg);
+void wait_object_init(struct wait_object *obj);
 void wait_object_destroy(struct wait_object *obj);
+int wait_object_set_order(struct wait_object *obj, uint8_t order);
 struct task_entry *wait_object_release_one(struct wait_object *obj);
 void wait_object_add(struct wait_object *obj, struct task_entry *entry);
+void wait_object_remove(struct wait_object *obj, struct task_entry *entry);
+void wait_object_update_priority(struct wait_object *obj, struct task_entry *entry);
 int wait_object_has_wait_entries(struct wait_object *obj);
-void wait_object_update(struct wait_object *obj);
-int wait_object_is_waiting_entry(const struct wait_object *obj, const struct task_entry *entry);
+uint8_t wait_object_get_max_priority(const struct wait_object *obj);
 
 #ifdef __cplusplus
 }
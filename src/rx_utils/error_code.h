@@ -12,6 +12,7 @@
 #define ERR_IO                  4    /* IO エラー */
 #define ERR_NOMEM               5    /* メモリなしエラー */
 #define ERR_NOT_OWNER           6    /* オブジェクトの所有権が無い */
+#define ERR_TIMEOUT             7    /* 待機がタイムアウトした */
 
 /* ドライバ固有エラー */
 #define ERR_DRV_FLASH_TIMEOUT   1000 /* 操作がタイムアウトした */
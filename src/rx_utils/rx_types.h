@@ -21,6 +21,11 @@ typedef _UQWORD uint64_t;
 typedef _UDWORD size_t;
 #endif
 
+/* ポインタを格納できる整数型。ホスト(64bit)でビルドした場合は64bitになる。 */
+#ifndef UINTPTR_MAX
+typedef _UDWORD uintptr_t;
+#endif
+
 /* RXREG定義
  *   gccの場合にはvolatileだけで良さそう。
  *   ccrxの場合には __evenaccess を付けないと、レジスタへのビットアクセスがうまくいかない。（たぶん命令が違う)
@@ -8,6 +8,7 @@
 
 /* Note:ハードウェアに併せてインクルードを変更する */
 #include "../drv/sci/sci.h"
+#include "../os/kernel.h"
 
 struct fmt_info {
 	char type; /* 書式文字 ('c' 'x' 'd'など。 %後にあらわれた文字が格納される。 */
@@ -29,6 +30,32 @@ static int print_real(char *pbuf, uint16_t left, double value,
 		const struct fmt_info *info);
 static int print_string(char *pbuf, uint16_t left, const char *str,
 		const struct fmt_info *info);
+static char *get_debug_buffer(void);
+static void free_debug_buffer(void *buf);
+
+/**
+ * rx_debug()で書式化するバッファのサイズ[バイト]
+ */
+#define RX_DEBUG_BUFFER_SIZE 256
+
+/**
+ * rx_debug()のタスク毎のバッファ数 (8以下)
+ * タスクの小さなスタックに書式化用のバッファを置かないように、rx_debug()を呼び出したタスクに
+ * TLSで1つずつ割り当て、タスクが終了すると戻す。
+ * 足りない場合は、タスク間の共有バッファにクリティカルセクション内で書式化する。
+ * 割り込みハンドラ(とスケジューラ開始前)は、KERNEL_PRIORITY以下の割り込みを止めて
+ * 専用のバッファに書式化する。
+ */
+#define RX_DEBUG_NUM_BUFFERS 4
+
+static char DebugBuffers[RX_DEBUG_NUM_BUFFERS][RX_DEBUG_BUFFER_SIZE];
+static uint8_t DebugBufferUsed = 0; /* 割り当て済みのバッファのビットマップ */
+static char DebugSharedBuffer[RX_DEBUG_BUFFER_SIZE]; /* タスク間の共有バッファ */
+static char DebugIsrBuffer[RX_DEBUG_BUFFER_SIZE]; /* 割り込みハンドラ用のバッファ */
+static int DebugTlsSlot = -1; /* バッファを保持するTLSのスロット */
+
+static rx_isr_hook_t IsrEnterHook = NULL; /* 割り込みハンドラの開始を通知する処理 */
+static rx_isr_hook_t IsrExitHook = NULL; /* 割り込みハンドラの終了を通知する処理 */
 
 /**
  * 書式文字列をバッファに書き出す。
@@ -603,13 +630,15 @@ rx_strlen(const char *s)
 /**
  * デバッグ出力する。
  * 本関数はプラットフォームに依存する。
+ * タスクと、KERNEL_PRIORITY以下の割り込みハンドラから呼び出せる。
+ * KERNEL_PRIORITYより高い割り込みハンドラから呼び出した場合は何も出力しない。
  *
  * @param fmt 書式文字列
  */
 void
 rx_debug(const char *fmt, ...)
 {
-	char msgbuf[256];
+	char *msgbuf;
 	va_list ap;
 
 	if ((fmt == NULL) || (fmt[0] == '\0')) {
@@ -617,24 +646,102 @@ rx_debug(const char *fmt, ...)
 	}
 
 	va_start(ap, fmt);
-    rx_vsnprintf(msgbuf, 256, fmt, ap);
 #ifdef EMULATOR
-    OutputDebugStringA((msg))
+    msgbuf = DebugSharedBuffer;
+    rx_vsnprintf(msgbuf, RX_DEBUG_BUFFER_SIZE, fmt, ap);
+    OutputDebugStringA((msgbuf))
 #else
-    uint8_t is_interrupt_enable = rx_util_is_interrupt_enable();
-    if (is_interrupt_enable) {
-        /* デバッグデータストア中に割り込まれるとおかしくなるので割り込み禁止 */
-        rx_util_disable_interrupt();
-    }
-    drv_sci_send(SCI_CH_DEBUG, (const uint8_t*)(msgbuf), rx_strlen(msgbuf));
-    if (is_interrupt_enable) {
-        /* 割り込み許可を戻す */
-        rx_util_enable_interrupt();
+    if (!rx_util_is_user_mode()) {
+    	if (((rx_util_get_psw() >> 24) & 0xf) > KERNEL_PRIORITY) {
+    		/* 送信FIFOへの書き込みをタスクと排他できないので、出力しない */
+    		va_end(ap);
+    		return;
+    	}
+    	/* 割り込みハンドラ用のバッファはKERNEL_PRIORITY以下の割り込みハンドラで共有するため、
+    	 * 書式化から送信までKERNEL_PRIORITY以下の割り込みを止める */
+    	uint32_t state = kernel_enter_critical();
+    	rx_vsnprintf(DebugIsrBuffer, RX_DEBUG_BUFFER_SIZE, fmt, ap);
+    	drv_sci_send(SCI_CH_DEBUG, (const uint8_t*)(DebugIsrBuffer), rx_strlen(DebugIsrBuffer));
+    	kernel_exit_critical(state);
+    } else {
+    	uint32_t state;
+    	msgbuf = get_debug_buffer();
+    	if (msgbuf != NULL) {
+    		/* タスク専用のバッファなので、書式化中に切り替えられても良い */
+    		rx_vsnprintf(msgbuf, RX_DEBUG_BUFFER_SIZE, fmt, ap);
+    		state = kernel_enter_critical();
+    	} else {
+    		/* 共有バッファはタスクだけが使うが、送信と合わせてクリティカルセクションで排他する */
+    		state = kernel_enter_critical();
+    		msgbuf = DebugSharedBuffer;
+    		rx_vsnprintf(msgbuf, RX_DEBUG_BUFFER_SIZE, fmt, ap);
+    	}
+    	/* 送信FIFOには割り込みハンドラのrx_debug()も書き込み、送信割り込みが取り出すので、
+    	 * IPLをKERNEL_PRIORITYまで上げて(タスクの切り替えとKERNEL_PRIORITY以下の割り込みを
+    	 * 止めて)から書き込む */
+    	drv_sci_send(SCI_CH_DEBUG, (const uint8_t*)(msgbuf), rx_strlen(msgbuf));
+    	kernel_exit_critical(state);
     }
 #endif
 	va_end(ap);
 }
 
+/**
+ * 実行中のタスクのrx_debug()用のバッファを得る。
+ * 初めて呼び出したタスクには、空いているバッファを割り当ててTLSに保持する。
+ *
+ * タスク(ユーザーモード)から呼び出すこと。
+ *
+ * @return バッファ。空きが無い場合はNULLが返る。
+ */
+static char *
+get_debug_buffer(void)
+{
+	if (DebugTlsSlot < 0) {
+		uint32_t state = kernel_enter_critical();
+		if (DebugTlsSlot < 0) {
+			DebugTlsSlot = kernel_tls_alloc(free_debug_buffer);
+		}
+		kernel_exit_critical(state);
+	}
+
+	char *buf = (char *)(kernel_tls_get(DebugTlsSlot));
+	if (buf != NULL) {
+		return buf;
+	}
+
+	uint32_t state = kernel_enter_critical();
+	for (int i = 0; i < RX_DEBUG_NUM_BUFFERS; i++) {
+		if ((DebugBufferUsed & (1 << i)) == 0) {
+			DebugBufferUsed |= (uint8_t)(1 << i);
+			buf = DebugBuffers[i];
+			break;
+		}
+	}
+	kernel_exit_critical(state);
+	if ((buf != NULL) && (kernel_tls_set(DebugTlsSlot, buf) != 0)) {
+		free_debug_buffer(buf);
+		buf = NULL;
+	}
+
+	return buf;
+}
+
+/**
+ * rx_debug()用のバッファを戻す。
+ * タスクが終了した時に、カーネルから呼び出される。
+ *
+ * @param buf get_debug_buffer()で割り当てたバッファ
+ */
+static void
+free_debug_buffer(void *buf)
+{
+	int i = (int)(((char *)(buf) - DebugBuffers[0]) / RX_DEBUG_BUFFER_SIZE);
+	if ((i >= 0) && (i < RX_DEBUG_NUM_BUFFERS)) {
+		DebugBufferUsed &= (uint8_t)(~(1 << i));
+	}
+}
+
 
 
 /**
@@ -745,3 +852,47 @@ rx_memcpy(void *dest, const void *src, size_t n)
     return dest;
 }
 
+/**
+ * 割り込みハンドラの開始/終了を通知する処理を設定する。
+ * 通知中に切り替わらないように、割り込みハンドラが動作していない時か、
+ * 割り込みを禁止して呼び出すこと。
+ *
+ * @param enter 開始を通知する処理。不要ならNULL。
+ * @param exit 終了を通知する処理。不要ならNULL。
+ */
+void
+rx_util_set_isr_hooks(rx_isr_hook_t enter, rx_isr_hook_t exit)
+{
+    IsrEnterHook = enter;
+    IsrExitHook = exit;
+}
+
+/**
+ * 割り込みハンドラの開始を通知する。
+ * ドライバの割り込みハンドラの先頭で呼び出す。
+ *
+ * @param vect ベクタ番号
+ */
+void
+rx_util_isr_enter(uint8_t vect)
+{
+    rx_isr_hook_t hook = IsrEnterHook;
+    if (hook != NULL) {
+        hook(vect);
+    }
+}
+
+/**
+ * 割り込みハンドラの終了を通知する。
+ * ドライバの割り込みハンドラの末尾で呼び出す。
+ *
+ * @param vect ベクタ番号
+ */
+void
+rx_util_isr_exit(uint8_t vect)
+{
+    rx_isr_hook_t hook = IsrExitHook;
+    if (hook != NULL) {
+        hook(vect);
+    }
+}
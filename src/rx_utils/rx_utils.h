@@ -37,6 +37,15 @@
 
 #define RX_MAX_PRIORITY 15
 
+/**
+ * 割り込みハンドラの開始/終了を通知する処理
+ * ドライバはカーネルに依存しないように、rx_util_isr_enter()/rx_util_isr_exit()を呼び出し、
+ * カーネルのトレースなどがrx_util_set_isr_hooks()で登録する。
+ *
+ * @param vect ベクタ番号
+ */
+typedef void (*rx_isr_hook_t)(uint8_t vect);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,6 +57,9 @@ void rx_debug(const char *fmt, ...);
 void *rx_memset(void *s, int c, size_t n);
 int rx_memcmp(const void *b1, const void *b2, size_t n);
 void *rx_memcpy(void *dest, const void *src, size_t n);
+void rx_util_set_isr_hooks(rx_isr_hook_t enter, rx_isr_hook_t exit);
+void rx_util_isr_enter(uint8_t vect);
+void rx_util_isr_exit(uint8_t vect);
 
 
 #ifdef __cplusplus
@@ -7,6 +7,7 @@
 
 #define CPU_PSW_I  (1 << 16)
 #define CPU_PSW_U  (1 << 17)
+#define CPU_PSW_PM (1 << 20)
 
 
 /**
@@ -44,9 +45,53 @@ rx_util_get_ipl(void)
  */
 int
 rx_util_is_user_mode(void)
+{
+    return rx_util_is_user_mode_psw(rx_util_get_psw());
+}
+
+/**
+ * PSWレジスタの値がユーザーモードかどうかを取得する。
+ * Uビット(b17)はスタックポインタの選択なので、PMビット(b20)で判定する。
+ *
+ * @param psw PSWレジスタの値
+ * @return ユーザーモードの場合には非ゼロの値、スーパーバイザーモードの場合には0
+ */
+int
+rx_util_is_user_mode_psw(uint32_t psw)
+{
+    return ((psw & CPU_PSW_PM) != 0) ? 1 : 0;
+}
+
+/**
+ * クリティカルセクションに入る。
+ * 割り込みレベル(IPL)がiplより低い場合、iplまで上げる。
+ * ipl以下の割り込みだけがマスクされ、より高い割り込みは受け付けられる。
+ * スーパーバイザモードでのみ使用できる。
+ *
+ * @param ipl 割り込みレベル(0～15)
+ * @return rx_util_exit_critical()に渡すPSWレジスタの値
+ */
+uint32_t
+rx_util_enter_critical(uint8_t ipl)
 {
     uint32_t psw_reg = rx_util_get_psw();
-    return ((psw_reg & CPU_PSW_U) != 0) ? 1 : 0;
+    if (((psw_reg >> 24) & 0xf) < ipl) {
+        rx_util_set_ipl(ipl);
+    }
+    return psw_reg;
+}
+
+/**
+ * クリティカルセクションから出る。
+ * 割り込みレベル(IPL)をrx_util_enter_critical()を呼び出す前の値に戻す。
+ * スーパーバイザモードでのみ使用できる。
+ *
+ * @param psw rx_util_enter_critical()が返したPSWレジスタの値
+ */
+void
+rx_util_exit_critical(uint32_t psw)
+{
+    rx_util_set_ipl((uint8_t)((psw >> 24) & 0xf));
 }
 
 
@@ -23,6 +23,9 @@ void rx_util_set_psw(uint32_t psw);
 int rx_util_get_ipl(void);
 void rx_util_set_ipl(uint8_t ipl);
 int rx_util_is_user_mode(void);
+int rx_util_is_user_mode_psw(uint32_t psw);
+uint32_t rx_util_enter_critical(uint8_t ipl);
+void rx_util_exit_critical(uint32_t psw);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+ホストビルド用 iodefine.h ジェネレータ
+
+generate/iodefine.h (CC-RX用) を、ホスト(x86-64 Linux)のGCCでビルドできる形に変換する。
+レジスタのアドレスと構造体のレイアウト(オフセット、サイズ、ビット位置)はRXと同じになる。
+
+変換内容:
+  - "#pragma bit_order left" はビットフィールドをMSB側から割り付けるが、GCCはLSB側から割り付ける。
+    ビットフィールドだけからなる構造体は、記憶単位(メンバーの型のサイズ)毎にメンバーの順序を反転し、
+    記憶単位の余りは無名のビットフィールドで埋める。
+  - LP64では unsigned long が64bitになるため、unsigned int に置き換える。
+    アドレスを格納するレジスタ(void *)も、ポインタが64bitになるため unsigned int にする。
+  - CC-RX固有の #pragma (bit_order, unpack, packoption) を取り除く。
+
+使い方:
+  gen_host_iodefine.py ../generate/iodefine.h -o build/include/iodefine.h
+"""
+
+import argparse
+import re
+import sys
+
+TYPE_BITS = {
+    "unsigned char": 8,
+    "unsigned short": 16,
+    "unsigned long": 32,
+}
+
+RE_STRUCT_BEGIN = re.compile(r"^\s*(struct|union)\b[^;]*\{\s*$")
+RE_BLOCK_END = re.compile(r"^\s*\}")
+RE_BITFIELD = re.compile(r"^(\s*)(unsigned (?:char|short|long))\s+(\w*)\s*:\s*(\d+);\s*$")
+RE_POINTER = re.compile(r"^(\s*)void(\s+)\*(\w+);")
+RE_PRAGMA = re.compile(r"^\s*#pragma\s+(bit_order|unpack|packoption)\b")
+
+
+def find_bitfield_blocks(lines):
+    """
+    ビットフィールドのメンバーだけからなる構造体の範囲を得る。
+
+    @param lines 行のリスト
+    @return (開始行, 終了行) のリスト。開始行は "struct {"、終了行は "}" の行
+    """
+    blocks = []
+    stack = []
+    for i, line in enumerate(lines):
+        m = RE_STRUCT_BEGIN.match(line)
+        if m:
+            stack.append((i, m.group(1)))
+        elif RE_BLOCK_END.match(line) and stack:
+            begin, kind = stack.pop()
+            body = lines[begin + 1:i]
+            if (kind == "struct") and body and all(RE_BITFIELD.match(l) for l in body):
+                blocks.append((begin, i))
+    return blocks
+
+
+def convert_bitfields(body, lineno):
+    """
+    MSB側から割り付けたビットフィールドを、LSB側から割り付ける順序に並べ替える。
+
+    @param body メンバーの行のリスト
+    @param lineno エラー表示用の行番号
+    @return 並べ替えた行のリスト
+    """
+    units = []
+    unit = []
+    used = 0
+    unit_type = None
+    indent = ""
+    for line in body:
+        indent, ctype, name, width = RE_BITFIELD.match(line).groups()
+        width = int(width)
+        bits = TYPE_BITS[ctype]
+        if (unit_type is not None) and ((ctype != unit_type) or (used + width > bits)):
+            units.append((unit_type, unit, used))
+            unit = []
+            used = 0
+        if width > bits:
+            raise ValueError("line %d: bit-field wider than its type" % lineno)
+        unit_type = ctype
+        unit.append(line)
+        used += width
+        if used == bits:
+            units.append((unit_type, unit, used))
+            unit = []
+            used = 0
+            unit_type = None
+    if unit:
+        units.append((unit_type, unit, used))
+
+    result = []
+    for ctype, members, used in units:
+        rest = TYPE_BITS[ctype] - used
+        if rest > 0:
+            result.append("%s%s :%d;" % (indent, ctype, rest))
+        result.extend(reversed(members))
+    return result
+
+
+def convert(text):
+    """
+    iodefine.hの内容を変換する。
+
+    @param text 変換元のテキスト
+    @return 変換後のテキスト
+    """
+    lines = text.split("\n")
+    for begin, end in reversed(find_bitfield_blocks(lines)):
+        lines[begin + 1:end] = convert_bitfields(lines[begin + 1:end], begin + 2)
+
+    out = []
+    for line in lines:
+        if RE_PRAGMA.match(line):
+            continue
+        line = RE_POINTER.sub(r"\1unsigned int\2\3;", line)
+        out.append(re.sub(r"\bunsigned long\b", "unsigned int", line))
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert iodefine.h for a host (LP64, GCC) build.")
+    parser.add_argument("input", help="iodefine.h for CC-RX")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    # コメントに含まれる文字はそのまま残すため、バイト単位で扱う
+    with open(args.input, "r", encoding="latin-1") as f:
+        text = f.read()
+
+    header = ("/* This file is generated by tools/gen_host_iodefine.py from %s. Do not edit. */\n"
+              % args.input.replace("\\", "/"))
+    result = header + convert(text)
+    if args.output:
+        with open(args.output, "w", encoding="latin-1") as f:
+            f.write(result)
+    else:
+        sys.stdout.write(result)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,375 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+カーネルの静的コンフィギュレーション ジェネレータ
+
+設定ファイルに書いたタスクとカーネルオブジェクトから、KERNEL_STATIC_CONFIG=1 で
+ビルドするカーネルが使用する次の2つのヘッダを生成する。
+
+  kernel_static.h      : MAX_TASKS, KERNEL_TASK_ID_INDEX_BITS などの設定値、タスクIDのマクロ、オブジェクトのextern宣言
+                         (src/os/kernel_config.h からインクルードされる)
+  kernel_static_data.h : タスクエントリ、スタック、レディキュー、オブジェクトの初期化済みデータ
+                         (src/os/kernel.c の中でだけインクルードされる)
+
+タスクは設定ファイルに書いた順にタスクエントリの先頭から配置し、
+タスクIDは KERNEL_STATIC_ID_<名前> で参照する。
+タスクの関数は、タスクを定義するファイルで static を付けずに定義すること。
+
+設定ファイルの書式 (1行に1項目、# から行末まではコメント):
+  max_tasks <数>                       タスクエントリ数 (省略時は8、最大256)
+  stack_pool <数>                      スタックプールのスタック数 (省略時は kernel_config.h の値)
+  include <ヘッダ>                      引数の式で参照するシンボルを宣言したヘッダ
+  task <名前> <プライオリティ> <関数> <スタックサイズ[バイト]> [arg=<Cの式>] [options=fpu,dsp|none]
+  semaphore <名前> <初期値>
+  mutex <名前> [ceiling=<プライオリティ>]
+  message_queue <名前> <メッセージ数>
+  event_flags <名前> [初期値]
+
+使い方:
+  gen_kernel_static.py kernel_static.cfg -o build/include
+"""
+
+import argparse
+import os
+import re
+import shlex
+import sys
+
+# kernel_config.h と一致させること
+NUM_PRIORITIES = 32
+DEFAULT_MAX_TASKS = 8
+MAX_TASK_ID_INDEX_BITS = 8
+STACK_ALIGN = 4
+
+OPTION_NAMES = {
+    "fpu": "TASK_OPTION_FPU",
+    "dsp": "TASK_OPTION_DSP",
+}
+
+RE_IDENT = re.compile(r"^[A-Za-z_]\w*$")
+
+
+class ConfigError(Exception):
+    pass
+
+
+class Config:
+    def __init__(self):
+        self.max_tasks = None
+        self.stack_pool = None
+        self.includes = []
+        self.tasks = []
+        self.objects = []
+        self.names = set()
+
+
+def parse_int(text, what, lineno):
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise ConfigError("line %d: invalid %s '%s'" % (lineno, what, text))
+
+
+def parse_keywords(tokens, allowed, lineno):
+    """
+    key=value 形式の省略可能な引数を得る。
+
+    @param tokens トークンのリスト
+    @param allowed 指定できるキーの集合
+    @param lineno 行番号
+    @return キーと値の辞書
+    """
+    result = {}
+    for token in tokens:
+        key, sep, value = token.partition("=")
+        if not sep or key not in allowed:
+            raise ConfigError("line %d: unexpected argument '%s'" % (lineno, token))
+        result[key] = value
+    return result
+
+
+def add_name(config, name, lineno):
+    if not RE_IDENT.match(name):
+        raise ConfigError("line %d: invalid name '%s'" % (lineno, name))
+    if name in config.names:
+        raise ConfigError("line %d: duplicate name '%s'" % (lineno, name))
+    config.names.add(name)
+
+
+def parse_task(config, args, lineno):
+    if len(args) < 4:
+        raise ConfigError("line %d: task <name> <priority> <func> <stack_bytes> [arg=] [options=]"
+                          % lineno)
+    name, priority, func, stack_size = args[:4]
+    add_name(config, name, lineno)
+    priority = parse_int(priority, "priority", lineno)
+    if not 0 <= priority < NUM_PRIORITIES:
+        raise ConfigError("line %d: priority must be 0-%d" % (lineno, NUM_PRIORITIES - 1))
+    if not RE_IDENT.match(func):
+        raise ConfigError("line %d: invalid function name '%s'" % (lineno, func))
+    stack_size = parse_int(stack_size, "stack size", lineno)
+    if (stack_size <= 0) or (stack_size % STACK_ALIGN != 0):
+        raise ConfigError("line %d: stack size must be a positive multiple of %d"
+                          % (lineno, STACK_ALIGN))
+
+    kw = parse_keywords(args[4:], {"arg", "options"}, lineno)
+    options = "KERNEL_DEFAULT_TASK_OPTIONS"
+    if "options" in kw:
+        names = [s for s in kw["options"].split(",") if s]
+        if names == ["none"]:
+            options = "0"
+        elif names and all(s in OPTION_NAMES for s in names):
+            options = " | ".join(OPTION_NAMES[s] for s in names)
+        else:
+            raise ConfigError("line %d: options must be fpu, dsp or none" % lineno)
+
+    config.tasks.append({
+        "name": name,
+        "priority": priority,
+        "func": func,
+        "stack_size": stack_size,
+        "arg": kw.get("arg", "NULL"),
+        "options": options,
+    })
+
+
+def parse_object(config, kind, args, lineno):
+    if not args:
+        raise ConfigError("line %d: %s requires a name" % (lineno, kind))
+    name = args[0]
+    add_name(config, name, lineno)
+    obj = {"kind": kind, "name": name}
+    rest = args[1:]
+
+    if kind == "semaphore":
+        if len(rest) != 1:
+            raise ConfigError("line %d: semaphore <name> <count>" % lineno)
+        obj["count"] = parse_int(rest[0], "count", lineno)
+        if not 0 <= obj["count"] <= 0xFFFF:
+            raise ConfigError("line %d: count must be 0-65535" % lineno)
+    elif kind == "mutex":
+        kw = parse_keywords(rest, {"ceiling"}, lineno)
+        if "ceiling" in kw:
+            obj["ceiling"] = parse_int(kw["ceiling"], "ceiling", lineno)
+            if not 0 <= obj["ceiling"] < NUM_PRIORITIES:
+                raise ConfigError("line %d: ceiling must be 0-%d" % (lineno, NUM_PRIORITIES - 1))
+    elif kind == "message_queue":
+        if len(rest) != 1:
+            raise ConfigError("line %d: message_queue <name> <capacity>" % lineno)
+        obj["capacity"] = parse_int(rest[0], "capacity", lineno)
+        if not 0 < obj["capacity"] <= 0xFFFF:
+            raise ConfigError("line %d: capacity must be 1-65535" % lineno)
+    elif kind == "event_flags":
+        if len(rest) > 1:
+            raise ConfigError("line %d: event_flags <name> [flags]" % lineno)
+        obj["flags"] = parse_int(rest[0], "flags", lineno) if rest else 0
+        if not 0 <= obj["flags"] <= 0xFFFFFFFF:
+            raise ConfigError("line %d: flags must be a 32bit value" % lineno)
+    config.objects.append(obj)
+
+
+def parse(text):
+    """
+    設定ファイルを解析する。
+
+    @param text 設定ファイルの内容
+    @return Config
+    """
+    config = Config()
+    for lineno, line in enumerate(text.splitlines(), 1):
+        try:
+            tokens = shlex.split(line, comments=True, posix=False)
+        except ValueError as e:
+            raise ConfigError("line %d: %s" % (lineno, e))
+        if not tokens:
+            continue
+        kind, args = tokens[0], tokens[1:]
+        if kind in ("max_tasks", "stack_pool"):
+            if len(args) != 1:
+                raise ConfigError("line %d: %s <count>" % (lineno, kind))
+            value = parse_int(args[0], kind, lineno)
+            if value < 0:
+                raise ConfigError("line %d: %s must not be negative" % (lineno, kind))
+            setattr(config, kind, value)
+        elif kind == "include":
+            if len(args) != 1:
+                raise ConfigError("line %d: include <header>" % lineno)
+            header = args[0]
+            if not (header.startswith("<") or header.startswith('"')):
+                header = '"%s"' % header
+            config.includes.append(header)
+        elif kind == "task":
+            parse_task(config, args, lineno)
+        elif kind in ("semaphore", "mutex", "message_queue", "event_flags"):
+            parse_object(config, kind, args, lineno)
+        else:
+            raise ConfigError("line %d: unknown keyword '%s'" % (lineno, kind))
+
+    if config.max_tasks is None:
+        config.max_tasks = DEFAULT_MAX_TASKS
+    if not 0 < config.max_tasks <= (1 << MAX_TASK_ID_INDEX_BITS):
+        raise ConfigError("max_tasks must be 1-%d" % (1 << MAX_TASK_ID_INDEX_BITS))
+    if len(config.tasks) > config.max_tasks:
+        raise ConfigError("%d tasks do not fit in max_tasks %d" % (len(config.tasks), config.max_tasks))
+    return config
+
+
+def task_id_index_bits(max_tasks):
+    """
+    タスクIDのうち、タスクエントリの位置を表すビット数を得る。
+    kernel_config.h の既定値と同じく、max_tasks が収まる最小のビット数(3以上)にする。
+    """
+    bits = 3
+    while (1 << bits) < max_tasks:
+        bits += 1
+    return bits
+
+
+def entry_ref(index):
+    return "NULL" if index is None else "&(TaskEntries[%d])" % index
+
+
+def link_list(indexes):
+    """
+    リストに並べたエントリの前後のエントリを得る。
+
+    @param indexes タスクエントリの位置のリスト
+    @return 位置をキー、(前, 次)を値とする辞書
+    """
+    links = {}
+    for i, index in enumerate(indexes):
+        prev = indexes[i - 1] if i > 0 else None
+        next = indexes[i + 1] if i + 1 < len(indexes) else None
+        links[index] = (prev, next)
+    return links
+
+
+def generate_header(config, source):
+    out = []
+    out.append("/* This file is generated by tools/gen_kernel_static.py from %s. Do not edit. */" % source)
+    out.append("#ifndef KERNEL_STATIC_H_")
+    out.append("#define KERNEL_STATIC_H_")
+    out.append("")
+    out.append("#define MAX_TASKS %d" % config.max_tasks)
+    out.append("#define KERNEL_TASK_ID_INDEX_BITS %d" % task_id_index_bits(config.max_tasks))
+    out.append("#define KERNEL_STATIC_NUM_TASKS %d" % len(config.tasks))
+    if config.stack_pool is not None:
+        out.append("#define KERNEL_STACK_POOL_COUNT %d" % config.stack_pool)
+    out.append("")
+    for i, task in enumerate(config.tasks):
+        out.append("#define KERNEL_STATIC_ID_%s KERNEL_STATIC_TASK_ID(%d)" % (task["name"], i))
+    if config.objects:
+        out.append("")
+        for kind in sorted(set(obj["kind"] for obj in config.objects)):
+            out.append("struct %s;" % kind)
+        for obj in config.objects:
+            out.append("extern struct %s %s;" % (obj["kind"], obj["name"]))
+    out.append("")
+    out.append("#endif /* KERNEL_STATIC_H_ */")
+    return "\n".join(out) + "\n"
+
+
+def generate_data(config, source):
+    num_tasks = len(config.tasks)
+    out = []
+    out.append("/* This file is generated by tools/gen_kernel_static.py from %s. Do not edit. */" % source)
+    out.append("/* Included only from src/os/kernel.c */")
+    out.append("")
+    for header in config.includes:
+        out.append("#include %s" % header)
+    if config.includes:
+        out.append("")
+    for func in sorted(set(task["func"] for task in config.tasks)):
+        out.append("void %s(void *arg);" % func)
+    out.append("")
+    for task in config.tasks:
+        out.append("static stack_type_t KernelStaticStack_%s[%d];"
+                   % (task["name"], task["stack_size"] // STACK_ALIGN))
+    out.append("")
+
+    # 同じプライオリティのタスクは、設定ファイルの順に実行する
+    ready = {}
+    for i, task in enumerate(config.tasks):
+        ready.setdefault(task["priority"], []).append(i)
+    links = {}
+    for indexes in ready.values():
+        links.update(link_list(indexes))
+    blank = list(range(num_tasks, config.max_tasks))
+    links.update(link_list(blank))
+
+    out.append("static struct task_entry TaskEntries[MAX_TASKS] = {")
+    for i, task in enumerate(config.tasks):
+        prev, next = links[i]
+        out.append("\tTASK_ENTRY_INITIALIZER(%s, %s, KERNEL_STATIC_ID_%s, %d, %s, %s, KernelStaticStack_%s, %s),"
+                   % (entry_ref(prev), entry_ref(next), task["name"], task["priority"],
+                      task["func"], task["arg"], task["name"], task["options"]))
+    for i in blank:
+        prev, next = links[i]
+        out.append("\tTASK_ENTRY_BLANK_INITIALIZER(%s, %s)," % (entry_ref(prev), entry_ref(next)))
+    out.append("};")
+    out.append("")
+    out.append("static struct task_list BlankEntries = { %s, %s };"
+               % (entry_ref(blank[0] if blank else None), entry_ref(blank[-1] if blank else None)))
+    out.append("")
+
+    bitmap = 0
+    for priority in ready:
+        bitmap |= 1 << priority
+    out.append("static struct ready_queue ReadyQueue = {")
+    out.append("\t.bitmap = 0x%08XU," % bitmap)
+    out.append("\t.lists = {")
+    for priority in sorted(ready):
+        indexes = ready[priority]
+        out.append("\t\t[%d] = { %s, %s }," % (priority, entry_ref(indexes[0]), entry_ref(indexes[-1])))
+    out.append("\t},")
+    out.append("};")
+    out.append("")
+    out.append("static uint16_t AliveTaskCount = %d;" % num_tasks)
+
+    if config.objects:
+        out.append("")
+        for obj in config.objects:
+            if obj["kind"] == "message_queue":
+                out.append("static void *KernelStaticMqBuffer_%s[%d];" % (obj["name"], obj["capacity"]))
+        for obj in config.objects:
+            kind, name = obj["kind"], obj["name"]
+            if kind == "semaphore":
+                init = "SEMAPHORE_INITIALIZER(%d)" % obj["count"]
+            elif kind == "mutex":
+                if "ceiling" in obj:
+                    init = "MUTEX_CEILING_INITIALIZER(%d)" % obj["ceiling"]
+                else:
+                    init = "MUTEX_INITIALIZER"
+            elif kind == "message_queue":
+                init = "MESSAGE_QUEUE_INITIALIZER(KernelStaticMqBuffer_%s, %d)" % (name, obj["capacity"])
+            else:
+                init = "EVENT_FLAGS_INITIALIZER(0x%08XU)" % obj["flags"]
+            out.append("struct %s %s = %s;" % (kind, name, init))
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate static kernel configuration headers.")
+    parser.add_argument("input", help="configuration file")
+    parser.add_argument("-o", "--output-dir", default=".", help="output directory (default: .)")
+    args = parser.parse_args()
+
+    with open(args.input, "r", encoding="utf-8") as f:
+        text = f.read()
+    try:
+        config = parse(text)
+    except ConfigError as e:
+        sys.stderr.write("%s: %s\n" % (args.input, e))
+        return 1
+
+    source = os.path.basename(args.input)
+    os.makedirs(args.output_dir, exist_ok=True)
+    with open(os.path.join(args.output_dir, "kernel_static.h"), "w", encoding="utf-8") as f:
+        f.write(generate_header(config, source))
+    with open(os.path.join(args.output_dir, "kernel_static_data.h"), "w", encoding="utf-8") as f:
+        f.write(generate_data(config, source))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+カーネルトレースデコーダ
+
+src/os/kernel_trace.c で記録したトレースを、Chrome trace 形式(JSON)の
+タイムラインに変換する。出力は chrome://tracing や Perfetto で表示できる。
+
+入力には次のどちらかを指定する。
+  - kernel_trace_dump() のデバッグ出力を保存したテキスト
+    ("KTRACE" で始まらない行は無視する)
+  - デバッガで KernelTrace を sizeof(struct kernel_trace) バイト保存したバイナリ
+
+使い方:
+  ktrace_decode.py trace.log -o trace.json
+  ktrace_decode.py KernelTrace.bin --name 0x9=task1 --name 0xa=task2
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+# kernel_trace.h と一致させること
+TRACE_MAGIC = 0x4354524B
+RECORD_FORMAT = "<IBBHI"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+NUM_RINGS = 2
+
+EV_DISPATCH = 0x01
+EV_IDLE_ENTER = 0x02
+EV_IDLE_EXIT = 0x03
+EV_ISR_ENTER = 0x20
+EV_ISR_EXIT = 0x21
+
+EVENT_NAMES = {
+    0x01: "dispatch",
+    0x02: "idle_enter",
+    0x03: "idle_exit",
+    0x04: "task_create",
+    0x05: "task_exit",
+    0x06: "sleep",
+    0x07: "wait",
+    0x08: "wakeup",
+    0x09: "timeout",
+    0x10: "sem_wait",
+    0x11: "sem_post",
+    0x12: "mutex_lock",
+    0x13: "mutex_unlock",
+    0x20: "isr_enter",
+    0x21: "isr_exit",
+    0x22: "isr_request",
+    0x80: "user",
+}
+
+PID = 1
+TID_IDLE = 0
+TID_ISR = 0x10000
+
+
+def load_text(lines):
+    """kernel_trace_dump()の出力から、バッファ毎のレコード列を得る。"""
+    rings = [[] for _ in range(NUM_RINGS)]
+    for line in lines:
+        fields = line.split()
+        if (len(fields) != 6) or (fields[0] != "KTRACE"):
+            continue
+        ring, ts, event, task_id, obj = (int(f, 16) for f in fields[1:])
+        if ring < NUM_RINGS:
+            rings[ring].append((ts, event, task_id, obj))
+    return rings
+
+
+def load_binary(data):
+    """KernelTraceのメモリダンプから、バッファ毎のレコード列を古い順に得る。"""
+    magic, record_size, buffer_size, _enable = struct.unpack_from("<IHHI", data, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError("not a kernel trace dump (magic=0x%08x)" % magic)
+    if record_size != RECORD_SIZE:
+        raise ValueError("unsupported record size %d" % record_size)
+
+    rings = []
+    offset = 12
+    for _ in range(NUM_RINGS):
+        (written,) = struct.unpack_from("<I", data, offset)
+        base = offset + 4
+        start = written - buffer_size if written > buffer_size else 0
+        records = []
+        for n in range(start, written):
+            pos = base + (n % buffer_size) * record_size
+            records.append(struct.unpack_from(RECORD_FORMAT, data, pos))
+        rings.append([(ts, ev, tid, obj) for (ts, ev, _rsv, tid, obj) in records])
+        offset = base + buffer_size * record_size
+    return rings
+
+
+def unwrap(rings):
+    """
+    32bitのマイクロ秒カウンタを、1つの時間軸に展開して時刻順に並べる。
+    各バッファ内は書き込み順なので前のレコードとの差分で展開し、
+    バッファ間は先頭レコード同士の差分で揃える。
+    """
+    heads = [r[0][0] for r in rings if r]
+    if not heads:
+        return []
+    origin = heads[0]
+    merged = []
+    for ring_no, records in enumerate(rings):
+        if not records:
+            continue
+        t = signed32(records[0][0] - origin)
+        prev = records[0][0]
+        for ts, event, task_id, obj in records:
+            t += (ts - prev) & 0xFFFFFFFF
+            prev = ts
+            merged.append((t, ring_no, event, task_id, obj))
+    merged.sort(key=lambda r: r[0])
+    base = merged[0][0]
+    return [(t - base, ring_no, ev, tid, obj) for (t, ring_no, ev, tid, obj) in merged]
+
+
+def signed32(v):
+    v &= 0xFFFFFFFF
+    return v - 0x100000000 if v & 0x80000000 else v
+
+
+def task_label(task_id, names):
+    if task_id in names:
+        return names[task_id]
+    return "task 0x%x" % task_id
+
+
+def to_chrome_trace(records, names):
+    events = []
+    tids = set()
+    running = None  # (tid, start)
+    isr_depth = 0
+
+    def close_running(t):
+        nonlocal running
+        if running is not None:
+            tid, start = running
+            events.append({"name": "idle" if tid == TID_IDLE else task_label(tid, names),
+                           "ph": "X", "pid": PID, "tid": tid, "ts": start, "dur": t - start})
+            running = None
+
+    for t, _ring, event, task_id, obj in records:
+        if event == EV_DISPATCH:
+            close_running(t)
+            if task_id != 0:
+                running = (task_id, t)
+                tids.add(task_id)
+        elif event == EV_IDLE_ENTER:
+            close_running(t)
+            running = (TID_IDLE, t)
+            tids.add(TID_IDLE)
+        elif event == EV_IDLE_EXIT:
+            close_running(t)
+        elif event == EV_ISR_ENTER:
+            isr_depth += 1
+            tids.add(TID_ISR)
+            events.append({"name": "vect %d" % obj, "ph": "B", "pid": PID, "tid": TID_ISR, "ts": t})
+        elif event == EV_ISR_EXIT:
+            if isr_depth > 0:
+                isr_depth -= 1
+                events.append({"name": "vect %d" % obj, "ph": "E", "pid": PID, "tid": TID_ISR, "ts": t})
+        else:
+            tid = task_id if task_id != 0 else TID_IDLE
+            tids.add(tid)
+            events.append({"name": EVENT_NAMES.get(event, "event 0x%02x" % event),
+                           "ph": "i", "s": "t", "pid": PID, "tid": tid, "ts": t,
+                           "args": {"obj": "0x%08x" % obj}})
+    if records:
+        close_running(records[-1][0])
+
+    for tid in sorted(tids):
+        if tid == TID_IDLE:
+            label = "idle"
+        elif tid == TID_ISR:
+            label = "interrupts"
+        else:
+            label = task_label(tid, names)
+        events.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": tid,
+                       "args": {"name": label}})
+    return {"traceEvents": events}
+
+
+def parse_names(specs):
+    names = {}
+    for spec in specs:
+        task_id, _, label = spec.partition("=")
+        names[int(task_id, 0)] = label
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a kernel trace into Chrome trace JSON.")
+    parser.add_argument("input", help="kernel_trace_dump() log or KernelTrace memory dump")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("--name", action="append", default=[], metavar="ID=NAME",
+                        help="label for a task ID, e.g. 0x9=task1")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    if (len(data) >= 4) and (struct.unpack_from("<I", data, 0)[0] == TRACE_MAGIC):
+        rings = load_binary(data)
+    else:
+        rings = load_text(data.decode("ascii", errors="replace").splitlines())
+
+    trace = to_chrome_trace(unwrap(rings), parse_names(args.name))
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f, indent=1)
+    else:
+        json.dump(trace, sys.stdout, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())